@@ -0,0 +1,115 @@
+/* @file        twfifo_mpsc.h
+ * @brief       Lock-free multi-producer single-consumer FIFO queue.
+ * @details     Intrusive queue of struct twlist_head entries with the same
+ *              enqueue/dequeue shape as twfifo_queue, based on Dmitry
+ *              Vyukov's non-intrusive-stub MPSC algorithm. Any number of
+ *              threads can enqueue concurrently, each enqueue is a single
+ *              atomic exchange. Only one thread at a time may dequeue.
+ *              Only the next link of the entry is used, prev is not touched.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWFIFO_MPSC_H
+#define TWFIFO_MPSC_H
+
+
+#include "twlist.h"
+
+
+/* Producers only touch head, the consumer tail, so keep them apart. */
+typedef struct twfifo_mpsc_queue
+{
+	struct twlist_head	*head __attribute__((aligned(TWCACHELINE_SIZE)));
+	struct twlist_head	*tail __attribute__((aligned(TWCACHELINE_SIZE)));
+	struct twlist_head	stub;
+} twfifo_mpsc_queue;
+
+static void
+twfifo_mpsc_init(twfifo_mpsc_queue *q)
+{
+	q->stub.next = NULL;
+	q->head = &q->stub;
+	q->tail = &q->stub;
+}
+
+/* @brief	Add entry at the end of the queue.
+ * @entry:	entry to add
+ * @q:		the queue
+ * @details	Safe to call from any number of threads at once. */
+static void
+twfifo_mpsc_enqueue(struct twlist_head *entry, twfifo_mpsc_queue *q)
+{
+	struct twlist_head *prev;
+
+	__atomic_store_n(&entry->next, NULL, __ATOMIC_RELAXED);
+	prev = __atomic_exchange_n(&q->head, entry, __ATOMIC_ACQ_REL);
+	/* queue is disconnected between prev and new until this store,
+	 * the consumer sees it as empty from prev on in the meantime */
+	__atomic_store_n(&prev->next, entry, __ATOMIC_RELEASE);
+}
+
+/* @brief	Remove entry from the front of the queue.
+ * @q:		the queue
+ * @details	Returns NULL if the queue is empty, or if the producer that
+ * enqueued the next entry has not finished linking it yet (try again
+ * later). Single consumer only. */
+static struct twlist_head*
+twfifo_mpsc_dequeue_f(twfifo_mpsc_queue *q)
+{
+	struct twlist_head *tail = q->tail;
+	struct twlist_head *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	struct twlist_head *head;
+
+	if (tail == &q->stub)
+	{
+		if (!next)
+			return NULL;
+		q->tail = next;
+		tail = next;
+		next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+	}
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+	head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+	if (tail != head)
+		return NULL;
+	/* tail is the last entry, put the stub behind it to detach it */
+	twfifo_mpsc_enqueue(&q->stub, q);
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+#define twfifo_mpsc_dequeue(q, l) ((l) = twfifo_mpsc_dequeue_f(q))
+
+/* @brief	Tests whether the queue is empty.
+ * @details	Consumer side only, an entry being enqueued concurrently may
+ * not be seen yet. */
+static int
+twfifo_mpsc_empty(twfifo_mpsc_queue *q)
+{
+	return q->tail == &q->stub &&
+		!__atomic_load_n(&q->stub.next, __ATOMIC_ACQUIRE);
+}
+
+/* @brief   Get pointer to the first entry BUT not dequeue it.
+ * @details Consumer side only. */
+#define twfifo_mpsc_get_entry(q, type, member) __extension__		\
+	({ struct twlist_head *__t = (q)->tail;				\
+		if (__t == &(q)->stub)					\
+			__t = __atomic_load_n(&__t->next, __ATOMIC_ACQUIRE); \
+		__t ? twlist_entry(__t, type, member) : NULL; })
+
+
+#endif	/* TWFIFO_MPSC_H */
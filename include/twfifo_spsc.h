@@ -0,0 +1,207 @@
+/* @file        twfifo_spsc.h
+ * @brief       Bounded single-producer single-consumer FIFO ring.
+ * @details     Fixed capacity ring of struct twlist_head pointers with the
+ *              same enqueue/dequeue shape as twfifo_queue, for pipelines
+ *              between exactly two threads. Entries are not linked and not
+ *              written to, dequeue costs no pointer chasing.
+ *              Producer and consumer indices live on separate cache lines,
+ *              each side keeps a cached copy of the other's index and only
+ *              reloads it when the ring looks full (empty). The consumer
+ *              publishes its index every TWFIFO_SPSC_BATCH entries or when
+ *              it runs dry, so the producer may see slots of just dequeued
+ *              entries as still taken for a while. The _bulk variants
+ *              publish once per batch.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWFIFO_SPSC_H
+#define TWFIFO_SPSC_H
+
+
+#include "twlist.h"
+
+
+/* Consumer releases slots to the producer in batches of this many
+ * entries (at most half of the capacity), must be a power of 2. */
+#ifndef TWFIFO_SPSC_BATCH
+#define TWFIFO_SPSC_BATCH 16
+#endif
+
+typedef struct twfifo_spsc_queue
+{
+	/* written by producer */
+	size_t			head __attribute__((aligned(TWCACHELINE_SIZE)));
+	size_t			tail_cache;
+	/* written by consumer */
+	size_t			tail __attribute__((aligned(TWCACHELINE_SIZE)));
+	size_t			tail_local;
+	size_t			head_cache;
+	/* read only */
+	struct twlist_head	**ring __attribute__((aligned(TWCACHELINE_SIZE)));
+	size_t			mask;
+	size_t			batch_mask;
+} twfifo_spsc_queue;
+
+/* @brief	Initialize the ring.
+ * @q:		the queue
+ * @capacity:	number of entries, rounded up to a power of 2
+ * @details	Returns 0 on success, -1 if memory can't be allocated. */
+static int
+twfifo_spsc_init(twfifo_spsc_queue *q, size_t capacity)
+{
+	size_t sz = 1;
+
+	while (sz < capacity)
+		sz <<= 1;
+	q->ring = malloc(sz * sizeof(*q->ring));
+	if (!q->ring)
+		return -1;
+	q->mask = sz - 1;
+	/* never hold back more than half of the ring from the producer */
+	q->batch_mask = (sz / 2 < TWFIFO_SPSC_BATCH ? sz / 2 : TWFIFO_SPSC_BATCH);
+	q->batch_mask = q->batch_mask ? q->batch_mask - 1 : 0;
+	q->head = 0;
+	q->tail_cache = 0;
+	q->tail = 0;
+	q->tail_local = 0;
+	q->head_cache = 0;
+	return 0;
+}
+
+static void
+twfifo_spsc_free(twfifo_spsc_queue *q)
+{
+	free(q->ring);
+	q->ring = NULL;
+}
+
+static size_t
+twfifo_spsc_capacity(const twfifo_spsc_queue *q)
+{
+	return q->mask + 1;
+}
+
+/* Free slots as seen by the producer, reloads consumer's index only
+ * if fewer than @want slots look free. */
+static size_t
+__twfifo_spsc_free_slots(twfifo_spsc_queue *q, size_t want)
+{
+	size_t free_slots = q->mask + 1 - (q->head - q->tail_cache);
+
+	if (free_slots < want)
+	{
+		q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+		free_slots = q->mask + 1 - (q->head - q->tail_cache);
+	}
+	return free_slots;
+}
+
+/* Entries available to the consumer, reloads producer's index only
+ * if fewer than @want look available. Publishes consumer's index
+ * before, so a waiting producer gets all the slots we are done with. */
+static size_t
+__twfifo_spsc_avail(twfifo_spsc_queue *q, size_t want)
+{
+	size_t avail = q->head_cache - q->tail_local;
+
+	if (avail < want)
+	{
+		if (q->tail != q->tail_local)
+			__atomic_store_n(&q->tail, q->tail_local,
+						__ATOMIC_RELEASE);
+		q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+		avail = q->head_cache - q->tail_local;
+	}
+	return avail;
+}
+
+/* @brief	Add entry at the end of the queue.
+ * @entry:	entry to add
+ * @q:		the queue
+ * @details	Producer side only. Returns 0 on success, -1 if the ring
+ * is full. */
+static int
+twfifo_spsc_enqueue(struct twlist_head *entry, twfifo_spsc_queue *q)
+{
+	if (!__twfifo_spsc_free_slots(q, 1))
+		return -1;
+	q->ring[q->head & q->mask] = entry;
+	__atomic_store_n(&q->head, q->head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* @brief	Add up to @n entries, publishing them all at once.
+ * @details	Producer side only. Returns number of entries added. */
+static size_t
+twfifo_spsc_enqueue_bulk(twfifo_spsc_queue *q,
+			struct twlist_head *const *entries, size_t n)
+{
+	size_t i, free_slots = __twfifo_spsc_free_slots(q, n);
+
+	if (n > free_slots)
+		n = free_slots;
+	for (i = 0; i < n; i++)
+		q->ring[(q->head + i) & q->mask] = entries[i];
+	if (n)
+		__atomic_store_n(&q->head, q->head + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+/* @brief	Remove entry from the front of the queue.
+ * @q:		the queue
+ * @details	Consumer side only. Returns NULL if the queue is empty. */
+static struct twlist_head*
+twfifo_spsc_dequeue_f(twfifo_spsc_queue *q)
+{
+	struct twlist_head *l;
+
+	if (!__twfifo_spsc_avail(q, 1))
+		return NULL;
+	l = q->ring[q->tail_local & q->mask];
+	q->tail_local++;
+	if (!(q->tail_local & q->batch_mask))
+		__atomic_store_n(&q->tail, q->tail_local, __ATOMIC_RELEASE);
+	return l;
+}
+
+#define twfifo_spsc_dequeue(q, l) ((l) = twfifo_spsc_dequeue_f(q))
+
+/* @brief	Remove up to @n entries, releasing their slots at once.
+ * @details	Consumer side only. Returns number of entries removed. */
+static size_t
+twfifo_spsc_dequeue_bulk(twfifo_spsc_queue *q,
+			struct twlist_head **entries, size_t n)
+{
+	size_t i, avail = __twfifo_spsc_avail(q, n);
+
+	if (n > avail)
+		n = avail;
+	for (i = 0; i < n; i++)
+		entries[i] = q->ring[(q->tail_local + i) & q->mask];
+	q->tail_local += n;
+	if (n)
+		__atomic_store_n(&q->tail, q->tail_local, __ATOMIC_RELEASE);
+	return n;
+}
+
+/* @brief	Tests whether the queue is empty.
+ * @details	Consumer side only. */
+static int
+twfifo_spsc_empty(twfifo_spsc_queue *q)
+{
+	return !__twfifo_spsc_avail(q, 1);
+}
+
+/* @brief   Get pointer to an entry BUT not dequeue it.
+ * @details Consumer side only. */
+#define twfifo_spsc_get_entry(q, type, member) __extension__		\
+	({ twfifo_spsc_empty(q) ? NULL :				\
+		twlist_entry((q)->ring[(q)->tail_local & (q)->mask],	\
+				type, member); })
+
+
+#endif	/* TWFIFO_SPSC_H */
@@ -14,9 +14,11 @@
 
 
 #include "twlist.h"
+#include "twlist_rcu.h"
 
 
 #include <stdint.h>
+#include <string.h>
 
 
 /* TODO handle n < 0 case */
@@ -144,6 +146,20 @@ twhash_32(uint32_t val, unsigned int bits) {
 	return hash >> (32 - bits);
 }
 
+/* @brief	Mix all bits of @val into all bits of the result.
+ * @details	Murmur3 64 bit finalizer. Unlike twhash_64 the low bits of the
+ * result are as good as the high ones, use it where the table index comes
+ * from anything else than the top bits. */
+static uint64_t
+twhash_mix64(uint64_t val) {
+	val ^= val >> 33;
+	val *= 0xff51afd7ed558ccdULL;
+	val ^= val >> 33;
+	val *= 0xc4ceb9fe1a85ec53ULL;
+	val ^= val >> 33;
+	return val;
+}
+
 static unsigned long
 twhash_ptr(const void *ptr, unsigned int bits) {
 	return twhash_long((unsigned long)ptr, bits);
@@ -159,6 +175,252 @@ twhash32_ptr(const void *ptr) {
 	return (uint32_t) val;
 }
 
+/* Constants of the byte buffer hash. */
+#define TWHASH_BUF_K0	0xa0761d6478bd642fULL
+#define TWHASH_BUF_K1	0xe7037ed1a0b428dbULL
+#define TWHASH_BUF_K2	0x8ebc6af09c88c6e3ULL
+
+static uint64_t
+__twhash_load64(const unsigned char *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t
+__twhash_load32(const unsigned char *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* Multiply and fold the high half of the product into the low one. */
+static uint64_t
+__twhash_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = (__uint128_t) a * b;
+	return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+	return twhash_mix64(a ^ twhash_mix64(b));
+#endif
+}
+
+/* Word at a time hash of @len bytes, 16 bytes per multiplication. Buffer
+ * of 1 to 16 bytes is read with (possibly overlapping) loads of its first
+ * and last bytes, so short keys cost no byte loop either. */
+static uint64_t
+__twhash_buf_generic(const void *buf, size_t len, uint64_t seed) {
+	const unsigned char	*p = (const unsigned char *) buf;
+	uint64_t		h = seed ^ TWHASH_BUF_K0, a, b;
+	size_t			total = len;
+
+	while (len > 16) {
+		h = __twhash_mum(__twhash_load64(p) ^ TWHASH_BUF_K1,
+				__twhash_load64(p + 8) ^ h);
+		p += 16;
+		len -= 16;
+	}
+	if (len >= 8) {
+		a = __twhash_load64(p);
+		b = __twhash_load64(p + len - 8);
+	} else if (len >= 4) {
+		a = __twhash_load32(p);
+		b = __twhash_load32(p + len - 4);
+	} else if (len) {
+		a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) |
+			p[len - 1];
+		b = 0;
+	} else {
+		a = 0;
+		b = 0;
+	}
+	h = __twhash_mum(a ^ TWHASH_BUF_K1, b ^ h ^ total);
+	return __twhash_mum(h ^ TWHASH_BUF_K2, h ^ TWHASH_BUF_K1);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TWHASH_BUF_SSE42 1
+
+/* Long buffers go through four independent crc32c lanes, 32 bytes per
+ * iteration, the rest is finished by the generic hash. */
+__attribute__((target("sse4.2"))) static uint64_t
+__twhash_buf_sse42(const void *buf, size_t len, uint64_t seed) {
+	const unsigned char	*p = (const unsigned char *) buf;
+	uint64_t		c0, c1, c2, c3;
+	size_t			total = len;
+
+	if (len < 64)
+		return __twhash_buf_generic(buf, len, seed);
+	c0 = seed;
+	c1 = seed ^ TWHASH_BUF_K0;
+	c2 = seed ^ TWHASH_BUF_K1;
+	c3 = seed ^ TWHASH_BUF_K2;
+	while (len >= 32) {
+#ifdef __x86_64__
+		c0 = __builtin_ia32_crc32di(c0, __twhash_load64(p));
+		c1 = __builtin_ia32_crc32di(c1, __twhash_load64(p + 8));
+		c2 = __builtin_ia32_crc32di(c2, __twhash_load64(p + 16));
+		c3 = __builtin_ia32_crc32di(c3, __twhash_load64(p + 24));
+#else
+		c0 = __builtin_ia32_crc32si(__builtin_ia32_crc32si(c0,
+			__twhash_load32(p)), __twhash_load32(p + 4));
+		c1 = __builtin_ia32_crc32si(__builtin_ia32_crc32si(c1,
+			__twhash_load32(p + 8)), __twhash_load32(p + 12));
+		c2 = __builtin_ia32_crc32si(__builtin_ia32_crc32si(c2,
+			__twhash_load32(p + 16)), __twhash_load32(p + 20));
+		c3 = __builtin_ia32_crc32si(__builtin_ia32_crc32si(c3,
+			__twhash_load32(p + 24)), __twhash_load32(p + 28));
+#endif
+		p += 32;
+		len -= 32;
+	}
+	return __twhash_buf_generic(p, len, __twhash_mum(
+		(c0 | (c1 << 32)) ^ TWHASH_BUF_K1, (c2 | (c3 << 32)) ^ total));
+}
+#endif
+
+typedef uint64_t (*twhash_buf_fn)(const void *buf, size_t len, uint64_t seed);
+
+/* Implementation chosen on first use, per translation unit. */
+static twhash_buf_fn __twhash_buf_impl;
+
+static twhash_buf_fn
+__twhash_buf_resolve(void) {
+	twhash_buf_fn fn = __atomic_load_n(&__twhash_buf_impl, __ATOMIC_RELAXED);
+
+	if (fn)
+		return fn;
+	fn = __twhash_buf_generic;
+#ifdef TWHASH_BUF_SSE42
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.2"))
+		fn = __twhash_buf_sse42;
+#endif
+	__atomic_store_n(&__twhash_buf_impl, fn, __ATOMIC_RELAXED);
+	return fn;
+}
+
+/* @brief	64 bit hash of a byte buffer.
+ * @buf:	the bytes to hash
+ * @len:	number of bytes
+ * @details	Hashes 8 or 16 bytes per step, long buffers use crc32c lanes
+ * when the CPU has SSE4.2. Values depend on the CPU the process runs on,
+ * don't store them. Structures used as composite keys must have their
+ * padding zeroed. */
+static uint64_t
+twhash_buf64(const void *buf, size_t len) {
+	return __twhash_buf_resolve()(buf, len, 0);
+}
+
+/* @brief	Hash of a byte buffer reduced to @bits bits. */
+static uint32_t
+twhash_buf(const void *buf, size_t len, unsigned int bits) {
+	/* High bits are more random, so use them. */
+	return (uint32_t) (twhash_buf64(buf, len) >> (64 - bits));
+}
+
+/* @brief	Secret key of the seeded hashes.
+ * @details	Give every table its own, initialized with twhash_seed_init
+ * from twhash_seed.h, and keep it away from whoever supplies the keys. */
+struct twhash_seed {
+	uint64_t	k0;
+	uint64_t	k1;
+};
+
+#define __TWHASH_ROTL(x, b)	(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define __TWHASH_SIPROUND(v0, v1, v2, v3)				\
+	do {								\
+		v0 += v1; v1 = __TWHASH_ROTL(v1, 13); v1 ^= v0;		\
+		v0 = __TWHASH_ROTL(v0, 32);				\
+		v2 += v3; v3 = __TWHASH_ROTL(v3, 16); v3 ^= v2;		\
+		v0 += v3; v3 = __TWHASH_ROTL(v3, 21); v3 ^= v0;		\
+		v2 += v1; v1 = __TWHASH_ROTL(v1, 17); v1 ^= v2;		\
+		v2 = __TWHASH_ROTL(v2, 32);				\
+	} while (0)
+
+/* SipHash with @c compression and @d finalization rounds. Words are
+ * loaded in host byte order, results match the reference implementation
+ * on little endian hosts. */
+static uint64_t
+__twhash_sip(const void *buf, size_t len, const struct twhash_seed *seed,
+					unsigned int c, unsigned int d) {
+	const unsigned char	*p = (const unsigned char *) buf;
+	uint64_t		v0 = seed->k0 ^ 0x736f6d6570736575ULL;
+	uint64_t		v1 = seed->k1 ^ 0x646f72616e646f6dULL;
+	uint64_t		v2 = seed->k0 ^ 0x6c7967656e657261ULL;
+	uint64_t		v3 = seed->k1 ^ 0x7465646279746573ULL;
+	uint64_t		m, b = (uint64_t) len << 56;
+	unsigned int		i;
+	size_t			left = len;
+
+	for (; left >= 8; left -= 8, p += 8) {
+		m = __twhash_load64(p);
+		v3 ^= m;
+		for (i = 0; i < c; i++)
+			__TWHASH_SIPROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+	for (i = 0; i < left; i++)
+		b |= (uint64_t) p[i] << (8 * i);
+
+	v3 ^= b;
+	for (i = 0; i < c; i++)
+		__TWHASH_SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xff;
+	for (i = 0; i < d; i++)
+		__TWHASH_SIPROUND(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/* @brief	Keyed hash of a byte buffer, SipHash-1-3. */
+static uint64_t
+twhash_sip13(const void *buf, size_t len, const struct twhash_seed *seed) {
+	return __twhash_sip(buf, len, seed, 1, 3);
+}
+
+/* @brief	Keyed hash of a 64 bit value, SipHash-1-3 of its 8 bytes.
+ * @details	Same result as twhash_sip13(&val, 8, seed) on little endian
+ * hosts, with the block loop unrolled. */
+static uint64_t
+twhash_sip13_u64(uint64_t val, const struct twhash_seed *seed) {
+	uint64_t	v0 = seed->k0 ^ 0x736f6d6570736575ULL;
+	uint64_t	v1 = seed->k1 ^ 0x646f72616e646f6dULL;
+	uint64_t	v2 = seed->k0 ^ 0x6c7967656e657261ULL;
+	uint64_t	v3 = seed->k1 ^ 0x7465646279746573ULL;
+	const uint64_t	b = (uint64_t) 8 << 56;
+
+	v3 ^= val;
+	__TWHASH_SIPROUND(v0, v1, v2, v3);
+	v0 ^= val;
+	v3 ^= b;
+	__TWHASH_SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xff;
+	__TWHASH_SIPROUND(v0, v1, v2, v3);
+	__TWHASH_SIPROUND(v0, v1, v2, v3);
+	__TWHASH_SIPROUND(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/* @brief	Keyed hash of an integer key reduced to @bits bits.
+ * @details	Drop-in for twhash_min in tables whose keys may be chosen by
+ * an adversary: without the seed colliding keys can't be computed. */
+static uint32_t
+twhash_seeded(uint64_t val, const struct twhash_seed *seed,
+						unsigned int bits) {
+	/* High bits are more random, so use them. */
+	return (uint32_t) (twhash_sip13_u64(val, seed) >> (64 - bits));
+}
+
+/* @brief	Keyed hash of a byte buffer reduced to @bits bits. */
+static uint32_t
+twhash_buf_seeded(const void *buf, size_t len,
+		const struct twhash_seed *seed, unsigned int bits) {
+	return (uint32_t) (twhash_sip13(buf, len, seed) >> (64 - bits));
+}
+
 #define TWARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
 /* not supported by ISO C
@@ -208,6 +470,25 @@ __twhash_init(struct twhlist_head *ht, size_t sz) {
 	twhlist_add_head(node, \
 		&hashtable[twhash_min(key, bits)])
 
+/* @brief	Add an object to a rcu enabled hashtable.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_node of the object to be added
+ * @key: the key of the object to be added
+ * @details	May run concurrently with twhash_for_each_possible_rcu readers,
+ * but not with other writers. */
+#define twhash_add_rcu(hashtable, node, key)	\
+	twhlist_add_head_rcu(node, \
+		&hashtable[twhash_min(key, TWHASH_BITS(hashtable))])
+
+/* @brief	Add an object with a byte string key to a hashtable.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_node of the object to be added
+ * @buf: pointer to the key
+ * @len: length of the key in bytes */
+#define twhash_add_key(hashtable, node, buf, len)	\
+	twhlist_add_head(node, \
+		&hashtable[twhash_buf(buf, len, TWHASH_BITS(hashtable))])
+
 /* @brief	Check whether an object is in any hashtable.
  * @node: the &struct twhlist_node of the object to be checked */
 static int
@@ -239,6 +520,14 @@ twhash_del(struct twhlist_node *node) {
 		twhlist_del_init(node);
 }
 
+/* @brief	Remove an object from a rcu enabled hashtable.
+ * @node: &struct twhlist_node of the object to remove
+ * @details	The object can be freed only after a grace period. */
+static void
+twhash_del_rcu(struct twhlist_node *node) {
+		twhlist_del_init_rcu(node);
+}
+
 /* @brief	Iterate over a hashtable.
  * @name: hashtable to iterate
  * @bkt: integer to use as bucket loop cursor
@@ -259,15 +548,73 @@ twhash_del(struct twhlist_node *node) {
 	for ((bkt) = 0, obj = NULL; obj == NULL && (bkt) < TWHASH_SIZE(name); (bkt)++)\
 		twhlist_for_each_entry_safe(obj, tmp, &name[bkt], member)
 
+/* Probe counters, compiled in only with CONFIG_TWHASH_STATS defined.
+ * Lookups through the twhash_for_each_possible family and
+ * twhash_lookup_batch count into a per-thread twhash_probes: number of
+ * lookups and number of entries visited. Exactly one translation unit of
+ * the program has to instantiate the counters with TWHASH_STATS_DEFINE. */
+#ifdef CONFIG_TWHASH_STATS
+struct twhash_probe_stats {
+	unsigned long	lookups;
+	unsigned long	probes;
+};
+
+extern __thread struct twhash_probe_stats twhash_probes;
+
+#define TWHASH_STATS_DEFINE \
+	__thread struct twhash_probe_stats twhash_probes
+
+#define __twhash_count_lookup()	(twhash_probes.lookups++)
+#define __twhash_count_probe()	(twhash_probes.probes++)
+
+/* Walk a chain counting the lookup and every entry visited. */
+#define __twhash_for_each_chain(obj, head, member)			\
+	for (obj = (__twhash_count_lookup(),				\
+		twhlist_entry_safe((head)->first, __typeof__(*(obj)), member));\
+		obj && (__twhash_count_probe(), 1);			\
+		obj = twhlist_entry_safe((obj)->member.next,		\
+			__typeof__(*(obj)), member))
+
+#define __twhash_for_each_chain_rcu(obj, head, member)			\
+	for (obj = (__twhash_count_lookup(),				\
+		twhlist_entry_safe(twrcu_dereference((head)->first),	\
+			__typeof__(*(obj)), member));			\
+		obj && (__twhash_count_probe(), 1);			\
+		obj = twhlist_entry_safe(twrcu_dereference((obj)->member.next),\
+			__typeof__(*(obj)), member))
+#else
+#define __twhash_count_lookup()	((void) 0)
+#define __twhash_count_probe()	((void) 0)
+
+#define __twhash_for_each_chain(obj, head, member)			\
+	twhlist_for_each_entry(obj, head, member)
+
+#define __twhash_for_each_chain_rcu(obj, head, member)			\
+	twhlist_for_each_entry_rcu(obj, head, member)
+#endif
+
 /* @brief	Iterate over all possible objects hashing to the same bucket.
  * @name: hashtable to iterate
  * @obj: the type * to use as a loop cursor for each entry
  * @member: the name of the twhlist_node within the struct
  * @key: the key of the objects to iterate over */
 #define twhash_for_each_possible(name, obj, member, key)			\
-	twhlist_for_each_entry(obj, \
+	__twhash_for_each_chain(obj, \
 		&name[twhash_min(key, TWHASH_BITS(name))], member)
 
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * of a table of 2^bits buckets.
+ * @details	Like twhash_for_each_possible, for tables which are accessed
+ * through a pointer (e.g. allocated at runtime), see twhash_add_bits.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the objects to iterate over
+ * @bits: number of bits of the table size */
+#define twhash_for_each_possible_bits(name, obj, member, key, bits)	\
+	__twhash_for_each_chain(obj, \
+		&name[twhash_min(key, bits)], member)
+
 /* @brief	Iterate over all possible objects hashing to the same bucket safe against removals.
  * @name: hashtable to iterate
  * @obj: the type * to use as a loop cursor for each entry
@@ -278,5 +625,297 @@ twhash_del(struct twhlist_node *node) {
 	twhlist_for_each_entry_safe(obj, tmp,\
 		&name[twhash_min(key, TWHASH_BITS(name))], member)
 
+/* @brief	Iterate over a rcu enabled hashtable.
+ * @name: hashtable to iterate
+ * @bkt: integer to use as bucket loop cursor
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct */
+#define twhash_for_each_rcu(name, bkt, obj, member)			\
+	for ((bkt) = 0, obj = NULL; \
+		obj == NULL && (bkt) < TWHASH_SIZE(name); (bkt)++) \
+			twhlist_for_each_entry_rcu(obj, &name[bkt], member)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * in a rcu enabled hashtable.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_for_each_possible_rcu(name, obj, member, key)		\
+	__twhash_for_each_chain_rcu(obj, \
+		&name[twhash_min(key, TWHASH_BITS(name))], member)
+
+/* @brief	Iterate over all possible objects whose byte string key hashes
+ * to the same bucket.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct
+ * @buf: pointer to the key
+ * @len: length of the key in bytes */
+#define twhash_for_each_possible_key(name, obj, member, buf, len)	\
+	__twhash_for_each_chain(obj, \
+		&name[twhash_buf(buf, len, TWHASH_BITS(name))], member)
+
+/* @brief	Iterate over all possible objects whose byte string key hashes
+ * to the same bucket safe against removals.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @tmp: struct twhlist_node* used for temporary storage
+ * @member: the name of the twhlist_node within the struct
+ * @buf: pointer to the key
+ * @len: length of the key in bytes */
+#define twhash_for_each_possible_key_safe(name, obj, tmp, member, buf, len) \
+	twhlist_for_each_entry_safe(obj, tmp, \
+		&name[twhash_buf(buf, len, TWHASH_BITS(name))], member)
+
+
+/* Tables hashed with a seed: same tables as above, every access passes the
+ * table's &struct twhash_seed. Keys are hashed with twhash_seeded (integer
+ * keys, converted to uint64_t) or twhash_buf_seeded (byte strings). */
+
+/* @brief	Add an object to a seeded hashtable.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_node of the object to be added
+ * @key: the key of the object to be added
+ * @seed: the table's seed */
+#define twhash_add_seeded(hashtable, node, key, seed)	\
+	twhlist_add_head(node, \
+		&hashtable[twhash_seeded(key, seed, TWHASH_BITS(hashtable))])
+
+/* @brief	Add an object to a seeded hashtable of 2^bits buckets. */
+#define twhash_add_seeded_bits(hashtable, node, key, seed, bits)	\
+	twhlist_add_head(node, \
+		&hashtable[twhash_seeded(key, seed, bits)])
+
+/* @brief	Add an object with a byte string key to a seeded hashtable. */
+#define twhash_add_key_seeded(hashtable, node, buf, len, seed)	\
+	twhlist_add_head(node, &hashtable[twhash_buf_seeded(buf, len,	\
+				seed, TWHASH_BITS(hashtable))])
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * of a seeded hashtable.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the objects to iterate over
+ * @seed: the table's seed */
+#define twhash_for_each_possible_seeded(name, obj, member, key, seed)	\
+	__twhash_for_each_chain(obj, \
+		&name[twhash_seeded(key, seed, TWHASH_BITS(name))], member)
+
+/* @brief	Like twhash_for_each_possible_seeded, for tables of 2^bits
+ * buckets accessed through a pointer. */
+#define twhash_for_each_possible_seeded_bits(name, obj, member, key, seed, bits)\
+	__twhash_for_each_chain(obj, \
+		&name[twhash_seeded(key, seed, bits)], member)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * of a seeded hashtable safe against removals. */
+#define twhash_for_each_possible_seeded_safe(name, obj, tmp, member, key, seed)\
+	twhlist_for_each_entry_safe(obj, tmp, \
+		&name[twhash_seeded(key, seed, TWHASH_BITS(name))], member)
+
+/* @brief	Iterate over all possible objects whose byte string key hashes
+ * to the same bucket of a seeded hashtable. */
+#define twhash_for_each_possible_key_seeded(name, obj, member, buf, len, seed)\
+	__twhash_for_each_chain(obj, &name[twhash_buf_seeded(buf, len,	\
+				seed, TWHASH_BITS(name))], member)
+
+
+/* Number of keys whose memory accesses are overlapped in a batch lookup. */
+#ifndef TWHASH_BATCH
+#define TWHASH_BATCH 16
+#endif
+
+/* Bucket of the key at @key, hashed the way twhash_min hashes a key
+ * of @key_size bytes. twhash_min converts 1 and 2 byte keys to 32 bits, which
+ * sign extends signed ones, so @key_signed tells how to widen them. */
+static struct twhlist_head *
+__twhash_batch_bucket(struct twhlist_head *ht, unsigned int bits,
+		const unsigned char *key, size_t key_size, int key_signed) {
+	uint8_t		k8;
+	uint16_t	k16;
+	uint32_t	k32;
+	unsigned long	kl;
+
+	switch (key_size) {
+	case 1:
+		memcpy(&k8, key, 1);
+		if (key_signed)
+			return &ht[twhash_32((int8_t) k8, bits)];
+		return &ht[twhash_32(k8, bits)];
+	case 2:
+		memcpy(&k16, key, 2);
+		if (key_signed)
+			return &ht[twhash_32((int16_t) k16, bits)];
+		return &ht[twhash_32(k16, bits)];
+	case 4:
+		memcpy(&k32, key, 4);
+		return &ht[twhash_32(k32, bits)];
+	default:
+		memcpy(&kl, key, sizeof(kl));
+		return &ht[twhash_long(kl, bits)];
+	}
+}
+
+/* @brief	Look up @n keys at once.
+ * @details	Works in batches of TWHASH_BATCH keys: hashes all of them and
+ * prefetches their buckets, then loads the buckets and prefetches the
+ * first nodes, then walks the chains. Cache misses of different keys
+ * overlap instead of being paid one after another.
+ * @ht: hashtable
+ * @bits: number of bits of the table size
+ * @keys: array of @n keys of @key_size bytes each (1, 2, 4 or 8)
+ * @key_size: size of one key
+ * @key_signed: non zero if the keys are of a signed type
+ * @n: number of keys
+ * @match: returns non zero if the object of @node has the key at @key
+ * @res: array of @n, gets the matching node of each key or NULL
+ * Returns number of keys found. */
+static size_t
+__twhash_lookup_batch(struct twhlist_head *ht, unsigned int bits,
+		const void *keys, size_t key_size, int key_signed, size_t n,
+		int (*match)(const struct twhlist_node *node, const void *key),
+		struct twhlist_node **res) {
+	struct twhlist_head	*b[TWHASH_BATCH];
+	struct twhlist_node	*pos;
+	const unsigned char	*k = (const unsigned char *) keys;
+	size_t			i, j, m, found = 0;
+
+	for (i = 0; i < n; i += m) {
+		m = n - i < TWHASH_BATCH ? n - i : TWHASH_BATCH;
+		for (j = 0; j < m; j++) {
+			b[j] = __twhash_batch_bucket(ht, bits,
+					k + (i + j) * key_size, key_size,
+					key_signed);
+			__builtin_prefetch(b[j]);
+		}
+		for (j = 0; j < m; j++) {
+			res[i + j] = b[j]->first;
+			if (res[i + j])
+				__builtin_prefetch(res[i + j]);
+		}
+		for (j = 0; j < m; j++) {
+			__twhash_count_lookup();
+			for (pos = res[i + j]; pos; pos = pos->next) {
+				__twhash_count_probe();
+				if (match(pos, k + (i + j) * key_size))
+					break;
+			}
+			res[i + j] = pos;
+			found += pos != NULL;
+		}
+	}
+	return found;
+}
+
+/* Non zero if @keys is an array of a signed integer type. Compared with 1,
+ * not 0, so unsigned types don't trip -Wtype-limits. */
+#define __TWHASH_KEYS_SIGNED(keys)					\
+	((__typeof__((keys)[0])) -1 < 1)
+
+/* @brief	Look up an array of keys with overlapped memory accesses.
+ * @name: hashtable to look in
+ * @keys: array of keys, of the same type as the keys objects were added with
+ * @n: number of keys
+ * @match: int (*)(const struct twhlist_node *node, const void *key)
+ * @res: struct twhlist_node *[n] with results, NULL where key is not found
+ * Evaluates to the number of keys found. */
+#define twhash_lookup_batch(name, keys, n, match, res)			\
+	__twhash_lookup_batch(name, TWHASH_BITS(name), keys,		\
+				sizeof((keys)[0]), __TWHASH_KEYS_SIGNED(keys),	\
+				n, match, res)
+
+/* @brief	Like twhash_lookup_batch, for tables of 2^bits buckets
+ * accessed through a pointer. */
+#define twhash_lookup_batch_bits(name, bits, keys, n, match, res)	\
+	__twhash_lookup_batch(name, bits, keys,				\
+				sizeof((keys)[0]), __TWHASH_KEYS_SIGNED(keys),	\
+				n, match, res)
+
+/* Chain lengths counted individually by twhash_stats, longer chains are
+ * counted in the last slot of the histogram. */
+#define TWHASH_STATS_HIST 32
+
+/* @brief	Shape of a hashtable. */
+struct twhash_stats {
+	size_t	buckets;	/* number of buckets */
+	size_t	used;		/* non empty buckets */
+	size_t	entries;
+	size_t	max_chain;
+	size_t	p99_chain;	/* 99% of non empty buckets are no longer */
+	double	mean_chain;	/* average length of non empty chains */
+	double	load_factor;	/* entries per bucket */
+	size_t	hist[TWHASH_STATS_HIST];	/* buckets by chain length */
+};
+
+static void
+__twhash_stats_init(struct twhash_stats *st) {
+	memset(st, 0, sizeof(*st));
+}
+
+/* Account @sz buckets of @ht. */
+static void
+__twhash_stats_add(struct twhash_stats *st, const struct twhlist_head *ht,
+								size_t sz) {
+	struct twhlist_node	*pos;
+	size_t			i, len;
+
+	for (i = 0; i < sz; i++) {
+		len = 0;
+		for (pos = ht[i].first; pos; pos = pos->next)
+			len++;
+		st->hist[len < TWHASH_STATS_HIST ? len : TWHASH_STATS_HIST - 1]++;
+		if (len > st->max_chain)
+			st->max_chain = len;
+		st->used += len != 0;
+		st->entries += len;
+	}
+	st->buckets += sz;
+}
+
+/* Compute derived values once all buckets are accounted. */
+static void
+__twhash_stats_finish(struct twhash_stats *st) {
+	size_t	i, cnt = 0, p99;
+
+	st->load_factor = st->buckets ?
+		(double) st->entries / st->buckets : 0;
+	st->mean_chain = st->used ? (double) st->entries / st->used : 0;
+	st->p99_chain = 0;
+	if (!st->used)
+		return;
+	/* ceil(used * 0.99) buckets have to be covered */
+	p99 = st->used - st->used / 100;
+	for (i = 1; i < TWHASH_STATS_HIST - 1; i++) {
+		cnt += st->hist[i];
+		if (cnt >= p99) {
+			st->p99_chain = i;
+			return;
+		}
+	}
+	/* in the overflow slot, exact length unknown */
+	st->p99_chain = st->max_chain;
+}
+
+static void
+__twhash_stats(const struct twhlist_head *ht, size_t sz,
+						struct twhash_stats *st) {
+	__twhash_stats_init(st);
+	__twhash_stats_add(st, ht, sz);
+	__twhash_stats_finish(st);
+}
+
+/* @brief	Collect chain length statistics of a hashtable.
+ * @details	Walks all buckets, takes no locks.
+ * @hashtable: hashtable to look at
+ * @st: &struct twhash_stats to fill */
+#define twhash_stats(hashtable, st) \
+	__twhash_stats(hashtable, TWHASH_SIZE(hashtable), st)
+
+/* @brief	Like twhash_stats, for tables of 2^bits buckets accessed
+ * through a pointer. */
+#define twhash_stats_bits(hashtable, bits, st) \
+	__twhash_stats(hashtable, (size_t) 1 << (bits), st)
 
 #endif	/* TWHASHTBALE_H */
@@ -0,0 +1,308 @@
+/* @file        twhash.hpp
+ * @brief       C++ wrapper of twhash.
+ * @details     tw::hash_table<T, &T::hlink, Bits> is an array of 2^Bits
+ *              twhlist_head buckets, the same as TWDEFINE_HASHTABLE, with
+ *              typed forward iterators over the whole table and over the
+ *              chain of one bucket, so it works with range-for and
+ *              <algorithm>. Keys are hashed with twhash_min like twhash_add,
+ *              the bucket count is a compile time constant.
+ *              The table doesn't own its elements, like the C hashtable.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_HPP
+#define TWHASH_HPP
+
+
+#include "twhash.h"
+#include "twlist.hpp"
+
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+
+namespace tw {
+
+template <class T, twhlist_node T::*Link, unsigned Bits>
+class hash_table
+{
+	static_assert(Bits > 0 && Bits <= 31, "Bits must be in 1..31");
+
+public:
+	static constexpr unsigned bits = Bits;
+	static constexpr std::size_t bucket_count = std::size_t(1) << Bits;
+
+	/* Iterates over the chain of one bucket. */
+	template <bool Const>
+	class basic_local_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef T				value_type;
+		typedef std::ptrdiff_t			difference_type;
+		typedef typename std::conditional<Const, const T *, T *>::type
+							pointer;
+		typedef typename std::conditional<Const, const T &, T &>::type
+							reference;
+
+		basic_local_iterator() noexcept : node_(nullptr) {}
+		explicit basic_local_iterator(twhlist_node *n) noexcept
+			: node_(n) {}
+		template <bool C, class = typename std::enable_if<Const && !C>::type>
+		basic_local_iterator(const basic_local_iterator<C> &it) noexcept
+			: node_(it.node()) {}
+
+		reference operator*() const noexcept
+		{
+			return *detail::container_of(node_, Link);
+		}
+		pointer operator->() const noexcept
+		{
+			return detail::container_of(node_, Link);
+		}
+		basic_local_iterator &operator++() noexcept
+		{
+			node_ = node_->next;
+			return *this;
+		}
+		basic_local_iterator operator++(int) noexcept
+		{
+			basic_local_iterator tmp = *this;
+			node_ = node_->next;
+			return tmp;
+		}
+		friend bool operator==(const basic_local_iterator &a,
+				const basic_local_iterator &b) noexcept
+		{
+			return a.node_ == b.node_;
+		}
+		friend bool operator!=(const basic_local_iterator &a,
+				const basic_local_iterator &b) noexcept
+		{
+			return a.node_ != b.node_;
+		}
+		twhlist_node *node() const noexcept { return node_; }
+
+	private:
+		twhlist_node *node_;
+	};
+
+	/* Iterates over all buckets, in bucket order. */
+	template <bool Const>
+	class basic_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef T				value_type;
+		typedef std::ptrdiff_t			difference_type;
+		typedef typename std::conditional<Const, const T *, T *>::type
+							pointer;
+		typedef typename std::conditional<Const, const T &, T &>::type
+							reference;
+
+		basic_iterator() noexcept : ht_(nullptr), bkt_(0), node_(nullptr)
+		{}
+		basic_iterator(twhlist_head *ht, std::size_t bkt) noexcept
+			: ht_(ht), bkt_(bkt), node_(nullptr)
+		{
+			skip();
+		}
+		template <bool C, class = typename std::enable_if<Const && !C>::type>
+		basic_iterator(const basic_iterator<C> &it) noexcept
+			: ht_(it.ht_), bkt_(it.bkt_), node_(it.node_) {}
+
+		reference operator*() const noexcept
+		{
+			return *detail::container_of(node_, Link);
+		}
+		pointer operator->() const noexcept
+		{
+			return detail::container_of(node_, Link);
+		}
+		basic_iterator &operator++() noexcept
+		{
+			node_ = node_->next;
+			if (!node_)
+			{
+				bkt_++;
+				skip();
+			}
+			return *this;
+		}
+		basic_iterator operator++(int) noexcept
+		{
+			basic_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+		friend bool operator==(const basic_iterator &a,
+					const basic_iterator &b) noexcept
+		{
+			return a.node_ == b.node_;
+		}
+		friend bool operator!=(const basic_iterator &a,
+					const basic_iterator &b) noexcept
+		{
+			return a.node_ != b.node_;
+		}
+		twhlist_node *node() const noexcept { return node_; }
+
+	private:
+		template <bool> friend class basic_iterator;
+
+		/* Go to the first node of the first nonempty bucket from bkt_
+		 * on, end is the null node. */
+		void skip() noexcept
+		{
+			for (; bkt_ < bucket_count; bkt_++)
+			{
+				node_ = ht_[bkt_].first;
+				if (node_)
+					return;
+			}
+		}
+
+		twhlist_head	*ht_;
+		std::size_t	bkt_;
+		twhlist_node	*node_;
+	};
+
+	typedef T					value_type;
+	typedef T &					reference;
+	typedef const T &				const_reference;
+	typedef std::size_t				size_type;
+	typedef basic_iterator<false>			iterator;
+	typedef basic_iterator<true>			const_iterator;
+	typedef basic_local_iterator<false>		local_iterator;
+	typedef basic_local_iterator<true>		const_local_iterator;
+
+	/* The chain of one bucket, a range for range-for. */
+	template <class It>
+	class range
+	{
+	public:
+		explicit range(It b) noexcept : begin_(b) {}
+		It begin() const noexcept { return begin_; }
+		It end() const noexcept { return It(); }
+
+	private:
+		It begin_;
+	};
+
+	hash_table() noexcept { __twhash_init(ht_, bucket_count); }
+	/* The buckets are linked to by the elements, they can't be copied. */
+	hash_table(const hash_table &) = delete;
+	hash_table &operator=(const hash_table &) = delete;
+
+	/* The underlying buckets, for use with the C API. */
+	twhlist_head *buckets() noexcept { return ht_; }
+	const twhlist_head *buckets() const noexcept { return ht_; }
+
+	/* Bucket of @key, as twhash_add hashes it. */
+	template <class K>
+	static std::size_t bucket(K key) noexcept
+	{
+		return twhash_min(key, Bits);
+	}
+
+	/* O(bucket_count), the table doesn't keep a count. */
+	bool empty() const noexcept
+	{
+		return __twhash_empty(const_cast<twhlist_head *>(ht_),
+							bucket_count) == 0;
+	}
+
+	/* O(bucket_count + n). */
+	size_type size() const noexcept
+	{
+		return static_cast<size_type>(std::distance(begin(), end()));
+	}
+
+	iterator begin() noexcept { return iterator(ht_, 0); }
+	iterator end() noexcept { return iterator(); }
+	const_iterator begin() const noexcept
+	{
+		return const_iterator(const_cast<twhlist_head *>(ht_), 0);
+	}
+	const_iterator end() const noexcept { return const_iterator(); }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	local_iterator begin(std::size_t bkt) noexcept
+	{
+		return local_iterator(ht_[bkt].first);
+	}
+	local_iterator end(std::size_t) noexcept { return local_iterator(); }
+	const_local_iterator begin(std::size_t bkt) const noexcept
+	{
+		return const_local_iterator(ht_[bkt].first);
+	}
+	const_local_iterator end(std::size_t) const noexcept
+	{
+		return const_local_iterator();
+	}
+
+	/* Add @x under @key, twhash_add. */
+	template <class K>
+	void add(T &x, K key) noexcept
+	{
+		twhlist_add_head(&(x.*Link), &ht_[bucket(key)]);
+	}
+
+	/* Remove @x from whatever table it is in, twhash_del. */
+	static void remove(T &x) noexcept { twhash_del(&(x.*Link)); }
+
+	static bool hashed(const T &x) noexcept
+	{
+		return !twhlist_unhashed(&(x.*Link));
+	}
+
+	/* Objects which hash to the same bucket as @key,
+	 * twhash_for_each_possible. */
+	template <class K>
+	range<local_iterator> possible(K key) noexcept
+	{
+		return range<local_iterator>(begin(bucket(key)));
+	}
+	template <class K>
+	range<const_local_iterator> possible(K key) const noexcept
+	{
+		return range<const_local_iterator>(begin(bucket(key)));
+	}
+
+	/* First object in the bucket of @key for which @pred is true, nullptr
+	 * if there is none. */
+	template <class K, class Pred>
+	T *find(K key, Pred pred) noexcept(noexcept(pred(std::declval<T &>())))
+	{
+		twhlist_node *n;
+
+		for (n = ht_[bucket(key)].first; n; n = n->next)
+			if (pred(*detail::container_of(n, Link)))
+				return detail::container_of(n, Link);
+		return nullptr;
+	}
+
+	/* Unlink all objects, they are left as they are. */
+	void clear() noexcept { __twhash_init(ht_, bucket_count); }
+
+private:
+	twhlist_head ht_[std::size_t(1) << Bits];
+};
+
+template <class T, twhlist_node T::*Link, unsigned Bits>
+constexpr unsigned hash_table<T, Link, Bits>::bits;
+template <class T, twhlist_node T::*Link, unsigned Bits>
+constexpr std::size_t hash_table<T, Link, Bits>::bucket_count;
+
+} /* namespace tw */
+
+
+#endif	/* TWHASH_HPP */
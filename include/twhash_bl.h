@@ -0,0 +1,148 @@
+/* @file        twhash_bl.h
+ * @brief       Hashtable with a bit spinlock per bucket.
+ * @details     Same layout as twhash.h tables, but buckets are
+ *              twhlist_bl_heads, each one locked by bit 0 of its first
+ *              pointer. Writers to different buckets never contend and the
+ *              bucket array is no bigger than the one of a plain table.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_BL_H
+#define TWHASH_BL_H
+
+
+#include "twhash.h"
+#include "twlist_bl.h"
+
+
+#define TWDEFINE_HASHTABLE_BL(name, bits) \
+	struct twhlist_bl_head name[1 << (bits)]
+
+#define TWDECLARE_HASHTABLE_BL(name, bits) \
+	struct twhlist_bl_head name[1 << (bits)]
+
+static void
+__twhash_bl_init(struct twhlist_bl_head *ht, size_t sz) {
+	size_t i;
+	for (i = 0; i < sz; i++)
+		TWINIT_HLIST_BL_HEAD(&ht[i]);
+}
+
+/* @brief	Initialize a bit locked hashtable.
+ * @hashtable: hashtable to be initialized */
+#define twhash_bl_init(hashtable) \
+	__twhash_bl_init(hashtable, TWHASH_SIZE(hashtable))
+
+/* @brief	Get the bucket for a key.
+ * @hashtable: hashtable
+ * @key: the key */
+#define twhash_bl_bucket(hashtable, key) \
+	(&hashtable[twhash_min(key, TWHASH_BITS(hashtable))])
+
+/* @brief	Lock the bucket of @key. */
+#define twhash_bl_lock(hashtable, key) \
+	twhlist_bl_lock(twhash_bl_bucket(hashtable, key))
+
+/* @brief	Unlock the bucket of @key. */
+#define twhash_bl_unlock(hashtable, key) \
+	twhlist_bl_unlock(twhash_bl_bucket(hashtable, key))
+
+static void
+__twhash_bl_add(struct twhlist_bl_head *b, struct twhlist_bl_node *node) {
+	twhlist_bl_lock(b);
+	twhlist_bl_add_head(node, b);
+	twhlist_bl_unlock(b);
+}
+
+static void
+__twhash_bl_del(struct twhlist_bl_head *b, struct twhlist_bl_node *node) {
+	twhlist_bl_lock(b);
+	twhlist_bl_del_init(node);
+	twhlist_bl_unlock(b);
+}
+
+/* @brief	Add an object to a bit locked hashtable.
+ * @details	Takes and releases the bucket lock.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_bl_node of the object to be added
+ * @key: the key of the object to be added */
+#define twhash_bl_add(hashtable, node, key) \
+	__twhash_bl_add(twhash_bl_bucket(hashtable, key), node)
+
+/* @brief	Add an object to a bit locked hashtable, bucket already locked.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_bl_node of the object to be added
+ * @key: the key of the object to be added */
+#define twhash_bl_add_locked(hashtable, node, key) \
+	twhlist_bl_add_head(node, twhash_bl_bucket(hashtable, key))
+
+/* @brief	Remove an object from a bit locked hashtable.
+ * @details	Takes and releases the bucket lock. The key is needed to find
+ * the bucket the object lives in.
+ * @hashtable: hashtable the object is in
+ * @node: &struct twhlist_bl_node of the object to remove
+ * @key: the key of the object */
+#define twhash_bl_del(hashtable, node, key) \
+	__twhash_bl_del(twhash_bl_bucket(hashtable, key), node)
+
+/* @brief	Remove an object from a bit locked hashtable, bucket already
+ * locked.
+ * @node: &struct twhlist_bl_node of the object to remove */
+static void
+twhash_bl_del_locked(struct twhlist_bl_node *node) {
+	twhlist_bl_del_init(node);
+}
+
+/* @brief	Check whether an object is in any hashtable.
+ * @node: the &struct twhlist_bl_node of the object to be checked */
+static int
+twhash_bl_hashed(struct twhlist_bl_node *node) {
+	return !twhlist_bl_unhashed(node);
+}
+
+/* @brief	Iterate over all possible objects hashing to the same bucket.
+ * @details	Bucket must be locked with twhash_bl_lock.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_bl_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_bl_for_each_possible(name, obj, member, key)		\
+	twhlist_bl_for_each_entry(obj, twhash_bl_bucket(name, key), member)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * safe against removals.
+ * @details	Bucket must be locked with twhash_bl_lock.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @tmp: struct twhlist_bl_node* used for temporary storage
+ * @member: the name of the twhlist_bl_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_bl_for_each_possible_safe(name, obj, tmp, member, key)	\
+	twhlist_bl_for_each_entry_safe(obj, tmp,			\
+		twhash_bl_bucket(name, key), member)
+
+/* @brief	Look up an object under the bucket lock.
+ * @details	Evaluates to the first object in the bucket of @key for which
+ * @cond holds (@cond can refer to @obj), or NULL. The bucket lock is
+ * released before returning, so the caller needs some other way (e.g. a
+ * reference count taken in @cond) to keep the object alive.
+ * @name: hashtable to look in
+ * @obj: the type * to use as a loop cursor and result
+ * @member: the name of the twhlist_bl_node within the struct
+ * @key: the key of the object
+ * @cond: expression selecting the object */
+#define twhash_bl_lookup(name, obj, member, key, cond) __extension__	\
+	({ struct twhlist_bl_head *__b = twhash_bl_bucket(name, key);	\
+		twhlist_bl_lock(__b);					\
+		twhlist_bl_for_each_entry(obj, __b, member)		\
+			if (cond)					\
+				break;					\
+		twhlist_bl_unlock(__b);					\
+		obj; })
+
+
+#endif	/* TWHASH_BL_H */
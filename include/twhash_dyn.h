@@ -0,0 +1,337 @@
+/* @file        twhash_dyn.h
+ * @brief       Dynamically resizable hashtable.
+ * @details     Heap-backed counterpart of twhash.h. The bucket array grows
+ *              and shrinks on load factor thresholds. Resizing is incremental:
+ *              entries are moved from the old to the new bucket array a few
+ *              buckets at a time on later insertions (or explicit calls to
+ *              twhash_dyn_rehash_step), so no single operation pays the whole
+ *              O(n) cost. Lookups check both arrays while a resize is
+ *              in progress.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_DYN_H
+#define TWHASH_DYN_H
+
+
+#include "twhash.h"
+
+
+#include <stdint.h>
+
+
+/* Table never grows above 2^TWHASH_DYN_MAX_BITS buckets and never shrinks
+ * below the size it was initialized with (at least 2^TWHASH_DYN_MIN_BITS). */
+#define TWHASH_DYN_MIN_BITS	4
+#define TWHASH_DYN_MAX_BITS	31
+
+/* Grow when there are more than TWHASH_DYN_GROW_LOAD entries per bucket,
+ * shrink when there is less than one entry per TWHASH_DYN_SHRINK_LOAD
+ * buckets. */
+#define TWHASH_DYN_GROW_LOAD	1
+#define TWHASH_DYN_SHRINK_LOAD	8
+
+/* Number of old buckets migrated on each insertion while resizing. Must be
+ * at least 1 so that a resize completes before the next one is due. */
+#define TWHASH_DYN_REHASH_STEP	2
+
+/* @brief	Node to embed in objects stored in a twhash_dyn table.
+ * @details	The full 32 bit hash of the key is kept next to the list node
+ * so that entries can be moved to a bucket array of different size without
+ * knowing how to get at their keys. */
+struct twhash_dyn_node
+{
+	struct twhlist_node	node;
+	uint32_t		hash;
+};
+
+struct twhash_dyn
+{
+	struct twhlist_head	*tbl;		/* current bucket array */
+	struct twhlist_head	*old;		/* array being drained or NULL */
+	unsigned int		bits;
+	unsigned int		old_bits;
+	unsigned int		min_bits;
+	size_t			rehash_idx;	/* next bucket of old to move */
+	size_t			count;
+	struct twhlist_head	empty;		/* always empty, see lookups */
+};
+
+/* @brief	Full 32 bit hash of the key.
+ * @details	Index of the bucket for given number of bits is the top @bits
+ * of this value, i.e. the same bucket twhash_min(key, bits) gives. */
+#define twhash_dyn_hash(key) ((uint32_t) twhash_min(key, 32))
+
+#define __twhash_dyn_idx(hash, bits) ((size_t) ((hash) >> (32 - (bits))))
+
+/* @brief	Initialize a resizable hashtable.
+ * @ht:		table to initialize
+ * @bits:	initial (and minimal) size of the table is 2^bits buckets
+ * @details	Returns 0 on success, -1 if memory can't be allocated. */
+static int
+twhash_dyn_init(struct twhash_dyn *ht, unsigned int bits)
+{
+	if (bits < TWHASH_DYN_MIN_BITS)
+		bits = TWHASH_DYN_MIN_BITS;
+	if (bits > TWHASH_DYN_MAX_BITS)
+		bits = TWHASH_DYN_MAX_BITS;
+
+	ht->tbl = malloc(sizeof(*ht->tbl) << bits);
+	if (!ht->tbl)
+		return -1;
+	__twhash_init(ht->tbl, (size_t) 1 << bits);
+	ht->old = NULL;
+	ht->bits = bits;
+	ht->old_bits = 0;
+	ht->min_bits = bits;
+	ht->rehash_idx = 0;
+	ht->count = 0;
+	TWINIT_HLIST_HEAD(&ht->empty);
+	return 0;
+}
+
+/* @brief	Release bucket arrays of the table.
+ * @details	Objects still linked into the table are not touched. */
+static void
+twhash_dyn_free(struct twhash_dyn *ht)
+{
+	free(ht->old);
+	free(ht->tbl);
+	ht->old = NULL;
+	ht->tbl = NULL;
+	ht->count = 0;
+}
+
+/* Move up to @n buckets from the old array into the current one. */
+static void
+__twhash_dyn_migrate(struct twhash_dyn *ht, size_t n)
+{
+	struct twhash_dyn_node	*obj;
+	struct twhlist_node	*tmp;
+	size_t			old_sz;
+
+	if (!ht->old)
+		return;
+
+	old_sz = (size_t) 1 << ht->old_bits;
+	while (n-- && ht->rehash_idx < old_sz)
+	{
+		twhlist_for_each_entry_safe(obj, tmp,
+				&ht->old[ht->rehash_idx], node)
+		{
+			__twhlist_del(&obj->node);
+			twhlist_add_head(&obj->node,
+				&ht->tbl[__twhash_dyn_idx(obj->hash, ht->bits)]);
+		}
+		ht->rehash_idx++;
+	}
+
+	if (ht->rehash_idx == old_sz)
+	{
+		free(ht->old);
+		ht->old = NULL;
+		ht->old_bits = 0;
+		ht->rehash_idx = 0;
+	}
+}
+
+/* Start moving entries into a new array of 2^bits buckets. If memory
+ * can't be allocated we carry on with the current array. */
+static void
+__twhash_dyn_resize(struct twhash_dyn *ht, unsigned int bits)
+{
+	struct twhlist_head *tbl;
+
+	tbl = malloc(sizeof(*tbl) << bits);
+	if (!tbl)
+		return;
+	__twhash_init(tbl, (size_t) 1 << bits);
+	ht->old = ht->tbl;
+	ht->old_bits = ht->bits;
+	ht->tbl = tbl;
+	ht->bits = bits;
+	ht->rehash_idx = 0;
+}
+
+/* Start a resize if load factor crossed one of the thresholds. */
+static void
+__twhash_dyn_check(struct twhash_dyn *ht)
+{
+	size_t sz = (size_t) 1 << ht->bits;
+
+	/* one resize at a time */
+	if (ht->old)
+		return;
+
+	if (ht->count > sz * TWHASH_DYN_GROW_LOAD &&
+			ht->bits < TWHASH_DYN_MAX_BITS)
+		__twhash_dyn_resize(ht, ht->bits + 1);
+	else if (ht->count * TWHASH_DYN_SHRINK_LOAD < sz &&
+			ht->bits > ht->min_bits)
+		__twhash_dyn_resize(ht, ht->bits - 1);
+}
+
+static void
+__twhash_dyn_add(struct twhash_dyn *ht, struct twhash_dyn_node *n,
+							uint32_t hash)
+{
+	__twhash_dyn_migrate(ht, TWHASH_DYN_REHASH_STEP);
+	n->hash = hash;
+	twhlist_add_head(&n->node, &ht->tbl[__twhash_dyn_idx(hash, ht->bits)]);
+	ht->count++;
+	__twhash_dyn_check(ht);
+}
+
+/* @brief	Add an object to a resizable hashtable.
+ * @ht: the &struct twhash_dyn to add to
+ * @n: the &struct twhash_dyn_node of the object to be added
+ * @key: the key of the object to be added */
+#define twhash_dyn_add(ht, n, key) \
+	__twhash_dyn_add(ht, n, twhash_dyn_hash(key))
+
+/* @brief	Remove an object from a resizable hashtable.
+ * @details	Never moves other entries, so it is safe to call from inside
+ * of the _safe iteration macros. Shrinking is left to later insertions.
+ * @ht: the &struct twhash_dyn the object is in
+ * @n: &struct twhash_dyn_node of the object to remove */
+static void
+twhash_dyn_del(struct twhash_dyn *ht, struct twhash_dyn_node *n)
+{
+	if (twhlist_unhashed(&n->node))
+		return;
+	twhlist_del_init(&n->node);
+	ht->count--;
+}
+
+/* @brief	Do some of the pending resize work.
+ * @details	Moves up to @n buckets and starts a new resize if it is due.
+ * Useful to finish a resize (or shrink after deletions) from an idle loop
+ * without waiting for insertions. Returns non zero while a resize is still
+ * in progress. */
+static int
+twhash_dyn_rehash_step(struct twhash_dyn *ht, size_t n)
+{
+	__twhash_dyn_migrate(ht, n);
+	__twhash_dyn_check(ht);
+	return ht->old != NULL;
+}
+
+/* @brief	Number of objects in the table. */
+static size_t
+twhash_dyn_count(const struct twhash_dyn *ht)
+{
+	return ht->count;
+}
+
+/* @brief	Check whether a resizable hashtable is empty. */
+static int
+twhash_dyn_empty(const struct twhash_dyn *ht)
+{
+	return ht->count == 0;
+}
+
+/* @brief	Collect chain length statistics of a resizable hashtable.
+ * @details	While a resize is in progress both arrays are accounted, the
+ * already drained part of the old one is not. */
+static void
+twhash_dyn_stats(const struct twhash_dyn *ht, struct twhash_stats *st)
+{
+	__twhash_stats_init(st);
+	__twhash_stats_add(st, ht->tbl, (size_t) 1 << ht->bits);
+	if (ht->old)
+		__twhash_stats_add(st, ht->old + ht->rehash_idx,
+			((size_t) 1 << ht->old_bits) - ht->rehash_idx);
+	__twhash_stats_finish(st);
+}
+
+/* Bucket for @hash in current (@pass 0) or old (@pass 1) array. Buckets of
+ * the old array which have already been migrated are reported as empty. */
+static struct twhlist_head *
+__twhash_dyn_bucket(struct twhash_dyn *ht, uint32_t hash, unsigned int pass)
+{
+	size_t i;
+
+	if (pass == 0)
+		return &ht->tbl[__twhash_dyn_idx(hash, ht->bits)];
+	if (ht->old)
+	{
+		i = __twhash_dyn_idx(hash, ht->old_bits);
+		if (i >= ht->rehash_idx)
+			return &ht->old[i];
+	}
+	return &ht->empty;
+}
+
+/* Number of buckets in both arrays together. */
+static size_t
+__twhash_dyn_nbuckets(const struct twhash_dyn *ht)
+{
+	return ((size_t) 1 << ht->bits) +
+		(ht->old ? (size_t) 1 << ht->old_bits : 0);
+}
+
+/* Bucket @bkt counting current array first, then the old one. */
+static struct twhlist_head *
+__twhash_dyn_bucket_at(struct twhash_dyn *ht, size_t bkt)
+{
+	size_t sz = (size_t) 1 << ht->bits;
+
+	if (bkt < sz)
+		return &ht->tbl[bkt];
+	return &ht->old[bkt - sz];
+}
+
+/* @brief	Iterate over a resizable hashtable.
+ * @ht: the &struct twhash_dyn to iterate
+ * @bkt: size_t to use as bucket loop cursor
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_dyn_node within the struct */
+#define twhash_dyn_for_each(ht, bkt, obj, member)			\
+	for ((bkt) = 0, obj = NULL;					\
+		obj == NULL && (bkt) < __twhash_dyn_nbuckets(ht); (bkt)++) \
+			twhlist_for_each_entry(obj,			\
+				__twhash_dyn_bucket_at(ht, bkt), member.node)
+
+/* @brief	Iterate over a resizable hashtable safe against removal
+ * of hash entry.
+ * @ht: the &struct twhash_dyn to iterate
+ * @bkt: size_t to use as bucket loop cursor
+ * @tmp: struct twhlist_node* used for temporary storage
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_dyn_node within the struct */
+#define twhash_dyn_for_each_safe(ht, bkt, tmp, obj, member)		\
+	for ((bkt) = 0, obj = NULL;					\
+		obj == NULL && (bkt) < __twhash_dyn_nbuckets(ht); (bkt)++) \
+			twhlist_for_each_entry_safe(obj, tmp,		\
+				__twhash_dyn_bucket_at(ht, bkt), member.node)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket.
+ * @ht: the &struct twhash_dyn to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_dyn_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_dyn_for_each_possible(ht, obj, member, key)		\
+	for (uint32_t __twh = twhash_dyn_hash(key), __twp = ((obj) = NULL, 0); \
+		(obj) == NULL && __twp < 2; __twp++)			\
+			twhlist_for_each_entry(obj,			\
+				__twhash_dyn_bucket(ht, __twh, __twp), member.node)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * safe against removals.
+ * @ht: the &struct twhash_dyn to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @tmp: struct twhlist_node* used for temporary storage
+ * @member: the name of the twhash_dyn_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_dyn_for_each_possible_safe(ht, obj, tmp, member, key)	\
+	for (uint32_t __twh = twhash_dyn_hash(key), __twp = ((obj) = NULL, 0); \
+		(obj) == NULL && __twp < 2; __twp++)			\
+			twhlist_for_each_entry_safe(obj, tmp,		\
+				__twhash_dyn_bucket(ht, __twh, __twp), member.node)
+
+
+#endif	/* TWHASH_DYN_H */
@@ -0,0 +1,113 @@
+/* @file        twhash_nulls.h
+ * @brief       Hashtable of twhlist_nulls chains.
+ * @details     Same layout as twhash.h tables, every bucket ends with a nulls
+ *              marker holding the bucket's index. Lock-free readers can thus
+ *              detect that an object they stood on was removed and reinserted
+ *              into another bucket, and retry the lookup. This allows objects
+ *              to be recycled immediately (from a pool or a slab of
+ *              type-stable memory) without waiting for a grace period, as
+ *              long as the memory itself is never returned to the system
+ *              while readers may run.
+ *              Writers must be serialized, e.g. with a lock per table.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_NULLS_H
+#define TWHASH_NULLS_H
+
+
+#include "twhash.h"
+#include "twlist_nulls.h"
+
+
+#define TWDEFINE_HASHTABLE_NULLS(name, bits) \
+	struct twhlist_nulls_head name[1 << (bits)]
+
+#define TWDECLARE_HASHTABLE_NULLS(name, bits) \
+	struct twhlist_nulls_head name[1 << (bits)]
+
+static void
+__twhash_nulls_init(struct twhlist_nulls_head *ht, size_t sz) {
+	size_t i;
+	for (i = 0; i < sz; i++)
+		TWINIT_HLIST_NULLS_HEAD(&ht[i], i);
+}
+
+/* @brief	Initialize a nulls hashtable.
+ * @details	Every bucket ends with the nulls marker of its index.
+ * @hashtable: hashtable to be initialized */
+#define twhash_nulls_init(hashtable) \
+	__twhash_nulls_init(hashtable, TWHASH_SIZE(hashtable))
+
+/* @brief	Index of the bucket for a key. */
+#define twhash_nulls_idx(hashtable, key) \
+	((unsigned long) twhash_min(key, TWHASH_BITS(hashtable)))
+
+/* @brief	Add an object to a nulls hashtable.
+ * @details	Safe against concurrent lock-free readers.
+ * @hashtable: hashtable to add to
+ * @node: the &struct twhlist_nulls_node of the object to be added
+ * @key: the key of the object to be added */
+#define twhash_nulls_add_rcu(hashtable, node, key) \
+	twhlist_nulls_add_head_rcu(node, \
+		&hashtable[twhash_nulls_idx(hashtable, key)])
+
+/* @brief	Remove an object from a nulls hashtable.
+ * @details	Safe against concurrent lock-free readers, the object can be
+ * reused right away.
+ * @node: &struct twhlist_nulls_node of the object to remove */
+static void
+twhash_nulls_del_rcu(struct twhlist_nulls_node *node) {
+	twhlist_nulls_del_init_rcu(node);
+}
+
+/* @brief	Iterate over all possible objects hashing to the same bucket.
+ * @details	After the loop ran to the end @pos holds the nulls marker, if
+ * twget_nulls_value(@pos) != twhash_nulls_idx(@name, @key) the walk left
+ * the bucket and the lookup must be restarted.
+ * @name: hashtable to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @pos: the &struct twhlist_nulls_node * to use as a loop cursor
+ * @member: the name of the twhlist_nulls_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_nulls_for_each_possible_rcu(name, obj, pos, member, key)	\
+	twhlist_nulls_for_each_entry_rcu(obj, pos,			\
+		&name[twhash_nulls_idx(name, key)], member)
+
+/* @brief	Look up an object without taking locks.
+ * @details	Evaluates to the first object in the bucket of @key for which
+ * @cond holds (@cond can refer to @obj), or NULL. A walk which ends in
+ * another bucket's nulls is restarted. With recycled objects @cond has to
+ * pin the object (e.g. take a reference) and recheck its key after that,
+ * since it may have been reused for another key in the meantime.
+ * @name: hashtable to look in
+ * @obj: the type * to use as a loop cursor and result
+ * @pos: the &struct twhlist_nulls_node * to use as a loop cursor
+ * @member: the name of the twhlist_nulls_node within the struct
+ * @key: the key of the object
+ * @cond: expression selecting the object */
+#define twhash_nulls_lookup_rcu(name, obj, pos, member, key, cond)	\
+	__extension__ ({						\
+		unsigned long __twi = twhash_nulls_idx(name, key);	\
+		for (;;)						\
+		{							\
+			twhlist_nulls_for_each_entry_rcu(obj, pos,	\
+						&name[__twi], member)	\
+				if (cond)				\
+					break;				\
+			if (!twis_a_nulls(pos))				\
+				break;					\
+			if (twget_nulls_value(pos) == __twi)		\
+			{						\
+				obj = NULL;				\
+				break;					\
+			}						\
+		}							\
+		obj; })
+
+
+#endif	/* TWHASH_NULLS_H */
@@ -0,0 +1,372 @@
+/* @file        twhash_oa.h
+ * @brief       Open addressing hashtable probed 16 slots at a time.
+ * @details     Swiss table style alternative to the chained twhash.h tables.
+ *              Slots hold pointers to struct twhash_oa_node embedded in the
+ *              objects, next to them a control byte array keeps 7 bits of
+ *              each entry's hash (or an empty/deleted marker). A lookup
+ *              compares a whole group of 16 control bytes with one SSE2
+ *              compare and only touches objects whose 7 bits match, so most
+ *              probes never leave the control array. Groups are probed
+ *              quadratically, the table is kept at most 7/8 full and grows
+ *              by doubling (a full, not incremental, rehash).
+ *              Without SSE2 the groups are matched byte by byte.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_OA_H
+#define TWHASH_OA_H
+
+
+#include "twhash.h"
+
+
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define TWHASH_OA_GROUP		16
+#define TWHASH_OA_EMPTY		((uint8_t) 0x80)
+#define TWHASH_OA_DELETED	((uint8_t) 0xfe)
+
+/* @brief	Node to embed in objects stored in a twhash_oa table.
+ * @details	Full hash is kept to rehash without the key and to filter
+ * out false 7 bit matches before the caller compares keys. */
+struct twhash_oa_node
+{
+	uint64_t	hash;
+};
+
+struct twhash_oa
+{
+	uint8_t			*ctrl;		/* capacity control bytes */
+	struct twhash_oa_node	**slots;	/* capacity entries */
+	size_t			mask;		/* capacity - 1 */
+	size_t			count;
+	size_t			growth_left;	/* empty slots we may still use */
+};
+
+/* @brief	Cursor of twhash_oa_for_each_possible. */
+struct twhash_oa_iter
+{
+	uint64_t	hash;
+	size_t		group;
+	size_t		step;
+	uint32_t	match;
+};
+
+/* @brief	Hash of the key, 7 low bits go to the control byte and the
+ * rest select the first group to probe. */
+#define twhash_oa_hash(key) twhash_mix64((uint64_t) (key))
+
+#define __twhash_oa_h1(hash) ((size_t) ((hash) >> 7))
+#define __twhash_oa_h2(hash) ((uint8_t) ((hash) & 0x7f))
+
+#ifdef __SSE2__
+static uint32_t
+__twhash_oa_match(const uint8_t *group, uint8_t h2)
+{
+	__m128i ctrl = _mm_load_si128((const __m128i *) group);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+/* Empty and deleted are the only control bytes with the top bit set. */
+static uint32_t
+__twhash_oa_match_free(const uint8_t *group)
+{
+	return _mm_movemask_epi8(_mm_load_si128((const __m128i *) group));
+}
+#else
+static uint32_t
+__twhash_oa_match(const uint8_t *group, uint8_t h2)
+{
+	uint32_t	m = 0;
+	int		i;
+
+	for (i = 0; i < TWHASH_OA_GROUP; i++)
+		if (group[i] == h2)
+			m |= 1U << i;
+	return m;
+}
+
+static uint32_t
+__twhash_oa_match_free(const uint8_t *group)
+{
+	uint32_t	m = 0;
+	int		i;
+
+	for (i = 0; i < TWHASH_OA_GROUP; i++)
+		if (group[i] & 0x80)
+			m |= 1U << i;
+	return m;
+}
+#endif
+
+static uint32_t
+__twhash_oa_match_empty(const uint8_t *group)
+{
+	return __twhash_oa_match(group, TWHASH_OA_EMPTY);
+}
+
+static size_t
+__twhash_oa_groups_mask(const struct twhash_oa *t)
+{
+	return (t->mask + 1) / TWHASH_OA_GROUP - 1;
+}
+
+/* Allocate empty arrays of @cap slots, cap is a power of 2 >= 16. */
+static int
+__twhash_oa_alloc(struct twhash_oa *t, size_t cap)
+{
+	void *ctrl;
+
+	if (posix_memalign(&ctrl, TWHASH_OA_GROUP, cap) != 0)
+		return -1;
+	t->slots = malloc(cap * sizeof(*t->slots));
+	if (!t->slots)
+	{
+		free(ctrl);
+		return -1;
+	}
+	t->ctrl = ctrl;
+	memset(t->ctrl, TWHASH_OA_EMPTY, cap);
+	t->mask = cap - 1;
+	t->count = 0;
+	t->growth_left = cap - cap / 8;
+	return 0;
+}
+
+/* @brief	Initialize open addressing hashtable.
+ * @t:		table to initialize
+ * @size:	number of entries to make room for up front
+ * @details	Returns 0 on success, -1 if memory can't be allocated. */
+static int
+twhash_oa_init(struct twhash_oa *t, size_t size)
+{
+	size_t cap = TWHASH_OA_GROUP;
+
+	while (cap - cap / 8 < size)
+		cap <<= 1;
+	return __twhash_oa_alloc(t, cap);
+}
+
+/* @brief	Release the table, objects in it are not touched. */
+static void
+twhash_oa_free(struct twhash_oa *t)
+{
+	free(t->ctrl);
+	free(t->slots);
+	t->ctrl = NULL;
+	t->slots = NULL;
+	t->count = 0;
+}
+
+/* First empty or deleted slot on the probe sequence of @hash. There is
+ * always at least one empty slot. */
+static size_t
+__twhash_oa_find_free(const struct twhash_oa *t, uint64_t hash)
+{
+	size_t		gmask = __twhash_oa_groups_mask(t);
+	size_t		g = __twhash_oa_h1(hash) & gmask, step = 0;
+	uint32_t	m;
+
+	for (;;)
+	{
+		m = __twhash_oa_match_free(t->ctrl + g * TWHASH_OA_GROUP);
+		if (m)
+			return g * TWHASH_OA_GROUP + __builtin_ctz(m);
+		step++;
+		g = (g + step) & gmask;
+	}
+}
+
+static void
+__twhash_oa_set(struct twhash_oa *t, size_t pos, struct twhash_oa_node *n)
+{
+	if (t->ctrl[pos] == TWHASH_OA_EMPTY)
+		t->growth_left--;
+	t->ctrl[pos] = __twhash_oa_h2(n->hash);
+	t->slots[pos] = n;
+	t->count++;
+}
+
+/* Move all entries into new arrays of @cap slots, drops tombstones. */
+static int
+__twhash_oa_rehash(struct twhash_oa *t, size_t cap)
+{
+	struct twhash_oa	old = *t;
+	size_t			i;
+
+	if (__twhash_oa_alloc(t, cap) != 0)
+	{
+		*t = old;
+		return -1;
+	}
+	for (i = 0; i <= old.mask; i++)
+		if (!(old.ctrl[i] & 0x80))
+			__twhash_oa_set(t, __twhash_oa_find_free(t,
+				old.slots[i]->hash), old.slots[i]);
+	free(old.ctrl);
+	free(old.slots);
+	return 0;
+}
+
+static int
+__twhash_oa_add(struct twhash_oa *t, struct twhash_oa_node *n, uint64_t hash)
+{
+	size_t pos = __twhash_oa_find_free(t, hash);
+
+	if (!t->growth_left && t->ctrl[pos] != TWHASH_OA_DELETED)
+	{
+		/* mostly tombstones, clean them up in place */
+		if (__twhash_oa_rehash(t, t->count * 2 < t->mask + 1 ?
+					t->mask + 1 : (t->mask + 1) * 2) != 0)
+			return -1;
+		pos = __twhash_oa_find_free(t, hash);
+	}
+	n->hash = hash;
+	__twhash_oa_set(t, pos, n);
+	return 0;
+}
+
+/* @brief	Add an object to an open addressing hashtable.
+ * @t: the &struct twhash_oa to add to
+ * @n: the &struct twhash_oa_node of the object to be added
+ * @key: the key of the object to be added
+ * @details	Returns 0 on success, -1 if the table had to grow and
+ * memory can't be allocated. */
+#define twhash_oa_add(t, n, key) \
+	__twhash_oa_add(t, n, twhash_oa_hash(key))
+
+/* @brief	Remove an object from an open addressing hashtable.
+ * @t: the &struct twhash_oa the object is in
+ * @n: &struct twhash_oa_node of the object to remove
+ * @details	Returns 0 on success, -1 if the object is not in the table. */
+static int
+twhash_oa_del(struct twhash_oa *t, struct twhash_oa_node *n)
+{
+	size_t		gmask = __twhash_oa_groups_mask(t);
+	size_t		g = __twhash_oa_h1(n->hash) & gmask, step, pos;
+	uint8_t		*group;
+	uint32_t	m;
+
+	for (step = 0; step <= gmask; )
+	{
+		group = t->ctrl + g * TWHASH_OA_GROUP;
+		for (m = __twhash_oa_match(group, __twhash_oa_h2(n->hash)); m;
+							m &= m - 1)
+		{
+			pos = g * TWHASH_OA_GROUP + __builtin_ctz(m);
+			if (t->slots[pos] != n)
+				continue;
+			/* lookups stop at a group with an empty slot, so if
+			 * there is one no probe sequence goes past this
+			 * group and no tombstone is needed */
+			if (__twhash_oa_match_empty(group))
+			{
+				t->ctrl[pos] = TWHASH_OA_EMPTY;
+				t->growth_left++;
+			}
+			else
+			{
+				t->ctrl[pos] = TWHASH_OA_DELETED;
+			}
+			t->count--;
+			return 0;
+		}
+		if (__twhash_oa_match_empty(group))
+			break;
+		step++;
+		g = (g + step) & gmask;
+	}
+	return -1;
+}
+
+/* Next node with the iterator's hash, NULL when there is none. */
+static struct twhash_oa_node *
+__twhash_oa_next(const struct twhash_oa *t, struct twhash_oa_iter *it)
+{
+	size_t			gmask = __twhash_oa_groups_mask(t);
+	struct twhash_oa_node	*n;
+
+	for (;;)
+	{
+		while (it->match)
+		{
+			n = t->slots[it->group * TWHASH_OA_GROUP +
+					__builtin_ctz(it->match)];
+			it->match &= it->match - 1;
+			if (n->hash == it->hash)
+				return n;
+		}
+		if (__twhash_oa_match_empty(t->ctrl + it->group * TWHASH_OA_GROUP)
+				|| it->step == gmask)
+			return NULL;
+		it->step++;
+		it->group = (it->group + it->step) & gmask;
+		it->match = __twhash_oa_match(t->ctrl +
+				it->group * TWHASH_OA_GROUP,
+				__twhash_oa_h2(it->hash));
+	}
+}
+
+static struct twhash_oa_node *
+__twhash_oa_first(const struct twhash_oa *t, struct twhash_oa_iter *it,
+							uint64_t hash)
+{
+	it->hash = hash;
+	it->group = __twhash_oa_h1(hash) & __twhash_oa_groups_mask(t);
+	it->step = 0;
+	it->match = __twhash_oa_match(t->ctrl + it->group * TWHASH_OA_GROUP,
+					__twhash_oa_h2(hash));
+	return __twhash_oa_next(t, it);
+}
+
+#define twhash_oa_entry_safe(ptr, type, member) __extension__		\
+	({ __typeof__(ptr) ____ptr = (ptr);				\
+		____ptr ? tw_container_of(____ptr, type, member) : NULL; \
+	})
+
+/* @brief	Number of objects in the table. */
+static size_t
+twhash_oa_count(const struct twhash_oa *t)
+{
+	return t->count;
+}
+
+/* @brief	Iterate over all objects whose key hashes to the same value.
+ * @t: the &struct twhash_oa to iterate
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_oa_node within the struct
+ * @key: the key of the objects to iterate over
+ * @it: struct twhash_oa_iter used for temporary storage
+ * @details	The current object may be removed with twhash_oa_del, adding
+ * objects while iterating is not allowed. */
+#define twhash_oa_for_each_possible(t, obj, member, key, it)		\
+	for (obj = twhash_oa_entry_safe(__twhash_oa_first(t, &(it),	\
+			twhash_oa_hash(key)), __typeof__(*(obj)), member); \
+		obj;							\
+		obj = twhash_oa_entry_safe(__twhash_oa_next(t, &(it)),	\
+			__typeof__(*(obj)), member))
+
+/* @brief	Iterate over an open addressing hashtable.
+ * @t: the &struct twhash_oa to iterate
+ * @bkt: size_t to use as slot loop cursor
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_oa_node within the struct
+ * @details	The current object may be removed with twhash_oa_del. */
+#define twhash_oa_for_each(t, bkt, obj, member)				\
+	for ((bkt) = 0; (bkt) <= (t)->mask; (bkt)++)			\
+		if ((t)->ctrl[bkt] & 0x80) {} else			\
+			if ((obj = tw_container_of((t)->slots[bkt],	\
+				__typeof__(*(obj)), member)), 0) {} else
+
+
+#endif	/* TWHASH_OA_H */
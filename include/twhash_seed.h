@@ -0,0 +1,53 @@
+/* @file        twhash_seed.h
+ * @brief       Random seeds of the seeded hashes.
+ * @details     twhash_seed_init needs POSIX open, read and clock_gettime, so
+ *              it lives here and twhash.h doesn't pull those headers into
+ *              every user of the tables.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_SEED_H
+#define TWHASH_SEED_H
+
+
+#include "twhash.h"
+
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+
+/* @brief	Fill @seed with random bytes.
+ * @details	Reads /dev/urandom. If that fails the seed is derived from
+ * time and addresses, which is only a fallback, and -1 is returned.
+ * Returns 0 on success. */
+static int
+twhash_seed_init(struct twhash_seed *seed) {
+	struct timespec	ts;
+	ssize_t		n = -1;
+	int		fd;
+
+	fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		n = read(fd, seed, sizeof(*seed));
+		close(fd);
+	}
+	if (n == (ssize_t) sizeof(*seed))
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	seed->k0 = twhash_mix64((uint64_t) ts.tv_nsec ^
+			((uint64_t) ts.tv_sec << 32) ^ (uintptr_t) seed);
+	seed->k1 = twhash_mix64(seed->k0 ^ (uintptr_t) &ts ^
+			(uint64_t) getpid());
+	return -1;
+}
+
+
+#endif	/* TWHASH_SEED_H */
@@ -0,0 +1,329 @@
+/* @file        twhash_sharded.h
+ * @brief       Thread-safe hashtable split into independently locked shards.
+ * @details     A key's 64 bit hash selects the shard by its high bits and the
+ *              bucket within the shard by the bits below those. Every shard
+ *              is a plain twhlist_head table with its own reader-writer lock,
+ *              on a cache line of its own, so threads using keys in different
+ *              shards neither contend on a lock nor bounce its cache line.
+ *              The API mirrors twhash_bl.h: add/del/lookup take the shard lock
+ *              themselves, the _locked variants and the for_each_possible
+ *              iterators expect the caller to hold it.
+ *              Tables don't resize, size the shards for the expected number
+ *              of objects.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_SHARDED_H
+#define TWHASH_SHARDED_H
+
+
+#include "twhash.h"
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+
+struct twhash_shard
+{
+	pthread_rwlock_t	lock;
+	struct twhlist_head	*buckets;
+	size_t			count;
+} __attribute__((aligned(TWCACHELINE_SIZE)));
+
+struct twhash_sharded
+{
+	struct twhash_shard	*shards;
+	unsigned int		shard_bits;	/* 2^shard_bits shards */
+	unsigned int		bits;		/* 2^bits buckets per shard */
+};
+
+/* @brief	Initialize a sharded hashtable.
+ * @t:		the table
+ * @shard_bits:	log2 of the number of shards
+ * @bits:	log2 of the number of buckets in each shard
+ * @details	shard_bits + bits must not exceed 32. Returns 0 on success,
+ * -1 on error. */
+static int
+twhash_sharded_init(struct twhash_sharded *t, unsigned int shard_bits,
+							unsigned int bits)
+{
+	struct twhash_shard	*s;
+	size_t			i, n = (size_t) 1 << shard_bits;
+
+	if (bits == 0 || shard_bits + bits > 32)
+		return -1;
+	if (posix_memalign((void **) &t->shards, TWCACHELINE_SIZE,
+					n * sizeof(*t->shards)) != 0)
+		return -1;
+	for (i = 0; i < n; i++)
+	{
+		s = &t->shards[i];
+		s->buckets = malloc(sizeof(*s->buckets) << bits);
+		if (!s->buckets)
+			goto fail;
+		if (pthread_rwlock_init(&s->lock, NULL) != 0)
+		{
+			free(s->buckets);
+			goto fail;
+		}
+		__twhash_init(s->buckets, (size_t) 1 << bits);
+		s->count = 0;
+	}
+	t->shard_bits = shard_bits;
+	t->bits = bits;
+	return 0;
+
+fail:
+	while (i--)
+	{
+		pthread_rwlock_destroy(&t->shards[i].lock);
+		free(t->shards[i].buckets);
+	}
+	free(t->shards);
+	t->shards = NULL;
+	return -1;
+}
+
+/* @brief	Release the table.
+ * @details	Objects still in the table are not touched, no other thread
+ * may use the table at this point. */
+static void
+twhash_sharded_free(struct twhash_sharded *t)
+{
+	size_t i;
+
+	for (i = 0; i < (size_t) 1 << t->shard_bits; i++)
+	{
+		pthread_rwlock_destroy(&t->shards[i].lock);
+		free(t->shards[i].buckets);
+	}
+	free(t->shards);
+	t->shards = NULL;
+}
+
+/* Shard of @key, from the top shard_bits of its hash. */
+static struct twhash_shard *
+__twhash_sharded_shard(struct twhash_sharded *t, uint64_t key)
+{
+	if (!t->shard_bits)
+		return t->shards;
+	return &t->shards[twhash_mix64(key) >> (64 - t->shard_bits)];
+}
+
+/* Bucket of @key, from the bits of its hash below the shard bits. */
+static struct twhlist_head *
+__twhash_sharded_bucket(struct twhash_sharded *t, struct twhash_shard *s,
+							uint64_t key)
+{
+	return &s->buckets[(twhash_mix64(key) << t->shard_bits) >>
+							(64 - t->bits)];
+}
+
+/* @brief	Lock the shard of @key for reading. */
+static void
+twhash_sharded_read_lock(struct twhash_sharded *t, uint64_t key)
+{
+	pthread_rwlock_rdlock(&__twhash_sharded_shard(t, key)->lock);
+}
+
+/* @brief	Lock the shard of @key for writing. */
+static void
+twhash_sharded_write_lock(struct twhash_sharded *t, uint64_t key)
+{
+	pthread_rwlock_wrlock(&__twhash_sharded_shard(t, key)->lock);
+}
+
+/* @brief	Unlock the shard of @key, locked for reading or writing. */
+static void
+twhash_sharded_unlock(struct twhash_sharded *t, uint64_t key)
+{
+	pthread_rwlock_unlock(&__twhash_sharded_shard(t, key)->lock);
+}
+
+/* @brief	Add an object, shard already write locked.
+ * @t: table to add to
+ * @node: the &struct twhlist_node of the object to be added
+ * @key: the key of the object to be added */
+static void
+twhash_sharded_add_locked(struct twhash_sharded *t, struct twhlist_node *node,
+							uint64_t key)
+{
+	struct twhash_shard *s = __twhash_sharded_shard(t, key);
+
+	twhlist_add_head(node, __twhash_sharded_bucket(t, s, key));
+	s->count++;
+}
+
+/* @brief	Add an object.
+ * @details	Takes and releases the shard lock.
+ * @t: table to add to
+ * @node: the &struct twhlist_node of the object to be added
+ * @key: the key of the object to be added */
+static void
+twhash_sharded_add(struct twhash_sharded *t, struct twhlist_node *node,
+							uint64_t key)
+{
+	struct twhash_shard *s = __twhash_sharded_shard(t, key);
+
+	pthread_rwlock_wrlock(&s->lock);
+	twhlist_add_head(node, __twhash_sharded_bucket(t, s, key));
+	s->count++;
+	pthread_rwlock_unlock(&s->lock);
+}
+
+/* @brief	Remove an object, shard already write locked.
+ * @details	Removing an object that is not hashed is a no-op.
+ * @t: table the object is in
+ * @node: &struct twhlist_node of the object to remove
+ * @key: the key of the object */
+static void
+twhash_sharded_del_locked(struct twhash_sharded *t, struct twhlist_node *node,
+							uint64_t key)
+{
+	if (twhlist_unhashed(node))
+		return;
+	twhlist_del_init(node);
+	__twhash_sharded_shard(t, key)->count--;
+}
+
+/* @brief	Remove an object.
+ * @details	Takes and releases the shard lock. The key is needed to find
+ * the shard the object lives in. Removing an object that is not hashed
+ * is a no-op.
+ * @t: table the object is in
+ * @node: &struct twhlist_node of the object to remove
+ * @key: the key of the object */
+static void
+twhash_sharded_del(struct twhash_sharded *t, struct twhlist_node *node,
+							uint64_t key)
+{
+	struct twhash_shard *s = __twhash_sharded_shard(t, key);
+
+	pthread_rwlock_wrlock(&s->lock);
+	if (!twhlist_unhashed(node))
+	{
+		twhlist_del_init(node);
+		s->count--;
+	}
+	pthread_rwlock_unlock(&s->lock);
+}
+
+/* @brief	Iterate over all possible objects hashing to the same bucket.
+ * @details	Shard must be locked with twhash_sharded_read_lock or
+ * twhash_sharded_write_lock.
+ * @t: pointer to the table
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_sharded_for_each_possible(t, obj, member, key)		\
+	__twhash_for_each_chain(obj, __twhash_sharded_bucket(t,		\
+			__twhash_sharded_shard(t, key), key), member)
+
+/* @brief	Iterate over all possible objects hashing to the same bucket
+ * safe against removals.
+ * @details	Shard must be locked with twhash_sharded_write_lock.
+ * @t: pointer to the table
+ * @obj: the type * to use as a loop cursor for each entry
+ * @tmp: a &struct twhlist_node used for temporary storage
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_sharded_for_each_possible_safe(t, obj, tmp, member, key)	\
+	twhlist_for_each_entry_safe(obj, tmp, __twhash_sharded_bucket(t,\
+			__twhash_sharded_shard(t, key), key), member)
+
+/* @brief	Look up an object under the shard's read lock.
+ * @details	Evaluates to the first object in the bucket of @key for which
+ * @cond holds (@cond can refer to @obj), or NULL. The lock is released
+ * before returning, so the caller needs some other way (e.g. a reference
+ * count taken in @cond) to keep the object alive.
+ * @t: pointer to the table
+ * @obj: the type * to use as a loop cursor and result
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the object
+ * @cond: expression selecting the object */
+#define twhash_sharded_lookup(t, obj, member, key, cond) __extension__	\
+	({ uint64_t __twk = (key);					\
+		struct twhash_shard *__s = __twhash_sharded_shard(t, __twk);\
+		pthread_rwlock_rdlock(&__s->lock);			\
+		__twhash_for_each_chain(obj,				\
+			__twhash_sharded_bucket(t, __s, __twk), member)	\
+			if (cond)					\
+				break;					\
+		pthread_rwlock_unlock(&__s->lock);			\
+		obj; })
+
+/* @brief	Look up an object and remove it from the table.
+ * @details	Like twhash_sharded_lookup, under the write lock. Evaluates
+ * to the removed object, now owned by the caller, or NULL.
+ * @t: pointer to the table
+ * @obj: the type * to use as a loop cursor and result
+ * @member: the name of the twhlist_node within the struct
+ * @key: the key of the object
+ * @cond: expression selecting the object */
+#define twhash_sharded_remove(t, obj, member, key, cond) __extension__	\
+	({ uint64_t __twk = (key);					\
+		struct twhash_shard *__s = __twhash_sharded_shard(t, __twk);\
+		pthread_rwlock_wrlock(&__s->lock);			\
+		twhlist_for_each_entry(obj,				\
+			__twhash_sharded_bucket(t, __s, __twk), member)	\
+			if (cond)					\
+				break;					\
+		if (obj && !twhlist_unhashed(&(obj)->member))		\
+		{							\
+			twhlist_del_init(&(obj)->member);		\
+			__s->count--;					\
+		}							\
+		pthread_rwlock_unlock(&__s->lock);			\
+		obj; })
+
+/* @brief	Call @fn on every object in the table.
+ * @details	Shards are visited one after another, each under its read
+ * lock, so @fn must not modify the table. The walk stops when @fn returns
+ * non-zero, and that value is returned. Objects added or removed in other
+ * shards during the walk may or may not be seen.
+ * @t: the table
+ * @fn: callback, gets the object's node and @priv
+ * @priv: passed to @fn */
+static int
+twhash_sharded_for_each(struct twhash_sharded *t,
+		int (*fn)(struct twhlist_node *node, void *priv), void *priv)
+{
+	struct twhash_shard	*s;
+	struct twhlist_node	*node;
+	size_t			i, b;
+	int			ret = 0;
+
+	for (i = 0; i < (size_t) 1 << t->shard_bits && !ret; i++)
+	{
+		s = &t->shards[i];
+		pthread_rwlock_rdlock(&s->lock);
+		for (b = 0; b < (size_t) 1 << t->bits && !ret; b++)
+			for (node = s->buckets[b].first; node && !ret;
+							node = node->next)
+				ret = fn(node, priv);
+		pthread_rwlock_unlock(&s->lock);
+	}
+	return ret;
+}
+
+/* @brief	Number of objects in the table.
+ * @details	Shards are read one after another, the result may be stale
+ * if other threads modify the table. */
+static size_t
+twhash_sharded_count(struct twhash_sharded *t)
+{
+	size_t count = 0, i;
+
+	for (i = 0; i < (size_t) 1 << t->shard_bits; i++)
+		count += TWREAD_ONCE(t->shards[i].count);
+	return count;
+}
+
+
+#endif	/* TWHASH_SHARDED_H */
@@ -0,0 +1,419 @@
+/* @file        twhash_shm.h
+ * @brief       Hashtable in a POSIX shared memory segment, shared by
+ *              processes.
+ * @details     A twhash_bl style table whose buckets, chains and objects
+ *              all live in one shm_open segment, so any number of processes
+ *              can map it, at different addresses, and share one copy of
+ *              the table. Links are byte offsets from the start of the
+ *              segment instead of pointers; offset 0, the header, is the
+ *              NULL of offsets. twhash_shm_ptr and twhash_shm_off convert
+ *              between the two in each process.
+ *              Bit 0 of every bucket word is a spinlock protecting its
+ *              chain, as in twlist_bl. It is taken with atomic operations
+ *              on the shared memory, which work across processes the same
+ *              as across threads. A process dying with a bucket locked
+ *              leaves it locked.
+ *              Objects are allocated from the segment with twhash_shm_alloc,
+ *              a bump allocator: a compare-and-swap on the break, no free. The
+ *              segment is sized at creation and doesn't grow.
+ *              Keys are uint64_t hashed with twhash_64, the same in every
+ *              process. On glibc older than 2.34 link with -lrt.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_SHM_H
+#define TWHASH_SHM_H
+
+
+#include "twhash.h"
+#include "twlist_bl.h"
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+#define TWHASH_SHM_MAGIC	0x31304d4853485754ULL	/* "TWHSHM01" */
+#define TWHASH_SHM_VERSION	1
+
+/* Allocations are aligned to this, so bit 0 of an offset is always clear. */
+#define TWHASH_SHM_ALIGN	16
+
+#define TWHASH_SHM_LOCKMASK	1ULL
+
+#define __TWHASH_SHM_ROUND(x) \
+	(((x) + TWHASH_SHM_ALIGN - 1) & ~((uint64_t) TWHASH_SHM_ALIGN - 1))
+
+struct twhash_shm_hdr
+{
+	uint64_t	magic;		/* set last, by the creator */
+	uint32_t	version;
+	uint32_t	bits;
+	uint64_t	size;		/* size of the segment */
+	uint64_t	buckets;	/* offset of the bucket words */
+	uint64_t	brk;		/* offset of the first free byte */
+	uint64_t	count;		/* number of hashed objects */
+};
+
+/* Embed in the object, like twhlist_bl_node. */
+struct twhash_shm_node
+{
+	uint64_t	next;		/* offset of the next node, 0 ends */
+	uint64_t	pprev;		/* offset of the word linking to us */
+};
+
+/* A process' view of a segment. */
+struct twhash_shm
+{
+	char			*base;
+	size_t			size;
+	struct twhash_shm_hdr	*hdr;
+	uint64_t		*buckets;
+	unsigned int		bits;
+};
+
+/* @brief	Pointer to offset @off of the segment, NULL for 0. */
+static void *
+twhash_shm_ptr(const struct twhash_shm *t, uint64_t off)
+{
+	return off ? t->base + off : NULL;
+}
+
+/* @brief	Offset of @p in the segment, 0 for NULL. */
+static uint64_t
+twhash_shm_off(const struct twhash_shm *t, const void *p)
+{
+	return p ? (uint64_t) ((const char *) p - t->base) : 0;
+}
+
+#define twhash_shm_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+/* @brief	Get the object of node offset @off, NULL for 0. */
+#define twhash_shm_entry_or_null(t, off, type, member) __extension__	\
+	({ uint64_t ____off = (off);					\
+		____off ? twhash_shm_entry((struct twhash_shm_node *)	\
+			twhash_shm_ptr(t, ____off), type, member) : NULL; })
+
+static int
+__twhash_shm_map(struct twhash_shm *t, int fd, size_t size)
+{
+	void *p;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		return -1;
+	t->base = (char *) p;
+	t->size = size;
+	t->hdr = (struct twhash_shm_hdr *) p;
+	return 0;
+}
+
+/* @brief	Create a segment holding an empty table.
+ * @t:		process' view, set on success
+ * @name:	shm_open name, "/name"; must not exist yet
+ * @bits:	number of bits of the bucket index
+ * @size:	size of the segment; the header and the 2^@bits bucket words
+ *		come out of it, the rest is for objects
+ * @details	Returns 0 on success, -1 on error, then nothing is left
+ * behind. */
+static int
+twhash_shm_create(struct twhash_shm *t, const char *name, unsigned int bits,
+								size_t size)
+{
+	uint64_t	heap;
+	int		fd;
+
+	if (bits == 0 || bits > 32)
+		return -1;
+	heap = __TWHASH_SHM_ROUND(__TWHASH_SHM_ROUND(
+				sizeof(struct twhash_shm_hdr)) +
+				((uint64_t) 1 << bits) * sizeof(uint64_t));
+	if (size < heap)
+		return -1;
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return -1;
+	if (ftruncate(fd, (off_t) size) != 0 ||
+				__twhash_shm_map(t, fd, size) != 0)
+	{
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+	close(fd);
+
+	/* the segment comes zeroed, so are the buckets */
+	t->hdr->version = TWHASH_SHM_VERSION;
+	t->hdr->bits = bits;
+	t->hdr->size = size;
+	t->hdr->buckets = __TWHASH_SHM_ROUND(sizeof(struct twhash_shm_hdr));
+	t->hdr->brk = heap;
+	t->hdr->count = 0;
+	t->buckets = (uint64_t *) (t->base + t->hdr->buckets);
+	t->bits = bits;
+	__atomic_store_n(&t->hdr->magic, TWHASH_SHM_MAGIC, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* @brief	Map a segment created by twhash_shm_create.
+ * @details	Returns 0 on success, -1 if it doesn't exist, can't be mapped
+ * or its creator hasn't finished initializing it yet (try again later). */
+static int
+twhash_shm_open(struct twhash_shm *t, const char *name)
+{
+	struct stat	st;
+	int		fd;
+
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) != 0 ||
+		(size_t) st.st_size < sizeof(struct twhash_shm_hdr) ||
+			__twhash_shm_map(t, fd, (size_t) st.st_size) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	if (__atomic_load_n(&t->hdr->magic, __ATOMIC_ACQUIRE) !=
+						TWHASH_SHM_MAGIC ||
+			t->hdr->version != TWHASH_SHM_VERSION ||
+			t->hdr->size != t->size)
+	{
+		munmap(t->base, t->size);
+		return -1;
+	}
+	t->buckets = (uint64_t *) (t->base + t->hdr->buckets);
+	t->bits = t->hdr->bits;
+	return 0;
+}
+
+/* @brief	Unmap a segment from this process.
+ * @details	The segment lives on until twhash_shm_unlink and the last
+ * process closing it. */
+static void
+twhash_shm_close(struct twhash_shm *t)
+{
+	munmap(t->base, t->size);
+	t->base = NULL;
+	t->hdr = NULL;
+	t->buckets = NULL;
+}
+
+/* @brief	Remove the name of a segment, returns 0 or -1. */
+static int
+twhash_shm_unlink(const char *name)
+{
+	return shm_unlink(name);
+}
+
+/* @brief	Allocate @size bytes from the segment.
+ * @details	Safe from any process and thread at once. Returns NULL when
+ * the segment is full. The memory is zeroed the first time and is never
+ * given back. */
+static void *
+twhash_shm_alloc(struct twhash_shm *t, size_t size)
+{
+	uint64_t len = __TWHASH_SHM_ROUND((uint64_t) size);
+	uint64_t off = __atomic_load_n(&t->hdr->brk, __ATOMIC_RELAXED);
+
+	do {
+		if (len > t->size - off)
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&t->hdr->brk, &off, off + len,
+				1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return t->base + off;
+}
+
+/* @brief	Bytes of the segment not allocated yet. */
+static size_t
+twhash_shm_avail(const struct twhash_shm *t)
+{
+	return t->size - __atomic_load_n(&t->hdr->brk, __ATOMIC_RELAXED);
+}
+
+/* @brief	Number of objects in the table.
+ * @details	May be stale by the time it is returned. */
+static size_t
+twhash_shm_count(const struct twhash_shm *t)
+{
+	return __atomic_load_n(&t->hdr->count, __ATOMIC_RELAXED);
+}
+
+/* @brief	Get the bucket word for a key. */
+static uint64_t *
+twhash_shm_bucket(const struct twhash_shm *t, uint64_t key)
+{
+	return &t->buckets[twhash_64(key, t->bits)];
+}
+
+/* @brief	Lock a bucket.
+ * @details	Spins reading the word until the bit is clear before trying
+ * to set it again, as twhlist_bl_lock does. */
+static void
+__twhash_shm_lock(uint64_t *b)
+{
+	uint64_t old;
+
+	for (;;)
+	{
+		old = __atomic_load_n(b, __ATOMIC_RELAXED);
+		if (!(old & TWHASH_SHM_LOCKMASK) &&
+			__atomic_compare_exchange_n(b, &old,
+				old | TWHASH_SHM_LOCKMASK, 1,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+		twcpu_relax();
+	}
+}
+
+static void
+__twhash_shm_unlock(uint64_t *b)
+{
+	__atomic_store_n(b, __atomic_load_n(b, __ATOMIC_RELAXED) &
+				~TWHASH_SHM_LOCKMASK, __ATOMIC_RELEASE);
+}
+
+/* @brief	Lock the bucket of @key. */
+#define twhash_shm_lock(t, key) __twhash_shm_lock(twhash_shm_bucket(t, key))
+
+/* @brief	Unlock the bucket of @key. */
+#define twhash_shm_unlock(t, key) \
+	__twhash_shm_unlock(twhash_shm_bucket(t, key))
+
+/* @brief	Offset of the first node of a locked bucket. */
+static uint64_t
+twhash_shm_first(const uint64_t *b)
+{
+	return __atomic_load_n(b, __ATOMIC_RELAXED) & ~TWHASH_SHM_LOCKMASK;
+}
+
+/* Store @off into the word at offset @at, keeping the lock bit if @at is a
+ * bucket word, as twhlist_bl_del does. */
+static void
+__twhash_shm_link(struct twhash_shm *t, uint64_t at, uint64_t off)
+{
+	uint64_t *w = (uint64_t *) (t->base + at);
+
+	__atomic_store_n(w, off | (__atomic_load_n(w, __ATOMIC_RELAXED) &
+				TWHASH_SHM_LOCKMASK), __ATOMIC_RELAXED);
+}
+
+/* @brief	Add a node to the front of a locked bucket. */
+static void
+__twhash_shm_add_locked(struct twhash_shm *t, uint64_t *b,
+					struct twhash_shm_node *n)
+{
+	uint64_t off = twhash_shm_off(t, n);
+	uint64_t first = twhash_shm_first(b);
+
+	n->next = first;
+	n->pprev = twhash_shm_off(t, b);
+	if (first)
+		((struct twhash_shm_node *) twhash_shm_ptr(t, first))->pprev =
+			off + offsetof(struct twhash_shm_node, next);
+	__twhash_shm_link(t, n->pprev, off);
+	__atomic_add_fetch(&t->hdr->count, 1, __ATOMIC_RELAXED);
+}
+
+/* @brief	Unlink a node from its locked bucket. */
+static void
+twhash_shm_del_locked(struct twhash_shm *t, struct twhash_shm_node *n)
+{
+	if (!n->pprev)
+		return;
+	__twhash_shm_link(t, n->pprev, n->next);
+	if (n->next)
+		((struct twhash_shm_node *) twhash_shm_ptr(t, n->next))->pprev =
+								n->pprev;
+	n->next = 0;
+	n->pprev = 0;
+	__atomic_sub_fetch(&t->hdr->count, 1, __ATOMIC_RELAXED);
+}
+
+static void
+__twhash_shm_add(struct twhash_shm *t, uint64_t *b, struct twhash_shm_node *n)
+{
+	__twhash_shm_lock(b);
+	__twhash_shm_add_locked(t, b, n);
+	__twhash_shm_unlock(b);
+}
+
+static void
+__twhash_shm_del(struct twhash_shm *t, uint64_t *b, struct twhash_shm_node *n)
+{
+	__twhash_shm_lock(b);
+	twhash_shm_del_locked(t, n);
+	__twhash_shm_unlock(b);
+}
+
+/* @brief	Add an object to the table.
+ * @details	Takes and releases the bucket lock. The object must have
+ * been allocated with twhash_shm_alloc.
+ * @t: the table
+ * @node: the &struct twhash_shm_node of the object to be added
+ * @key: the key of the object to be added */
+#define twhash_shm_add(t, node, key) \
+	__twhash_shm_add(t, twhash_shm_bucket(t, key), node)
+
+/* @brief	Add an object to the table, bucket already locked. */
+#define twhash_shm_add_locked(t, node, key) \
+	__twhash_shm_add_locked(t, twhash_shm_bucket(t, key), node)
+
+/* @brief	Remove an object from the table.
+ * @details	Takes and releases the bucket lock. The key is needed to find
+ * the bucket the object lives in. The memory is not reclaimed. */
+#define twhash_shm_del(t, node, key) \
+	__twhash_shm_del(t, twhash_shm_bucket(t, key), node)
+
+/* @brief	Check whether an object is in the table. */
+static int
+twhash_shm_hashed(const struct twhash_shm_node *n)
+{
+	return n->pprev != 0;
+}
+
+/* @brief	Iterate over all possible objects hashing to the same bucket.
+ * @details	Bucket must be locked with twhash_shm_lock.
+ * @t: the table
+ * @obj: the type * to use as a loop cursor for each entry
+ * @member: the name of the twhash_shm_node within the struct
+ * @key: the key of the objects to iterate over */
+#define twhash_shm_for_each_possible(t, obj, member, key)		\
+	__twhash_shm_for_each_bucket(t, obj, member, twhash_shm_bucket(t, key))
+
+#define __twhash_shm_for_each_bucket(t, obj, member, b)			\
+	for (obj = twhash_shm_entry_or_null(t, twhash_shm_first(b),	\
+			__typeof__(*(obj)), member);			\
+		obj;							\
+		obj = twhash_shm_entry_or_null(t, (obj)->member.next,	\
+			__typeof__(*(obj)), member))
+
+/* @brief	Look up an object under the bucket lock.
+ * @details	Evaluates to the first object in the bucket of @key for which
+ * @cond holds (@cond can refer to @obj), or NULL. The bucket lock is
+ * released before returning, as in twhash_bl_lookup.
+ * @t: the table
+ * @obj: the type * to use as a loop cursor and result
+ * @member: the name of the twhash_shm_node within the struct
+ * @key: the key of the object
+ * @cond: expression selecting the object */
+#define twhash_shm_lookup(t, obj, member, key, cond) __extension__	\
+	({ uint64_t *__b = twhash_shm_bucket(t, key);			\
+		__twhash_shm_lock(__b);					\
+		__twhash_shm_for_each_bucket(t, obj, member, __b)	\
+			if (cond)					\
+				break;					\
+		__twhash_shm_unlock(__b);				\
+		obj; })
+
+
+#endif	/* TWHASH_SHM_H */
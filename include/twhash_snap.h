@@ -0,0 +1,371 @@
+/* @file        twhash_snap.h
+ * @brief       Relocatable hashtable snapshot, mapped from a file.
+ * @details     twhash_snap_save writes a twhash table to a file in which
+ *              buckets and chains are byte offsets from the start of the
+ *              file instead of twhlist_node pointers. twhash_snap_open maps
+ *              the file read-only and it can be searched right away, at any
+ *              address, with no fix-up pass: opening costs the same for
+ *              any table size and pages are faulted in as lookups touch
+ *              them.
+ *              The file holds a header, 2^bits bucket offsets and one record
+ *              per object. A record is the next record's offset, the key and
+ *              a copy of the object; records of one bucket are stored one
+ *              after another so a chain is read sequentially. Offset 0, the
+ *              header, ends a chain.
+ *              Keys are uint64_t members of the objects hashed with
+ *              twhash_64, independent of the table the snapshot was taken
+ *              from. Objects are copied byte by byte, so pointers inside
+ *              them are meaningless in the snapshot (the twhlist_node is
+ *              zeroed). The file is read by the same architecture which
+ *              wrote it and is trusted, only its header is checked.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHASH_SNAP_H
+#define TWHASH_SNAP_H
+
+
+#include "twhash.h"
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+#define TWHASH_SNAP_MAGIC	0x3150414e53485754ULL	/* "TWHSNAP1" */
+#define TWHASH_SNAP_VERSION	1
+
+/* Records, and so the copies of objects, are aligned to this. */
+#define TWHASH_SNAP_ALIGN	16
+
+struct twhash_snap_hdr
+{
+	uint64_t	magic;
+	uint32_t	version;
+	uint32_t	bits;
+	uint64_t	count;		/* number of records */
+	uint64_t	obj_size;	/* size of the copied object */
+	uint64_t	rec_size;	/* size of a record, aligned */
+	uint64_t	buckets;	/* offset of the bucket array */
+	uint64_t	size;		/* size of the file */
+	uint64_t	reserved;
+};
+
+struct twhash_snap_rec
+{
+	uint64_t	next;		/* offset of the next record, 0 ends */
+	uint64_t	key;
+	/* followed by the object */
+};
+
+struct twhash_snap
+{
+	const char			*base;
+	size_t				size;
+	const uint64_t			*buckets;
+	unsigned int			bits;
+	size_t				count;
+};
+
+#define __TWHASH_SNAP_ROUND(x) \
+	(((x) + TWHASH_SNAP_ALIGN - 1) & ~((uint64_t) TWHASH_SNAP_ALIGN - 1))
+
+/* Offset of the records of bucket 0, right after the bucket array. */
+static uint64_t
+__twhash_snap_recs(unsigned int bits)
+{
+	return __TWHASH_SNAP_ROUND(sizeof(struct twhash_snap_hdr) +
+					((uint64_t) 1 << bits) * sizeof(uint64_t));
+}
+
+/* Write the snapshot into the mapped file @p. First every record's bucket is
+ * counted, then each bucket gets a contiguous run of records. @cur is
+ * scratch space of 2^bits offsets. */
+static void
+__twhash_snap_fill(char *p, uint64_t *cur, struct twhlist_head *ht,
+		size_t sz, unsigned int bits, size_t node_off, size_t key_off,
+		size_t size, uint64_t rec_size)
+{
+	struct twhash_snap_hdr	*hdr = (struct twhash_snap_hdr *) p;
+	uint64_t		*buckets = (uint64_t *) (p + hdr->buckets);
+	uint64_t		b, off, key, end;
+	struct twhlist_node	*n;
+	struct twhash_snap_rec	*rec;
+	size_t			i, nb = (size_t) 1 << bits;
+
+	memset(cur, 0, nb * sizeof(*cur));
+	for (i = 0; i < sz; i++)
+		for (n = ht[i].first; n; n = n->next)
+		{
+			memcpy(&key, (char *) n - node_off + key_off,
+							sizeof(key));
+			cur[twhash_64(key, bits)]++;
+		}
+
+	/* cur[b] becomes the offset of bucket b's first free record */
+	off = __twhash_snap_recs(bits);
+	for (b = 0; b < nb; b++)
+	{
+		end = off + cur[b] * rec_size;
+		buckets[b] = cur[b] ? off : 0;
+		cur[b] = off;
+		off = end;
+	}
+
+	for (i = 0; i < sz; i++)
+		for (n = ht[i].first; n; n = n->next)
+		{
+			memcpy(&key, (char *) n - node_off + key_off,
+							sizeof(key));
+			b = twhash_64(key, bits);
+			rec = (struct twhash_snap_rec *) (p + cur[b]);
+			cur[b] += rec_size;
+			rec->next = cur[b];
+			rec->key = key;
+			memcpy(rec + 1, (char *) n - node_off, size);
+			memset((char *) (rec + 1) + node_off, 0,
+						sizeof(struct twhlist_node));
+		}
+
+	/* terminate the chains, the last record of a run points past it */
+	for (b = 0; b < nb; b++)
+	{
+		if (!buckets[b])
+			continue;
+		rec = (struct twhash_snap_rec *) (p + cur[b] - rec_size);
+		rec->next = 0;
+	}
+}
+
+/* @brief	Write a snapshot of a hashtable to a file.
+ * @path:	file to write, replaced atomically through @path.tmp
+ * @ht:		the hashtable
+ * @sz:		number of buckets of @ht
+ * @bits:	number of bits of the snapshot's bucket index
+ * @node_off:	offset of the twhlist_node in the object
+ * @key_off:	offset of the uint64_t key in the object
+ * @size:	size of the object
+ * @details	Returns 0 on success, -1 on error with errno set. */
+static int
+__twhash_snap_save(const char *path, struct twhlist_head *ht, size_t sz,
+		unsigned int bits, size_t node_off, size_t key_off, size_t size)
+{
+	struct twhash_snap_hdr	*hdr;
+	struct twhlist_node	*n;
+	uint64_t		*cur = NULL, count = 0, rec_size, fsize;
+	char			*tmp, *p = MAP_FAILED;
+	size_t			i, len = strlen(path);
+	int			fd = -1, ret = -1, err;
+
+	if (bits == 0 || bits > 32)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	for (i = 0; i < sz; i++)
+		for (n = ht[i].first; n; n = n->next)
+			count++;
+	rec_size = __TWHASH_SNAP_ROUND(sizeof(struct twhash_snap_rec) + size);
+	fsize = __twhash_snap_recs(bits) + count * rec_size;
+
+	tmp = malloc(len + sizeof(".tmp"));
+	cur = malloc(((size_t) 1 << bits) * sizeof(*cur));
+	if (!tmp || !cur)
+	{
+		errno = ENOMEM;
+		goto out;
+	}
+	memcpy(tmp, path, len);
+	memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+	fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		goto out;
+	if (ftruncate(fd, (off_t) fsize) != 0)
+		goto out_unlink;
+	p = mmap(NULL, fsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		goto out_unlink;
+
+	hdr = (struct twhash_snap_hdr *) p;
+	hdr->version = TWHASH_SNAP_VERSION;
+	hdr->bits = bits;
+	hdr->count = count;
+	hdr->obj_size = size;
+	hdr->rec_size = rec_size;
+	hdr->buckets = sizeof(*hdr);
+	hdr->size = fsize;
+	__twhash_snap_fill(p, cur, ht, sz, bits, node_off, key_off, size,
+								rec_size);
+	/* a torn file has no magic */
+	if (msync(p, fsize, MS_SYNC) != 0)
+		goto out_unlink;
+	hdr->magic = TWHASH_SNAP_MAGIC;
+	if (msync(p, sizeof(*hdr), MS_SYNC) != 0 || rename(tmp, path) != 0)
+		goto out_unlink;
+	ret = 0;
+	goto out;
+
+out_unlink:
+	err = errno;
+	unlink(tmp);
+	errno = err;
+out:
+	err = errno;
+	if (p != MAP_FAILED)
+		munmap(p, fsize);
+	if (fd >= 0)
+		close(fd);
+	free(cur);
+	free(tmp);
+	/* cleanup doesn't hide why we failed */
+	errno = err;
+	return ret;
+}
+
+/* @brief	Write a snapshot of a hashtable to a file.
+ * @path:	file to write
+ * @hashtable:	the hashtable, an array of buckets
+ * @bits:	number of bits of the snapshot's bucket index
+ * @type:	the type of the objects
+ * @member:	the name of the twhlist_node within the type
+ * @key:	the name of the uint64_t key within the type
+ * @details	Returns 0 on success, -1 on error. */
+#define twhash_snap_save(path, hashtable, bits, type, member, key)	\
+	__twhash_snap_save(path, hashtable, TWHASH_SIZE(hashtable), bits,	\
+			offsetof(type, member), offsetof(type, key),	\
+			sizeof(type))
+
+/* @brief	Same as twhash_snap_save for a table of 2^@tbits buckets,
+ * e.g. allocated at runtime. */
+#define twhash_snap_save_bits(path, hashtable, tbits, bits, type, member, key)\
+	__twhash_snap_save(path, hashtable, (size_t) 1 << (tbits), bits,	\
+			offsetof(type, member), offsetof(type, key),	\
+			sizeof(type))
+
+/* @brief	Map a snapshot.
+ * @details	Checks the header only, the cost doesn't depend on the size
+ * of the table. Returns 0 on success, -1 if the file can't be mapped or is
+ * not a complete snapshot. */
+static int
+twhash_snap_open(struct twhash_snap *s, const char *path)
+{
+	const struct twhash_snap_hdr	*hdr;
+	struct stat			st;
+	void				*p;
+	int				fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) != 0 ||
+			(size_t) st.st_size < sizeof(struct twhash_snap_hdr))
+	{
+		close(fd);
+		return -1;
+	}
+	p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return -1;
+
+	hdr = (const struct twhash_snap_hdr *) p;
+	if (hdr->magic != TWHASH_SNAP_MAGIC ||
+			hdr->version != TWHASH_SNAP_VERSION ||
+			hdr->bits == 0 || hdr->bits > 32 ||
+			hdr->size != (uint64_t) st.st_size ||
+			hdr->buckets != sizeof(*hdr) ||
+			__twhash_snap_recs(hdr->bits) +
+				hdr->count * hdr->rec_size != hdr->size)
+	{
+		munmap(p, (size_t) st.st_size);
+		return -1;
+	}
+	s->base = (const char *) p;
+	s->size = (size_t) st.st_size;
+	s->buckets = (const uint64_t *) (s->base + hdr->buckets);
+	s->bits = hdr->bits;
+	s->count = hdr->count;
+	return 0;
+}
+
+/* @brief	Unmap a snapshot. */
+static void
+twhash_snap_close(struct twhash_snap *s)
+{
+	munmap((void *) s->base, s->size);
+	s->base = NULL;
+	s->size = 0;
+}
+
+/* @brief	Ask the kernel to read the whole snapshot in ahead of use.
+ * @details	Optional, lookups work without it. Returns 0 or -1. */
+static int
+twhash_snap_willneed(struct twhash_snap *s)
+{
+	return madvise((void *) s->base, s->size, MADV_WILLNEED);
+}
+
+/* @brief	Number of objects in a snapshot. */
+static size_t
+twhash_snap_count(const struct twhash_snap *s)
+{
+	return s->count;
+}
+
+/* @brief	The record at offset @off, NULL for 0. */
+static const struct twhash_snap_rec *
+twhash_snap_rec(const struct twhash_snap *s, uint64_t off)
+{
+	return off ? (const struct twhash_snap_rec *) (s->base + off) : NULL;
+}
+
+/* @brief	Get the object copied into record @rec.
+ * @type:	the type of the object */
+#define twhash_snap_entry(rec, type) ((const type *) ((rec) + 1))
+
+/* @brief	Iterate over the records which hash to the same bucket as @key.
+ * @s:		the snapshot
+ * @rec:	const struct twhash_snap_rec * to use as a loop cursor
+ * @key:	the uint64_t key */
+#define twhash_snap_for_each_possible(s, rec, key)			\
+	for ((rec) = twhash_snap_rec(s,					\
+			(s)->buckets[twhash_64(key, (s)->bits)]);	\
+		rec;							\
+		(rec) = twhash_snap_rec(s, (rec)->next))
+
+/* @brief	Iterate over all records of a snapshot.
+ * @bkt:	integer to use as bucket loop cursor */
+#define twhash_snap_for_each(s, bkt, rec)				\
+	for ((bkt) = 0; (bkt) < (size_t) 1 << (s)->bits; (bkt)++)	\
+		for ((rec) = twhash_snap_rec(s, (s)->buckets[bkt]);	\
+			rec;						\
+			(rec) = twhash_snap_rec(s, (rec)->next))
+
+/* @brief	Find the first object with key @key.
+ * @details	Returns a pointer to the copy of the object in the mapping,
+ * valid until twhash_snap_close, or NULL. */
+static const void *
+twhash_snap_lookup(const struct twhash_snap *s, uint64_t key)
+{
+	const struct twhash_snap_rec *rec;
+
+	twhash_snap_for_each_possible(s, rec, key)
+		if (rec->key == key)
+			return rec + 1;
+	return NULL;
+}
+
+
+#endif	/* TWHASH_SNAP_H */
@@ -0,0 +1,220 @@
+/* @file        twheap.h
+ * @brief       Intrusive pairing heap.
+ * @details     Min priority queue whose nodes are embedded in user objects,
+ *              next to their twlist_head or twhlist_node, so an object found
+ *              through any other container can have its priority changed or
+ *              be removed from the heap without searching for it.
+ *              Every node keeps its first child, its right sibling and a back
+ *              pointer to its left sibling, or to its parent if it is the
+ *              first child. Insert and meld are O(1), pop, decrease-key and
+ *              delete are amortized O(log n).
+ *              Not thread safe, the caller serializes access.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWHEAP_H
+#define TWHEAP_H
+
+
+#include "twlist.h"
+
+
+#include <stddef.h>
+
+
+struct twheap_node
+{
+	struct twheap_node	*child;	/* first child */
+	struct twheap_node	*next;	/* right sibling */
+	struct twheap_node	*prev;	/* left sibling or parent */
+};
+
+/* @brief	Ordering of two nodes.
+ * @details	Must return non-zero if @a goes out of the heap before @b. */
+typedef int (*twheap_less_func_t)(const struct twheap_node *a,
+					const struct twheap_node *b);
+
+struct twheap
+{
+	struct twheap_node	*root;
+	twheap_less_func_t	less;
+	size_t			count;
+};
+
+#define twheap_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+/* @brief	Initialize an empty heap ordered by @less. */
+static void
+twheap_init(struct twheap *h, twheap_less_func_t less)
+{
+	h->root = NULL;
+	h->less = less;
+	h->count = 0;
+}
+
+static int
+twheap_empty(const struct twheap *h)
+{
+	return h->root == NULL;
+}
+
+static size_t
+twheap_count(const struct twheap *h)
+{
+	return h->count;
+}
+
+/* @brief	The minimum node, NULL if the heap is empty. */
+static struct twheap_node *
+twheap_min(const struct twheap *h)
+{
+	return h->root;
+}
+
+/* Link two roots, the greater one becomes the first child of the other.
+ * Returns the new root, its sibling links are cleared. */
+static struct twheap_node *
+__twheap_link(struct twheap *h, struct twheap_node *a, struct twheap_node *b)
+{
+	struct twheap_node *tmp;
+
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+	if (h->less(b, a))
+	{
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+	b->prev = a;
+	b->next = a->child;
+	if (a->child)
+		a->child->prev = b;
+	a->child = b;
+	a->next = NULL;
+	a->prev = NULL;
+	return a;
+}
+
+/* Merge a list of siblings into one tree: link them in pairs left to
+ * right, then link the pairs right to left. */
+static struct twheap_node *
+__twheap_merge_pairs(struct twheap *h, struct twheap_node *first)
+{
+	struct twheap_node *a, *b, *rest, *pairs = NULL;
+
+	/* first pass, pairs are pushed onto a stack through next */
+	while (first)
+	{
+		a = first;
+		b = a->next;
+		rest = b ? b->next : NULL;
+		a = __twheap_link(h, a, b);
+		a->next = pairs;
+		pairs = a;
+		first = rest;
+	}
+
+	/* second pass, the stack pops them right to left */
+	a = NULL;
+	while (pairs)
+	{
+		rest = pairs->next;
+		a = __twheap_link(h, a, pairs);
+		pairs = rest;
+	}
+	if (a)
+	{
+		a->next = NULL;
+		a->prev = NULL;
+	}
+	return a;
+}
+
+/* Detach the subtree rooted at @n, which is not the root, from its
+ * parent and siblings. */
+static void
+__twheap_cut(struct twheap_node *n)
+{
+	if (n->prev->child == n)
+		n->prev->child = n->next;
+	else
+		n->prev->next = n->next;
+	if (n->next)
+		n->next->prev = n->prev;
+	n->next = NULL;
+	n->prev = NULL;
+}
+
+/* @brief	Insert a node. O(1). */
+static void
+twheap_insert(struct twheap *h, struct twheap_node *n)
+{
+	n->child = NULL;
+	n->next = NULL;
+	n->prev = NULL;
+	h->root = __twheap_link(h, h->root, n);
+	h->count++;
+}
+
+/* @brief	Move all nodes of @other into @h, leaving @other empty. O(1).
+ * @details	Both heaps must use the same ordering. */
+static void
+twheap_meld(struct twheap *h, struct twheap *other)
+{
+	h->root = __twheap_link(h, h->root, other->root);
+	h->count += other->count;
+	other->root = NULL;
+	other->count = 0;
+}
+
+/* @brief	Remove and return the minimum node, NULL if the heap is empty.
+ * @details	Amortized O(log n). */
+static struct twheap_node *
+twheap_pop(struct twheap *h)
+{
+	struct twheap_node *n = h->root;
+
+	if (!n)
+		return NULL;
+	h->root = __twheap_merge_pairs(h, n->child);
+	n->child = NULL;
+	h->count--;
+	return n;
+}
+
+/* @brief	Restore the heap order after the key of @n was decreased.
+ * @details	The key must not have increased, for that delete and insert
+ * the node again. Amortized O(log n). */
+static void
+twheap_decrease(struct twheap *h, struct twheap_node *n)
+{
+	if (n == h->root)
+		return;
+	__twheap_cut(n);
+	h->root = __twheap_link(h, h->root, n);
+}
+
+/* @brief	Remove node @n from the heap. Amortized O(log n). */
+static void
+twheap_del(struct twheap *h, struct twheap_node *n)
+{
+	if (n == h->root)
+	{
+		twheap_pop(h);
+		return;
+	}
+	__twheap_cut(n);
+	h->root = __twheap_link(h, h->root, __twheap_merge_pairs(h, n->child));
+	n->child = NULL;
+	h->count--;
+}
+
+
+#endif	/* TWHEAP_H */
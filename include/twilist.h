@@ -0,0 +1,293 @@
+/* @file        twilist.h
+ * @brief       twilist - doubly linked list of array elements linked by
+ *              32 bit indices.
+ * @details     For lists of objects which all live in one array. Links are
+ *              indices into that array, not pointers, so a node is 8 bytes
+ *              instead of the 16 of a twlist_head, and the array can be
+ *              moved, mmapped at another address or written to disk as is.
+ *              The list head holds the first and last index, lists are not
+ *              circular and TWILIST_NIL ends them, so heads can live outside
+ *              the array. Up to 2^32 - 1 elements.
+ *              Every operation gets the array and the name of the node
+ *              member, like twlist_entry gets the type and member:
+ *
+ *                      struct rec { uint32_t key; struct twilist_node link; };
+ *                      struct rec recs[N];
+ *                      struct twilist_head h = TWILIST_HEAD_INIT;
+ *
+ *                      twilist_add_tail(recs, link, 5, &h);
+ *                      twilist_for_each_entry(pos, recs, link, &h)
+ *                              ...
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWILIST_H
+#define TWILIST_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* End of a list, no element has this index. */
+#define TWILIST_NIL	0xffffffffU
+
+struct twilist_node
+{
+	uint32_t	next, prev;
+};
+
+struct twilist_head
+{
+	uint32_t	first, last;
+};
+
+#define TWILIST_HEAD_INIT { TWILIST_NIL, TWILIST_NIL }
+
+#define TWILIST_HEAD(name) struct twilist_head name = TWILIST_HEAD_INIT
+
+static void
+TWINIT_ILIST_HEAD(struct twilist_head *head)
+{
+	head->first = TWILIST_NIL;
+	head->last = TWILIST_NIL;
+}
+
+/* Expands to the base, element size and node offset arguments of the
+ * __twilist functions. */
+#define __TWILIST_ARR(array, member)					\
+	(char *) (array), sizeof(*(array)),				\
+	offsetof(__typeof__(*(array)), member)
+
+static struct twilist_node *
+__twilist_node(char *base, size_t size, size_t off, uint32_t i)
+{
+	return (struct twilist_node *) (base + (size_t) i * size + off);
+}
+
+/* @brief	Get the node of element @i. */
+#define twilist_node(array, member, i) (&(array)[i].member)
+
+/* @brief	Get the index of the element @pos points to. */
+#define twilist_index(array, pos) ((uint32_t) ((pos) - (array)))
+
+static void
+__twilist_add(char *base, size_t size, size_t off, uint32_t i,
+					struct twilist_head *head)
+{
+	struct twilist_node *n = __twilist_node(base, size, off, i);
+
+	n->prev = TWILIST_NIL;
+	n->next = head->first;
+	if (head->first != TWILIST_NIL)
+		__twilist_node(base, size, off, head->first)->prev = i;
+	else
+		head->last = i;
+	head->first = i;
+}
+
+/* @brief	Add element @i at the front of the list. */
+#define twilist_add(array, member, i, head) \
+	__twilist_add(__TWILIST_ARR(array, member), i, head)
+
+static void
+__twilist_add_tail(char *base, size_t size, size_t off, uint32_t i,
+					struct twilist_head *head)
+{
+	struct twilist_node *n = __twilist_node(base, size, off, i);
+
+	n->next = TWILIST_NIL;
+	n->prev = head->last;
+	if (head->last != TWILIST_NIL)
+		__twilist_node(base, size, off, head->last)->next = i;
+	else
+		head->first = i;
+	head->last = i;
+}
+
+/* @brief	Add element @i at the end of the list. */
+#define twilist_add_tail(array, member, i, head) \
+	__twilist_add_tail(__TWILIST_ARR(array, member), i, head)
+
+static void
+__twilist_del(char *base, size_t size, size_t off, uint32_t i,
+					struct twilist_head *head)
+{
+	struct twilist_node *n = __twilist_node(base, size, off, i);
+
+	if (n->prev != TWILIST_NIL)
+		__twilist_node(base, size, off, n->prev)->next = n->next;
+	else
+		head->first = n->next;
+	if (n->next != TWILIST_NIL)
+		__twilist_node(base, size, off, n->next)->prev = n->prev;
+	else
+		head->last = n->prev;
+	n->next = TWILIST_NIL;
+	n->prev = TWILIST_NIL;
+}
+
+/* @brief	Delete element @i from the list.
+ * @details	Unlike twlist_del the head is needed, it holds the ends of
+ * the list. */
+#define twilist_del(array, member, i, head) \
+	__twilist_del(__TWILIST_ARR(array, member), i, head)
+
+/* @brief	Delete element @i from list @from and add it at the front
+ * of @head. */
+#define twilist_move(array, member, i, from, head)			\
+	do {								\
+		twilist_del(array, member, i, from);			\
+		twilist_add(array, member, i, head);			\
+	} while (0)
+
+/* @brief	Delete element @i from list @from and add it at the end
+ * of @head. */
+#define twilist_move_tail(array, member, i, from, head)			\
+	do {								\
+		twilist_del(array, member, i, from);			\
+		twilist_add_tail(array, member, i, head);		\
+	} while (0)
+
+/* @brief	Test whether a list is empty. */
+static int
+twilist_empty(const struct twilist_head *head)
+{
+	return head->first == TWILIST_NIL;
+}
+
+/* @brief	Test whether a list has just one element. */
+static int
+twilist_is_singular(const struct twilist_head *head)
+{
+	return head->first != TWILIST_NIL && head->first == head->last;
+}
+
+/* @brief	Test whether element @i is the last one in the list. */
+static int
+twilist_is_last(uint32_t i, const struct twilist_head *head)
+{
+	return head->last == i;
+}
+
+static void
+__twilist_splice(char *base, size_t size, size_t off,
+		const struct twilist_head *list, struct twilist_head *head)
+{
+	if (list->first == TWILIST_NIL)
+		return;
+	__twilist_node(base, size, off, list->last)->next = head->first;
+	if (head->first != TWILIST_NIL)
+		__twilist_node(base, size, off, head->first)->prev = list->last;
+	else
+		head->last = list->last;
+	head->first = list->first;
+}
+
+static void
+__twilist_splice_tail(char *base, size_t size, size_t off,
+		const struct twilist_head *list, struct twilist_head *head)
+{
+	if (list->first == TWILIST_NIL)
+		return;
+	__twilist_node(base, size, off, list->first)->prev = head->last;
+	if (head->last != TWILIST_NIL)
+		__twilist_node(base, size, off, head->last)->next = list->first;
+	else
+		head->first = list->first;
+	head->last = list->last;
+}
+
+/* @brief	Join two lists, @list goes to the front of @head.
+ * @details	@list is left as it was, reinitialise it before reuse. */
+#define twilist_splice(array, member, list, head) \
+	__twilist_splice(__TWILIST_ARR(array, member), list, head)
+
+/* @brief	Join two lists, @list goes to the end of @head. */
+#define twilist_splice_tail(array, member, list, head) \
+	__twilist_splice_tail(__TWILIST_ARR(array, member), list, head)
+
+/* @brief	Join two lists and reinitialise the emptied @list. */
+#define twilist_splice_init(array, member, list, head)			\
+	do {								\
+		twilist_splice(array, member, list, head);		\
+		TWINIT_ILIST_HEAD(list);				\
+	} while (0)
+
+/* @brief	Join two lists at the end of @head and reinitialise @list. */
+#define twilist_splice_tail_init(array, member, list, head)		\
+	do {								\
+		twilist_splice_tail(array, member, list, head);		\
+		TWINIT_ILIST_HEAD(list);				\
+	} while (0)
+
+/* @brief	Get the element at index @i, NULL for TWILIST_NIL. */
+#define twilist_entry_or_null(array, i)					\
+	((i) == TWILIST_NIL ? NULL : &(array)[i])
+
+/* @brief	Get the first element, NULL if the list is empty. */
+#define twilist_first_entry_or_null(array, head) \
+	twilist_entry_or_null(array, (head)->first)
+
+/* @brief	Get the last element, NULL if the list is empty. */
+#define twilist_last_entry_or_null(array, head) \
+	twilist_entry_or_null(array, (head)->last)
+
+/* @brief	Get the element after @pos, NULL at the end. */
+#define twilist_next_entry(array, pos, member) \
+	twilist_entry_or_null(array, (pos)->member.next)
+
+/* @brief	Get the element before @pos, NULL at the start. */
+#define twilist_prev_entry(array, pos, member) \
+	twilist_entry_or_null(array, (pos)->member.prev)
+
+/* @brief	Iterate over the indices of a list.
+ * @i:		uint32_t to use as a loop cursor.
+ * @array:	the array the elements live in.
+ * @member:	the name of the twilist_node within the element.
+ * @head:	the head of the list. */
+#define twilist_for_each(i, array, member, head)			\
+	for (i = (head)->first; i != TWILIST_NIL; i = (array)[i].member.next)
+
+/* @brief	Iterate over the indices of a list backwards. */
+#define twilist_for_each_prev(i, array, member, head)			\
+	for (i = (head)->last; i != TWILIST_NIL; i = (array)[i].member.prev)
+
+/* @brief	Iterate over the indices of a list safe against removal of
+ * the current element.
+ * @n:		another uint32_t to use as temporary storage. */
+#define twilist_for_each_safe(i, n, array, member, head)		\
+	for (i = (head)->first;						\
+		i != TWILIST_NIL && (n = (array)[i].member.next, 1);	\
+		i = n)
+
+/* @brief	Iterate over the elements of a list.
+ * @pos:	the type * to use as a loop cursor.
+ * @array:	the array the elements live in.
+ * @member:	the name of the twilist_node within the element.
+ * @head:	the head of the list. */
+#define twilist_for_each_entry(pos, array, member, head)		\
+	for (pos = twilist_first_entry_or_null(array, head);		\
+		pos;							\
+		pos = twilist_next_entry(array, pos, member))
+
+/* @brief	Iterate over the elements of a list backwards. */
+#define twilist_for_each_entry_reverse(pos, array, member, head)	\
+	for (pos = twilist_last_entry_or_null(array, head);		\
+		pos;							\
+		pos = twilist_prev_entry(array, pos, member))
+
+/* @brief	Iterate over the elements of a list safe against removal of
+ * the current element.
+ * @n:		another type * to use as temporary storage. */
+#define twilist_for_each_entry_safe(pos, n, array, member, head)	\
+	for (pos = twilist_first_entry_or_null(array, head);		\
+		pos && (n = twilist_next_entry(array, pos, member), 1);	\
+		pos = n)
+
+
+#endif	/* TWILIST_H */
@@ -15,6 +15,7 @@
 
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <limits.h>
 
 
@@ -29,6 +30,11 @@
 /* These are non-NULL pointers that will result in page faults */
 #define TWLIST_POISON1  (void*)((unsigned char*) 0x00100100 + POISON_POINTER_DELTA)
 #define TWLIST_POISON2  (void*)((unsigned char*) 0x00200200 + POISON_POINTER_DELTA)
+
+/* Used to keep data written by different threads on separate cache lines */
+#ifndef TWCACHELINE_SIZE
+#define TWCACHELINE_SIZE 64
+#endif
  
 #ifndef CONFIG_DEBUG_LIST
 struct twlist_head
@@ -68,44 +74,44 @@ static void TWINIT_LIST_HEAD(struct twlist_head *list)
  * the prev/next entries already! */
 #ifndef CONFIG_DEBUG_LIST
 static void
-__twlist_add(struct twlist_head *new,
+__twlist_add(struct twlist_head *entry,
 				struct twlist_head *prev,
 				struct twlist_head *next)
 {
-	next->prev = new;
-	new->next = next;
-	new->prev = prev;
-	prev->next = new;
+	next->prev = entry;
+	entry->next = next;
+	entry->prev = prev;
+	prev->next = entry;
 }
 #else
 extern void
-__twlist_add(struct twlist_head *new,
+__twlist_add(struct twlist_head *entry,
 			struct twlist_head *prev,
 			struct twlist_head *next);
 #endif
 
 
 /* @brief   Add a new entry after the specified head.
- * @param   new:	new entry to be added
+ * @param   entry:	new entry to be added
  * @param   head:	list head to add it after
  * @details	This is good for implementing stacks. */
 static void
-twlist_add(struct twlist_head *new,
+twlist_add(struct twlist_head *entry,
 				struct twlist_head *head)
 {
-		__twlist_add(new, head, head->next);
+		__twlist_add(entry, head, head->next);
 }
 
 
 /* @brief       Add a new entry before the specified head.
- * @param       new:	new entry to be added
+ * @param       entry:	new entry to be added
  * @param       head:	list head to add it before
  * @details     This is useful for implementing queues. */
 static void
-twlist_add_tail(struct twlist_head *new,
+twlist_add_tail(struct twlist_head *entry,
 				struct twlist_head *head)
 {
-		__twlist_add(new, head->prev, head);
+		__twlist_add(entry, head->prev, head);
 }
 
 /* @brief   Delete a list entry by making the prev/next entries
@@ -135,8 +141,8 @@ static void
 twlist_del(struct twlist_head *entry)
 {
 	__twlist_del(entry->prev, entry->next);
-	entry->next = TWLIST_POISON1;
-	entry->prev = TWLIST_POISON2;
+	entry->next = (struct twlist_head *) TWLIST_POISON1;
+	entry->prev = (struct twlist_head *) TWLIST_POISON2;
 }
 #else
 extern void
@@ -555,8 +561,8 @@ static void
 twhlist_del(struct twhlist_node *n)
 {
 	__twhlist_del(n);
-	n->next = TWLIST_POISON1;
-	n->pprev = TWLIST_POISON2;
+	n->next = (struct twhlist_node *) TWLIST_POISON1;
+	n->pprev = (struct twhlist_node **) TWLIST_POISON2;
 }
 
 static void
@@ -615,11 +621,11 @@ twhlist_add_fake(struct twhlist_node *n)
  * reference of the first entry if it exists. */
 static void
 twhlist_move_list(struct twhlist_head *old,
-			struct twhlist_head *new)
+			struct twhlist_head *head)
 {
-	new->first = old->first;
-	if (new->first)
-		new->first->pprev = &new->first;
+	head->first = old->first;
+	if (head->first)
+		head->first->pprev = &head->first;
 	old->first = NULL;
 }
 
@@ -678,8 +684,8 @@ twhlist_move_list(struct twhlist_head *old,
 typedef struct twlist_head twfifo_queue;
 
 static void
-twfifo_enqueue(struct twlist_head *new, twfifo_queue *q) {
-	twlist_add_tail(new, (struct twlist_head *)q);
+twfifo_enqueue(struct twlist_head *entry, twfifo_queue *q) {
+	twlist_add_tail(entry, (struct twlist_head *)q);
 }
 
 static struct twlist_head*
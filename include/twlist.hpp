@@ -0,0 +1,233 @@
+/* @file        twlist.hpp
+ * @brief       C++ wrapper of twlist.
+ * @details     tw::list<T, &T::link> is a twlist_head with typed,
+ *              bidirectional iterators, so intrusive lists work with
+ *              range-for and <algorithm>. Nothing is stored besides the
+ *              twlist_head and every member function is a thin inline layer
+ *              over the C functions, the entry is found from the node with
+ *              the member offset, a compile time constant, exactly like
+ *              tw_container_of does.
+ *              The list doesn't own its elements, like the C list.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLIST_HPP
+#define TWLIST_HPP
+
+
+#include "twlist.h"
+
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+
+namespace tw {
+
+namespace detail {
+
+/* Offset of member @m in T, what offsetof gives for a member name. */
+template <class T, class M>
+inline std::size_t
+member_offset(M T::*m) noexcept
+{
+	return reinterpret_cast<std::size_t>(
+		&(reinterpret_cast<const volatile T *>(0)->*m));
+}
+
+/* The entry embedding node @n as its member @m, tw_container_of. */
+template <class T, class M>
+inline T *
+container_of(M *n, M T::*m) noexcept
+{
+	return reinterpret_cast<T *>(reinterpret_cast<char *>(n) -
+							member_offset(m));
+}
+
+} /* namespace detail */
+
+template <class T, twlist_head T::*Link>
+class list
+{
+public:
+	template <bool Const>
+	class basic_iterator
+	{
+	public:
+		typedef std::bidirectional_iterator_tag	iterator_category;
+		typedef T				value_type;
+		typedef std::ptrdiff_t			difference_type;
+		typedef typename std::conditional<Const, const T *, T *>::type
+							pointer;
+		typedef typename std::conditional<Const, const T &, T &>::type
+							reference;
+
+		basic_iterator() noexcept : node_(nullptr) {}
+		explicit basic_iterator(twlist_head *n) noexcept : node_(n) {}
+		/* iterator converts to const_iterator */
+		template <bool C, class = typename std::enable_if<Const && !C>::type>
+		basic_iterator(const basic_iterator<C> &it) noexcept
+			: node_(it.node()) {}
+
+		reference operator*() const noexcept
+		{
+			return *detail::container_of(node_, Link);
+		}
+		pointer operator->() const noexcept
+		{
+			return detail::container_of(node_, Link);
+		}
+		basic_iterator &operator++() noexcept
+		{
+			node_ = node_->next;
+			return *this;
+		}
+		basic_iterator operator++(int) noexcept
+		{
+			basic_iterator tmp = *this;
+			node_ = node_->next;
+			return tmp;
+		}
+		basic_iterator &operator--() noexcept
+		{
+			node_ = node_->prev;
+			return *this;
+		}
+		basic_iterator operator--(int) noexcept
+		{
+			basic_iterator tmp = *this;
+			node_ = node_->prev;
+			return tmp;
+		}
+		friend bool operator==(const basic_iterator &a,
+					const basic_iterator &b) noexcept
+		{
+			return a.node_ == b.node_;
+		}
+		friend bool operator!=(const basic_iterator &a,
+					const basic_iterator &b) noexcept
+		{
+			return a.node_ != b.node_;
+		}
+		twlist_head *node() const noexcept { return node_; }
+
+	private:
+		twlist_head *node_;
+	};
+
+	typedef T					value_type;
+	typedef T &					reference;
+	typedef const T &				const_reference;
+	typedef std::size_t				size_type;
+	typedef basic_iterator<false>			iterator;
+	typedef basic_iterator<true>			const_iterator;
+	typedef std::reverse_iterator<iterator>		reverse_iterator;
+	typedef std::reverse_iterator<const_iterator>	const_reverse_iterator;
+
+	list() noexcept { TWINIT_LIST_HEAD(&head_); }
+	/* The head is linked to by the elements, it can't be copied. */
+	list(const list &) = delete;
+	list &operator=(const list &) = delete;
+
+	/* The underlying head, for use with the C API. */
+	twlist_head *head() noexcept { return &head_; }
+	const twlist_head *head() const noexcept { return &head_; }
+
+	bool empty() const noexcept { return twlist_empty(&head_); }
+	bool is_singular() const noexcept { return twlist_is_singular(&head_); }
+
+	/* O(n), the list doesn't keep a count. */
+	size_type size() const noexcept
+	{
+		return static_cast<size_type>(std::distance(begin(), end()));
+	}
+
+	iterator begin() noexcept { return iterator(head_.next); }
+	iterator end() noexcept { return iterator(&head_); }
+	const_iterator begin() const noexcept
+	{
+		return const_iterator(head_.next);
+	}
+	const_iterator end() const noexcept
+	{
+		return const_iterator(const_cast<twlist_head *>(&head_));
+	}
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+	reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+	reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	/* front and back of an empty list are undefined, like std::list */
+	T &front() noexcept { return *begin(); }
+	T &back() noexcept { return *--end(); }
+	const T &front() const noexcept { return *begin(); }
+	const T &back() const noexcept { return *--end(); }
+
+	void push_front(T &x) noexcept { twlist_add(&(x.*Link), &head_); }
+	void push_back(T &x) noexcept { twlist_add_tail(&(x.*Link), &head_); }
+	void pop_front() noexcept { twlist_del_init(head_.next); }
+	void pop_back() noexcept { twlist_del_init(head_.prev); }
+
+	/* Link @x before @pos, returns an iterator to @x. */
+	iterator insert(iterator pos, T &x) noexcept
+	{
+		twlist_add_tail(&(x.*Link), pos.node());
+		return iterator(&(x.*Link));
+	}
+
+	/* Unlink the element at @pos, returns the iterator after it. */
+	iterator erase(iterator pos) noexcept
+	{
+		twlist_head *next = pos.node()->next;
+
+		twlist_del_init(pos.node());
+		return iterator(next);
+	}
+
+	/* Unlink @x from whatever list it is on. */
+	static void remove(T &x) noexcept { twlist_del_init(&(x.*Link)); }
+
+	/* Unlink all elements, they are left as they are. */
+	void clear() noexcept { TWINIT_LIST_HEAD(&head_); }
+
+	/* Move @x to the front or the back of this list. */
+	void move_front(T &x) noexcept { twlist_move(&(x.*Link), &head_); }
+	void move_back(T &x) noexcept { twlist_move_tail(&(x.*Link), &head_); }
+
+	/* Move all elements of @other to the front or the back. */
+	void splice_front(list &other) noexcept
+	{
+		twlist_splice_init(&other.head_, &head_);
+	}
+	void splice_back(list &other) noexcept
+	{
+		twlist_splice_tail_init(&other.head_, &head_);
+	}
+
+	/* The iterator of an element known to be on the list. */
+	static iterator iterator_to(T &x) noexcept
+	{
+		return iterator(&(x.*Link));
+	}
+
+private:
+	twlist_head head_;
+};
+
+} /* namespace tw */
+
+
+#endif	/* TWLIST_HPP */
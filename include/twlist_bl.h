@@ -0,0 +1,213 @@
+/* @file        twlist_bl.h
+ * @brief       twhlist_bl - twhlist with a bit spinlock in the list head.
+ * @details     Based on Linux Kernel list_bl. Bit 0 of the head's first
+ *              pointer is used as a spinlock protecting the whole chain, so
+ *              every bucket of a hashtable gets its own lock without making
+ *              the bucket array any bigger. Nodes are aligned to at least
+ *              2 bytes so the bit is otherwise always clear.
+ *              All the list operations require the head to be locked.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              list_bl.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLIST_BL_H
+#define TWLIST_BL_H
+
+
+#include "twlist.h"
+
+
+#include <stdint.h>
+
+
+#define TWLIST_BL_LOCKMASK	1UL
+
+struct twhlist_bl_head
+{
+	struct twhlist_bl_node	*first;
+};
+
+struct twhlist_bl_node
+{
+	struct twhlist_bl_node	*next, **pprev;
+};
+
+#define TWINIT_HLIST_BL_HEAD(ptr) ((ptr)->first = NULL)
+
+static void
+TWINIT_HLIST_BL_NODE(struct twhlist_bl_node *h)
+{
+	h->next = NULL;
+	h->pprev = NULL;
+}
+
+#define twhlist_bl_entry(ptr, type, member) tw_container_of(ptr,type,member)
+
+#ifndef twcpu_relax
+	#if defined(__i386__) || defined(__x86_64__)
+		#define twcpu_relax() __builtin_ia32_pause()
+	#else
+		#define twcpu_relax() do { } while (0)
+	#endif
+#endif
+
+/* @brief	Lock the chain.
+ * @details	Spins reading the head until the bit is clear before trying
+ * to set it again, so waiters don't keep the cache line bouncing. */
+static void
+twhlist_bl_lock(struct twhlist_bl_head *b)
+{
+	struct twhlist_bl_node *old;
+
+	for (;;)
+	{
+		old = __atomic_load_n(&b->first, __ATOMIC_RELAXED);
+		if (!((uintptr_t) old & TWLIST_BL_LOCKMASK) &&
+			__atomic_compare_exchange_n(&b->first, &old,
+				(struct twhlist_bl_node *)
+				((uintptr_t) old | TWLIST_BL_LOCKMASK), 1,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+		twcpu_relax();
+	}
+}
+
+/* @brief	Try to lock the chain, returns non zero on success. */
+static int
+twhlist_bl_trylock(struct twhlist_bl_head *b)
+{
+	struct twhlist_bl_node *old;
+
+	old = __atomic_load_n(&b->first, __ATOMIC_RELAXED);
+	if ((uintptr_t) old & TWLIST_BL_LOCKMASK)
+		return 0;
+	return __atomic_compare_exchange_n(&b->first, &old,
+			(struct twhlist_bl_node *)
+			((uintptr_t) old | TWLIST_BL_LOCKMASK), 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void
+twhlist_bl_unlock(struct twhlist_bl_head *b)
+{
+	struct twhlist_bl_node *first;
+
+	first = __atomic_load_n(&b->first, __ATOMIC_RELAXED);
+	__atomic_store_n(&b->first, (struct twhlist_bl_node *)
+			((uintptr_t) first & ~TWLIST_BL_LOCKMASK),
+			__ATOMIC_RELEASE);
+}
+
+static int
+twhlist_bl_is_locked(struct twhlist_bl_head *b)
+{
+	return ((uintptr_t) __atomic_load_n(&b->first, __ATOMIC_RELAXED) &
+			TWLIST_BL_LOCKMASK) != 0;
+}
+
+/* @brief	First node of the chain with the lock bit masked out. */
+static struct twhlist_bl_node *
+twhlist_bl_first(struct twhlist_bl_head *h)
+{
+	return (struct twhlist_bl_node *)
+		((uintptr_t) h->first & ~TWLIST_BL_LOCKMASK);
+}
+
+/* Set the first node keeping the lock bit. Stores to the head are atomic
+ * as other threads spin on it with compare and exchange. */
+static void
+twhlist_bl_set_first(struct twhlist_bl_head *h,
+				struct twhlist_bl_node *n)
+{
+	__atomic_store_n(&h->first, (struct twhlist_bl_node *)
+			((uintptr_t) n | TWLIST_BL_LOCKMASK), __ATOMIC_RELAXED);
+}
+
+static int
+twhlist_bl_unhashed(const struct twhlist_bl_node *h)
+{
+	return (!h->pprev);
+}
+
+static int
+twhlist_bl_empty(const struct twhlist_bl_head *h)
+{
+	return !((uintptr_t) h->first & ~TWLIST_BL_LOCKMASK);
+}
+
+static void
+twhlist_bl_add_head(struct twhlist_bl_node *n,
+				struct twhlist_bl_head *h)
+{
+	struct twhlist_bl_node *first = twhlist_bl_first(h);
+
+	n->next = first;
+	if (first)
+		first->pprev = &n->next;
+	n->pprev = &h->first;
+	twhlist_bl_set_first(h, n);
+}
+
+static void
+__twhlist_bl_del(struct twhlist_bl_node *n)
+{
+	struct twhlist_bl_node *next = n->next;
+	struct twhlist_bl_node **pprev = n->pprev;
+	uintptr_t lock;
+
+	/* pprev may point to the head, keep its lock bit */
+	lock = (uintptr_t) __atomic_load_n(pprev, __ATOMIC_RELAXED) &
+		TWLIST_BL_LOCKMASK;
+	__atomic_store_n(pprev, (struct twhlist_bl_node *)
+			((uintptr_t) next | lock), __ATOMIC_RELAXED);
+	if (next)
+		next->pprev = pprev;
+}
+
+static void
+twhlist_bl_del(struct twhlist_bl_node *n)
+{
+	__twhlist_bl_del(n);
+	n->next = (struct twhlist_bl_node *) TWLIST_POISON1;
+	n->pprev = (struct twhlist_bl_node **) TWLIST_POISON2;
+}
+
+static void
+twhlist_bl_del_init(struct twhlist_bl_node *n)
+{
+	if (!twhlist_bl_unhashed(n))
+	{
+		__twhlist_bl_del(n);
+		TWINIT_HLIST_BL_NODE(n);
+	}
+}
+
+/* @brief	Iterate over twhlist_bl of given type.
+ * @pos:	the type * to use as a loop cursor.
+ * @head:	the head for your list, must be locked.
+ * @member:	the name of the twhlist_bl_node within the struct. */
+#define twhlist_bl_for_each_entry(pos, head, member)			\
+	for (pos = twhlist_entry_safe(twhlist_bl_first(head),		\
+			__typeof__(*(pos)), member);			\
+		pos;							\
+		pos = twhlist_entry_safe((pos)->member.next,		\
+			__typeof__(*(pos)), member))
+
+/* @brief	Iterate over twhlist_bl of given type safe against removal
+ * of list entry.
+ * @pos:	the type * to use as a loop cursor.
+ * @n:		another &struct twhlist_bl_node to use as temporary storage
+ * @head:	the head for your list, must be locked.
+ * @member:	the name of the twhlist_bl_node within the struct. */
+#define twhlist_bl_for_each_entry_safe(pos, n, head, member)		\
+	for (pos = twhlist_entry_safe(twhlist_bl_first(head),		\
+			__typeof__(*(pos)), member);			\
+		pos && (n = (pos)->member.next, 1);			\
+		pos = twhlist_entry_safe(n, __typeof__(*(pos)), member))
+
+
+#endif	/* TWLIST_BL_H */
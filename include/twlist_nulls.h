@@ -0,0 +1,181 @@
+/* @file        twlist_nulls.h
+ * @brief       twhlist_nulls - twhlist terminated by a "nulls" marker.
+ * @details     Based on Linux Kernel list_nulls and rculist_nulls. The end of
+ *              a chain is not NULL but an odd value carrying a number chosen
+ *              at init time, usually the index of the hashtable bucket.
+ *              A lock-free reader walking a chain whose nodes can be freed
+ *              and reused right away (type-stable memory, e.g. a pool, with
+ *              no grace period) may be moved into another chain when the
+ *              node it stands on is reinserted elsewhere. With NULL
+ *              terminated lists it can't tell. Here the reader checks the
+ *              nulls value it ended on and restarts the lookup if it isn't
+ *              the one of the chain it started in.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              list_nulls and rculist_nulls.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLIST_NULLS_H
+#define TWLIST_NULLS_H
+
+
+#include "twlist.h"
+#include "twlist_rcu.h"
+
+
+struct twhlist_nulls_head
+{
+	struct twhlist_nulls_node	*first;
+};
+
+struct twhlist_nulls_node
+{
+	struct twhlist_nulls_node	*next, **pprev;
+};
+
+#define TWNULLS_MARKER(value)	(1UL | (((unsigned long) (value)) << 1))
+
+/* @brief	Initialize an empty chain ending with nulls @nulls. */
+#define TWINIT_HLIST_NULLS_HEAD(ptr, nulls) \
+	((ptr)->first = (struct twhlist_nulls_node *) TWNULLS_MARKER(nulls))
+
+#define twhlist_nulls_entry(ptr, type, member) tw_container_of(ptr,type,member)
+
+/* @brief	Test if @ptr is a nulls marker, i.e. the end of a chain. */
+#define twis_a_nulls(ptr)	((unsigned long) (ptr) & 1)
+
+/* @brief	Get the value stored in a nulls marker. */
+#define twget_nulls_value(ptr)	((unsigned long) (ptr) >> 1)
+
+static void
+TWINIT_HLIST_NULLS_NODE(struct twhlist_nulls_node *h)
+{
+	h->next = NULL;
+	h->pprev = NULL;
+}
+
+static int
+twhlist_nulls_unhashed(const struct twhlist_nulls_node *h)
+{
+	return !h->pprev;
+}
+
+static int
+twhlist_nulls_empty(const struct twhlist_nulls_head *h)
+{
+	return twis_a_nulls(TWREAD_ONCE(h->first));
+}
+
+static void
+twhlist_nulls_add_head(struct twhlist_nulls_node *n,
+				struct twhlist_nulls_head *h)
+{
+	struct twhlist_nulls_node *first = h->first;
+
+	n->next = first;
+	n->pprev = &h->first;
+	h->first = n;
+	if (!twis_a_nulls(first))
+		first->pprev = &n->next;
+}
+
+static void
+__twhlist_nulls_del(struct twhlist_nulls_node *n)
+{
+	struct twhlist_nulls_node *next = n->next;
+	struct twhlist_nulls_node **pprev = n->pprev;
+
+	TWWRITE_ONCE(*pprev, next);
+	if (!twis_a_nulls(next))
+		next->pprev = pprev;
+}
+
+/* @brief	Delete entry from the chain.
+ * @details	next link is left intact, a concurrent reader standing on @n
+ * can move on (it ends up on the right nulls or restarts). */
+static void
+twhlist_nulls_del(struct twhlist_nulls_node *n)
+{
+	__twhlist_nulls_del(n);
+	n->pprev = (struct twhlist_nulls_node **) TWLIST_POISON2;
+}
+
+/* @brief	Iterate over list of given type.
+ * @tpos:	the type * to use as a loop cursor.
+ * @pos:	the &struct twhlist_nulls_node to use as a loop cursor, holds
+ *		the nulls marker at the end of the loop.
+ * @head:	the head for your list.
+ * @member:	the name of the twhlist_nulls_node within the struct. */
+#define twhlist_nulls_for_each_entry(tpos, pos, head, member)		\
+	for (pos = (head)->first;					\
+		(!twis_a_nulls(pos)) &&					\
+		(tpos = twhlist_nulls_entry(pos, __typeof__(*(tpos)), member), 1);\
+		pos = pos->next)
+
+/* @brief	Iterate over list of given type continuing from current point.
+ * @tpos:	the type * to use as a loop cursor.
+ * @pos:	the &struct twhlist_nulls_node to use as a loop cursor.
+ * @member:	the name of the twhlist_nulls_node within the struct. */
+#define twhlist_nulls_for_each_entry_from(tpos, pos, member)		\
+	for (; (!twis_a_nulls(pos)) &&					\
+		(tpos = twhlist_nulls_entry(pos, __typeof__(*(tpos)), member), 1);\
+		pos = pos->next)
+
+/* @brief	Add a new entry to the beginning of the chain.
+ * @details	May run concurrently with readers walking the chain with
+ * twhlist_nulls_for_each_entry_rcu(), writers must be serialized. */
+static void
+twhlist_nulls_add_head_rcu(struct twhlist_nulls_node *n,
+				struct twhlist_nulls_head *h)
+{
+	struct twhlist_nulls_node *first = h->first;
+
+	TWWRITE_ONCE(n->next, first);
+	TWWRITE_ONCE(n->pprev, &h->first);
+	twrcu_assign_pointer(h->first, n);
+	if (!twis_a_nulls(first))
+		TWWRITE_ONCE(first->pprev, &n->next);
+}
+
+/* @brief	Delete entry from the chain, concurrent readers allowed.
+ * @details	Only pprev is poisoned. The object may be reused (inserted
+ * into any chain again) right away if readers recheck the nulls value. */
+static void
+twhlist_nulls_del_rcu(struct twhlist_nulls_node *n)
+{
+	__twhlist_nulls_del(n);
+	TWWRITE_ONCE(n->pprev,
+			(struct twhlist_nulls_node **) TWLIST_POISON2);
+}
+
+/* @brief	Delete entry from the chain and mark it unhashed. */
+static void
+twhlist_nulls_del_init_rcu(struct twhlist_nulls_node *n)
+{
+	if (!twhlist_nulls_unhashed(n))
+	{
+		__twhlist_nulls_del(n);
+		TWWRITE_ONCE(n->pprev, NULL);
+	}
+}
+
+/* @brief	Iterate over rcu chain of given type.
+ * @tpos:	the type * to use as a loop cursor.
+ * @pos:	the &struct twhlist_nulls_node to use as a loop cursor, holds
+ *		the nulls marker at the end of the loop.
+ * @head:	the head for your list.
+ * @member:	the name of the twhlist_nulls_node within the struct.
+ * @details	If the loop runs to the end, the caller must check that
+ * twget_nulls_value(pos) is the value of the chain it started in and
+ * restart otherwise. */
+#define twhlist_nulls_for_each_entry_rcu(tpos, pos, head, member)	\
+	for (pos = twrcu_dereference((head)->first);			\
+		(!twis_a_nulls(pos)) &&					\
+		(tpos = twhlist_nulls_entry(pos, __typeof__(*(tpos)), member), 1);\
+		pos = twrcu_dereference(pos->next))
+
+
+#endif	/* TWLIST_NULLS_H */
@@ -0,0 +1,163 @@
+/* @file        twlist_rcu.h
+ * @brief       RCU variants of twhlist primitives.
+ * @details     Based on Linux Kernel rculist. Writers publish new nodes with
+ *              release stores, readers load links with consume ordering, so
+ *              readers can walk a twhlist without taking the writers' lock.
+ *              Writers still have to be serialized against each other, and
+ *              removed nodes can be freed only after a grace period
+ *              (see twrcu.h).
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              rculist.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLIST_RCU_H
+#define TWLIST_RCU_H
+
+
+#include "twlist.h"
+
+
+/* Single, untorn access to a shared variable, no ordering implied. */
+#define TWREAD_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define TWWRITE_ONCE(x, v)	__atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+/* @brief	Publish pointer @v in @p.
+ * @details	All initialization of the pointed to object done before
+ * is visible to readers who get @v through twrcu_dereference(). */
+#define twrcu_assign_pointer(p, v) \
+	__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/* @brief	Load pointer published with twrcu_assign_pointer. */
+#define twrcu_dereference(p) \
+	__atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+/* @brief	Add a new entry to the beginning of the hlist.
+ * @n:		the element to add to the hash list
+ * @h:		the list to add to
+ * @details	May run concurrently with readers walking the list with
+ * twhlist_for_each_entry_rcu(). */
+static void
+twhlist_add_head_rcu(struct twhlist_node *n,
+			struct twhlist_head *h)
+{
+	struct twhlist_node *first = h->first;
+
+	n->next = first;
+	n->pprev = &h->first;
+	twrcu_assign_pointer(h->first, n);
+	if (first)
+		first->pprev = &n->next;
+}
+
+/* @brief	Add a new entry before the one specified.
+ * @n:		the new element to add to the hash list
+ * @next:	the existing element to add the new element before,
+ *		must be != NULL */
+static void
+twhlist_add_before_rcu(struct twhlist_node *n,
+			struct twhlist_node *next)
+{
+	n->pprev = next->pprev;
+	n->next = next;
+	twrcu_assign_pointer(*(n->pprev), n);
+	next->pprev = &n->next;
+}
+
+/* @brief	Add a new entry after the one specified.
+ * @n:		the existing element to add the new element after
+ * @next:	the new element to add to the hash list */
+static void
+twhlist_add_after_rcu(struct twhlist_node *n,
+			struct twhlist_node *next)
+{
+	next->next = n->next;
+	next->pprev = &n->next;
+	twrcu_assign_pointer(n->next, next);
+	if (next->next)
+		next->next->pprev = &next->next;
+}
+
+static void
+__twhlist_del_rcu(struct twhlist_node *n)
+{
+	struct twhlist_node *next = n->next;
+	struct twhlist_node **pprev = n->pprev;
+
+	TWWRITE_ONCE(*pprev, next);
+	if (next)
+		next->pprev = pprev;
+}
+
+/* @brief	Delete entry from hash list without poisoning its next link.
+ * @n:		the element to delete from the hash list
+ * @details	Readers may still be looking at @n and must be able to move
+ * on to the rest of the chain, so only pprev is poisoned. Don't free
+ * @n before a grace period has elapsed. */
+static void
+twhlist_del_rcu(struct twhlist_node *n)
+{
+	__twhlist_del_rcu(n);
+	n->pprev = (struct twhlist_node **) TWLIST_POISON2;
+}
+
+/* @brief	Delete entry from hash list and mark it unhashed.
+ * @n:		the element to delete from the hash list
+ * @details	twhlist_unhashed() on @n returns true after this, next link
+ * is left intact for concurrent readers. */
+static void
+twhlist_del_init_rcu(struct twhlist_node *n)
+{
+	if (!twhlist_unhashed(n))
+	{
+		__twhlist_del_rcu(n);
+		n->pprev = NULL;
+	}
+}
+
+/* @brief	Replace old entry by new one.
+ * @old:	the element to be replaced
+ * @new_node:	the new element to insert
+ * @details	Readers see either @old or @new_node, never neither. */
+static void
+twhlist_replace_rcu(struct twhlist_node *old,
+			struct twhlist_node *new_node)
+{
+	struct twhlist_node *next = old->next;
+
+	new_node->next = next;
+	new_node->pprev = old->pprev;
+	twrcu_assign_pointer(*new_node->pprev, new_node);
+	if (next)
+		next->pprev = &new_node->next;
+	old->pprev = (struct twhlist_node **) TWLIST_POISON2;
+}
+
+/* @brief	Iterate over rcu list of given type.
+ * @pos:	the type * to use as a loop cursor.
+ * @head:	the head for your list.
+ * @member:	the name of the twhlist_node within the struct.
+ * @details	May run concurrently with the _rcu list mutation primitives
+ * as long as it is done inside of a read-side critical section. */
+#define twhlist_for_each_entry_rcu(pos, head, member)			\
+	for (pos = twhlist_entry_safe(twrcu_dereference((head)->first),	\
+			__typeof__(*(pos)), member);			\
+		pos;							\
+		pos = twhlist_entry_safe(twrcu_dereference((pos)->member.next),\
+			__typeof__(*(pos)), member))
+
+/* @brief	Iterate over a rcu twhlist continuing after current point.
+ * @pos:	the type * to use as a loop cursor.
+ * @member:	the name of the twhlist_node within the struct. */
+#define twhlist_for_each_entry_continue_rcu(pos, member)		\
+	for (pos = twhlist_entry_safe(twrcu_dereference((pos)->member.next),\
+			__typeof__(*(pos)), member);			\
+		pos;							\
+		pos = twhlist_entry_safe(twrcu_dereference((pos)->member.next),\
+			__typeof__(*(pos)), member))
+
+
+#endif	/* TWLIST_RCU_H */
@@ -0,0 +1,179 @@
+/* @file        twlist_sort.h
+ * @brief       In-place merge sort of twlist.
+ * @details     Based on Linux Kernel list_sort. Bottom-up, stable merge sort
+ *              which works directly on the list nodes, no memory is
+ *              allocated. While sorting the list is kept singly linked
+ *              (prev links of the pending sublists are reused to chain them
+ *              together) and the prev links are rebuilt in a single pass
+ *              during the final merge.
+ *              Merges are kept balanced to at most 2:1, so the number of
+ *              comparisons stays close to n*log2(n) - n.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              list_sort.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLIST_SORT_H
+#define TWLIST_SORT_H
+
+
+#include "twlist.h"
+
+
+#include <stddef.h>
+
+
+/* @brief	Comparison function for twlist_sort.
+ * @details	Must return > 0 if @a should be sorted after @b and <= 0
+ * otherwise. Returning 0 for equal elements (or just a <= b test) keeps
+ * the sort stable. */
+typedef int (*twlist_cmp_func_t)(void *priv, const struct twlist_head *a,
+					const struct twlist_head *b);
+
+/* Merge two NULL terminated, singly linked sorted lists. On ties @a goes
+ * first which keeps the sort stable. */
+static struct twlist_head *
+__twlist_sort_merge(void *priv, twlist_cmp_func_t cmp,
+			struct twlist_head *a, struct twlist_head *b)
+{
+	struct twlist_head	*head, **tail = &head;
+
+	for (;;)
+	{
+		if (cmp(priv, a, b) <= 0)
+		{
+			*tail = a;
+			tail = &a->next;
+			a = a->next;
+			if (!a)
+			{
+				*tail = b;
+				break;
+			}
+		} else {
+			*tail = b;
+			tail = &b->next;
+			b = b->next;
+			if (!b)
+			{
+				*tail = a;
+				break;
+			}
+		}
+	}
+	return head;
+}
+
+/* Last merge: like __twlist_sort_merge but links the result back into
+ * doubly linked list at @head restoring prev links on the way. */
+static void
+__twlist_sort_merge_final(void *priv, twlist_cmp_func_t cmp,
+			struct twlist_head *head,
+			struct twlist_head *a, struct twlist_head *b)
+{
+	struct twlist_head	*tail = head;
+
+	for (;;)
+	{
+		if (cmp(priv, a, b) <= 0)
+		{
+			tail->next = a;
+			a->prev = tail;
+			tail = a;
+			a = a->next;
+			if (!a)
+				break;
+		} else {
+			tail->next = b;
+			b->prev = tail;
+			tail = b;
+			b = b->next;
+			if (!b)
+			{
+				b = a;
+				break;
+			}
+		}
+	}
+
+	/* splice in the rest of the remaining list */
+	tail->next = b;
+	do {
+		b->prev = tail;
+		tail = b;
+		b = b->next;
+	} while (b);
+
+	tail->next = head;
+	head->prev = tail;
+}
+
+/* @brief	Sort a list.
+ * @priv:	private data, opaque to twlist_sort(), passed to @cmp
+ * @head:	the list to sort
+ * @cmp:	the elements comparison function
+ * @details	Stable, in-place sort in O(n log n) time and O(1) space.
+ * Pending sublists of 2^k elements are kept on a stack linked through
+ * their prev pointers. Each time the element count reaches a value whose
+ * binary representation has the bit k set and all lower bits clear except
+ * the lowest, two sublists of size 2^k are merged, which keeps every merge
+ * at most 2:1 and the working set for the early merges in cache. */
+static void
+twlist_sort(void *priv, struct twlist_head *head, twlist_cmp_func_t cmp)
+{
+	struct twlist_head	*list = head->next, *pending = NULL;
+	size_t			count = 0;	/* count of pending */
+
+	if (list == head->prev)	/* zero or one elements */
+		return;
+
+	/* convert to a NULL terminated singly linked list */
+	head->prev->next = NULL;
+
+	do {
+		size_t			bits;
+		struct twlist_head	**tail = &pending;
+
+		/* find the least significant clear bit of count */
+		for (bits = count; bits & 1; bits >>= 1)
+			tail = &(*tail)->prev;
+		/* do the indicated merge */
+		if (bits)
+		{
+			struct twlist_head *a = *tail, *b = a->prev;
+
+			a = __twlist_sort_merge(priv, cmp, b, a);
+			/* install the merged result in place of the inputs */
+			a->prev = b->prev;
+			*tail = a;
+		}
+
+		/* move one element from input list to pending */
+		list->prev = pending;
+		pending = list;
+		list = list->next;
+		pending->next = NULL;
+		count++;
+	} while (list);
+
+	/* end of input, merge all pending lists together */
+	list = pending;
+	pending = pending->prev;
+	for (;;)
+	{
+		struct twlist_head *next = pending->prev;
+
+		if (!next)
+			break;
+		list = __twlist_sort_merge(priv, cmp, pending, list);
+		pending = next;
+	}
+	/* the final merge, rebuilding prev links */
+	__twlist_sort_merge_final(priv, cmp, head, pending, list);
+}
+
+
+#endif	/* TWLIST_SORT_H */
@@ -0,0 +1,184 @@
+/* @file        twllist.h
+ * @brief       Lock-free singly linked list for batched handoff.
+ * @details     Based on Linux Kernel llist. Any number of threads can push
+ *              entries with twllist_add, a compare-and-swap on the head, and
+ *              a consumer takes the whole chain at once with twllist_del_all,
+ *              a single atomic exchange, then walks it without any further
+ *              synchronization. Consumers thus pay one atomic operation per
+ *              batch, not per entry.
+ *              The chain comes out newest first, twllist_reverse_order turns
+ *              it into the order of pushing.
+ *              twllist_del_first must be serialized against both
+ *              twllist_del_first and twllist_del_all (ABA problem),
+ *              twllist_del_all alone may run in any number of threads.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              llist.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLLIST_H
+#define TWLLIST_H
+
+
+#include "twlist.h"
+
+
+#include <stddef.h>
+
+
+struct twllist_head
+{
+	struct twllist_node	*first;
+};
+
+struct twllist_node
+{
+	struct twllist_node	*next;
+};
+
+#define TWLLIST_HEAD_INIT(name)	{ NULL }
+
+#define TWLLIST_HEAD(name) struct twllist_head name = TWLLIST_HEAD_INIT(name)
+
+static void
+TWINIT_LLIST_HEAD(struct twllist_head *list)
+{
+	__atomic_store_n(&list->first, NULL, __ATOMIC_RELAXED);
+}
+
+#define twllist_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+/* @brief	Get the entry of @ptr, NULL if @ptr is NULL. */
+#define twllist_entry_safe(ptr, type, member) __extension__		\
+	({ __typeof__(ptr) ____ptr = (ptr);				\
+		____ptr ? twllist_entry(____ptr, type, member) : NULL;	\
+	})
+
+/* @brief	Iterate over a chain taken out of a list.
+ * @pos:	the &struct twllist_node to use as a loop cursor.
+ * @node:	the first node of the chain, as returned by twllist_del_all. */
+#define twllist_for_each(pos, node)					\
+	for ((pos) = (node); pos; (pos) = (pos)->next)
+
+/* @brief	Iterate over a chain safe against freeing the current node.
+ * @n:		another &struct twllist_node to use as temporary storage. */
+#define twllist_for_each_safe(pos, n, node)				\
+	for ((pos) = (node); (pos) && ((n) = (pos)->next, 1); (pos) = (n))
+
+/* @brief	Iterate over a chain of entries of given type.
+ * @pos:	the type * to use as a loop cursor.
+ * @node:	the first node of the chain.
+ * @member:	the name of the twllist_node within the struct. */
+#define twllist_for_each_entry(pos, node, member)			\
+	for ((pos) = twllist_entry_safe((node), __typeof__(*(pos)), member);\
+		pos;							\
+		(pos) = twllist_entry_safe((pos)->member.next,		\
+					__typeof__(*(pos)), member))
+
+/* @brief	Iterate over a chain of entries safe against freeing the
+ * current entry.
+ * @n:		another type * to use as temporary storage. */
+#define twllist_for_each_entry_safe(pos, n, node, member)		\
+	for ((pos) = twllist_entry_safe((node), __typeof__(*(pos)), member);\
+		(pos) && ((n) = twllist_entry_safe((pos)->member.next,	\
+					__typeof__(*(pos)), member), 1);\
+		(pos) = (n))
+
+/* @brief	Test whether a list is empty.
+ * @details	The answer may be stale as soon as it is returned if other
+ * threads use the list. */
+static int
+twllist_empty(const struct twllist_head *head)
+{
+	return __atomic_load_n(&head->first, __ATOMIC_RELAXED) == NULL;
+}
+
+static struct twllist_node *
+twllist_next(struct twllist_node *node)
+{
+	return node->next;
+}
+
+/* @brief	Add a chain of entries to the list.
+ * @first:	first entry of the chain
+ * @last:	last entry of the chain, linked to @first through next
+ * @head:	the list
+ * @details	Safe to call from any number of threads at once. Returns 1 if
+ * the list was empty before, e.g. to wake up the consumer only then. */
+static int
+twllist_add_batch(struct twllist_node *first, struct twllist_node *last,
+					struct twllist_head *head)
+{
+	struct twllist_node *old = __atomic_load_n(&head->first,
+							__ATOMIC_RELAXED);
+
+	do {
+		last->next = old;
+	} while (!__atomic_compare_exchange_n(&head->first, &old, first, 1,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	return old == NULL;
+}
+
+/* @brief	Add an entry to the list.
+ * @details	Safe to call from any number of threads at once. Returns 1 if
+ * the list was empty before. */
+static int
+twllist_add(struct twllist_node *node, struct twllist_head *head)
+{
+	return twllist_add_batch(node, node, head);
+}
+
+/* @brief	Take all entries out of the list.
+ * @details	Returns the first node of the chain, newest entry first, or
+ * NULL. Safe to call from any number of threads at once, concurrently with
+ * twllist_add, but not concurrently with twllist_del_first. */
+static struct twllist_node *
+twllist_del_all(struct twllist_head *head)
+{
+	return __atomic_exchange_n(&head->first, NULL, __ATOMIC_ACQUIRE);
+}
+
+/* @brief	Take the newest entry out of the list.
+ * @details	Returns NULL if the list is empty. Must be serialized against
+ * both twllist_del_first and twllist_del_all: another consumer taking the
+ * first entry, freeing or re-adding it between our load and the
+ * compare-and-swap makes the swap succeed with a stale next pointer (ABA
+ * problem). Safe concurrently with any number of twllist_add. */
+static struct twllist_node *
+twllist_del_first(struct twllist_head *head)
+{
+	struct twllist_node *entry, *next;
+
+	entry = __atomic_load_n(&head->first, __ATOMIC_ACQUIRE);
+	do {
+		if (entry == NULL)
+			return NULL;
+		next = __atomic_load_n(&entry->next, __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&head->first, &entry, next, 1,
+					__ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+	return entry;
+}
+
+/* @brief	Reverse a chain taken out of a list.
+ * @details	Returns the new first node. After twllist_del_all this puts
+ * the entries in the order they were added. */
+static struct twllist_node *
+twllist_reverse_order(struct twllist_node *node)
+{
+	struct twllist_node *tmp, *rev = NULL;
+
+	while (node)
+	{
+		tmp = node;
+		node = node->next;
+		tmp->next = rev;
+		rev = tmp;
+	}
+	return rev;
+}
+
+
+#endif	/* TWLLIST_H */
@@ -0,0 +1,302 @@
+/* @file        twlru.h
+ * @brief       Sharded LRU cache built on twhash_dyn and twlist.
+ * @details     Objects embed a struct twlru_node and are looked up by a 64 bit
+ *              key. Keys are spread over a power of two number of shards,
+ *              each with its own lock, resizable hashtable and LRU list, so
+ *              threads working on different keys mostly don't contend.
+ *              A lookup moves the object to the head of its shard's list,
+ *              an insertion into a full shard evicts objects from the tail.
+ *              The cache never frees objects, evicted ones are handed to the
+ *              evict callback which is called without the shard lock held
+ *              (it may free the object or put it back into the cache).
+ *              Capacity is split evenly between shards, the first
+ *              capacity % nshards shards holding one object more, so
+ *              eviction order is least recently used per shard, not
+ *              globally.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWLRU_H
+#define TWLRU_H
+
+
+#include "twlist.h"
+#include "twhash.h"
+#include "twhash_dyn.h"
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+
+/* @brief	Node to embed in cached objects. */
+struct twlru_node
+{
+	struct twhash_dyn_node	hnode;
+	struct twlist_head	lru;	/* most recently used first */
+	uint64_t		key;
+};
+
+/* @brief	Callbacks of a cache, both are optional.
+ * @evict:	called for objects pushed out of the cache, without locks held
+ * @get:	called for the object found by twlru_get with the shard lock
+ *		held, e.g. to take a reference so that a concurrent eviction
+ *		can't free the object before the caller is done with it */
+struct twlru_ops
+{
+	void	(*evict)(struct twlru_node *n, void *priv);
+	void	(*get)(struct twlru_node *n, void *priv);
+};
+
+struct twlru_shard
+{
+	pthread_mutex_t		lock;
+	struct twhash_dyn	ht;
+	struct twlist_head	lru;
+	size_t			count;
+	size_t			capacity;
+} __attribute__((aligned(TWCACHELINE_SIZE)));
+
+struct twlru
+{
+	struct twlru_shard	*shards;
+	unsigned int		nshards;	/* power of 2 */
+	const struct twlru_ops	*ops;
+	void			*priv;		/* passed to callbacks */
+};
+
+#define twlru_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+static struct twlru_shard *
+__twlru_shard(struct twlru *c, uint64_t key)
+{
+	return &c->shards[twhash_mix64(key) & (c->nshards - 1)];
+}
+
+/* @brief	Initialize a cache.
+ * @c:		the cache
+ * @capacity:	maximum number of objects, split between shards
+ * @nshards:	number of shards, rounded up to a power of 2
+ * @ops:	callbacks, may be NULL
+ * @priv:	passed to the callbacks
+ * @details	Every shard holds at least one object, so a @capacity below
+ * the number of shards is raised to it. Returns 0 on success, -1 on
+ * error. */
+static int
+twlru_init(struct twlru *c, size_t capacity, unsigned int nshards,
+			const struct twlru_ops *ops, void *priv)
+{
+	struct twlru_shard	*s;
+	unsigned int		i, n = 1;
+	size_t			per_shard, extra;
+
+	while (n < nshards)
+		n <<= 1;
+	if (capacity < n)
+		capacity = n;
+	per_shard = capacity / n;
+	extra = capacity % n;
+
+	if (posix_memalign((void **) &c->shards, TWCACHELINE_SIZE,
+				n * sizeof(*c->shards)) != 0)
+		return -1;
+	for (i = 0; i < n; i++)
+	{
+		s = &c->shards[i];
+		if (twhash_dyn_init(&s->ht, TWHASH_DYN_MIN_BITS) != 0)
+			goto fail;
+		if (pthread_mutex_init(&s->lock, NULL) != 0)
+		{
+			twhash_dyn_free(&s->ht);
+			goto fail;
+		}
+		TWINIT_LIST_HEAD(&s->lru);
+		s->count = 0;
+		s->capacity = per_shard + (i < extra);
+	}
+	c->nshards = n;
+	c->ops = ops;
+	c->priv = priv;
+	return 0;
+
+fail:
+	while (i--)
+	{
+		pthread_mutex_destroy(&c->shards[i].lock);
+		twhash_dyn_free(&c->shards[i].ht);
+	}
+	free(c->shards);
+	c->shards = NULL;
+	return -1;
+}
+
+/* Unlink @n from shard @s, lock held. */
+static void
+__twlru_unlink(struct twlru_shard *s, struct twlru_node *n)
+{
+	twhash_dyn_del(&s->ht, &n->hnode);
+	twlist_del(&n->lru);
+	s->count--;
+}
+
+/* Call evict on all objects linked through lru into @evicted. */
+static void
+__twlru_evict_list(struct twlru *c, struct twlist_head *evicted)
+{
+	struct twlru_node *n, *tmp;
+
+	twlist_for_each_entry_safe(n, tmp, evicted, lru)
+	{
+		twlist_del(&n->lru);
+		if (c->ops && c->ops->evict)
+			c->ops->evict(n, c->priv);
+	}
+}
+
+/* @brief	Release the cache.
+ * @details	Objects still in the cache are passed to the evict callback.
+ * No other thread may use the cache at this point. */
+static void
+twlru_free(struct twlru *c)
+{
+	struct twlist_head	evicted;
+	struct twlru_shard	*s;
+	unsigned int		i;
+
+	for (i = 0; i < c->nshards; i++)
+	{
+		s = &c->shards[i];
+		TWINIT_LIST_HEAD(&evicted);
+		twlist_splice_init(&s->lru, &evicted);
+		__twlru_evict_list(c, &evicted);
+		pthread_mutex_destroy(&s->lock);
+		twhash_dyn_free(&s->ht);
+	}
+	free(c->shards);
+	c->shards = NULL;
+	c->nshards = 0;
+}
+
+/* Find @key in shard @s, lock held. */
+static struct twlru_node *
+__twlru_find(struct twlru_shard *s, uint64_t key)
+{
+	struct twlru_node *n;
+
+	twhash_dyn_for_each_possible(&s->ht, n, hnode, key)
+	{
+		if (n->key == key)
+			return n;
+	}
+	return NULL;
+}
+
+/* @brief	Look up an object and mark it most recently used.
+ * @details	Returns NULL if @key isn't cached. The get callback, if any,
+ * is called on the object before the shard lock is released. */
+static struct twlru_node *
+twlru_get(struct twlru *c, uint64_t key)
+{
+	struct twlru_shard	*s = __twlru_shard(c, key);
+	struct twlru_node	*n;
+
+	pthread_mutex_lock(&s->lock);
+	n = __twlru_find(s, key);
+	if (n)
+	{
+		twlist_move(&n->lru, &s->lru);
+		if (c->ops && c->ops->get)
+			c->ops->get(n, c->priv);
+	}
+	pthread_mutex_unlock(&s->lock);
+	return n;
+}
+
+/* @brief	Insert an object, evicting the least recently used ones if the
+ * shard is full.
+ * @c:		the cache
+ * @n:		the object's node, must not be in the cache
+ * @key:	the key
+ * @details	An object with the same key already in the cache is replaced
+ * and handed to the evict callback together with the evicted ones. */
+static void
+twlru_insert(struct twlru *c, struct twlru_node *n, uint64_t key)
+{
+	struct twlru_shard	*s = __twlru_shard(c, key);
+	struct twlru_node	*old;
+	struct twlist_head	evicted;
+
+	TWINIT_LIST_HEAD(&evicted);
+	n->key = key;
+
+	pthread_mutex_lock(&s->lock);
+	old = __twlru_find(s, key);
+	if (old)
+	{
+		__twlru_unlink(s, old);
+		twlist_add_tail(&old->lru, &evicted);
+	}
+	twhash_dyn_add(&s->ht, &n->hnode, key);
+	twlist_add(&n->lru, &s->lru);
+	s->count++;
+	while (s->count > s->capacity)
+	{
+		old = twlist_last_entry(&s->lru, struct twlru_node, lru);
+		__twlru_unlink(s, old);
+		twlist_add_tail(&old->lru, &evicted);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	__twlru_evict_list(c, &evicted);
+}
+
+/* @brief	Remove an object from the cache.
+ * @details	Returns the removed object or NULL if @key wasn't cached.
+ * The evict callback is not called, the caller owns the object. */
+static struct twlru_node *
+twlru_del(struct twlru *c, uint64_t key)
+{
+	struct twlru_shard	*s = __twlru_shard(c, key);
+	struct twlru_node	*n;
+
+	pthread_mutex_lock(&s->lock);
+	n = __twlru_find(s, key);
+	if (n)
+		__twlru_unlink(s, n);
+	pthread_mutex_unlock(&s->lock);
+	return n;
+}
+
+/* @brief	Number of cached objects.
+ * @details	Shards are read one after another, the result may be stale
+ * if other threads modify the cache. */
+static size_t
+twlru_count(struct twlru *c)
+{
+	size_t		count = 0;
+	unsigned int	i;
+
+	for (i = 0; i < c->nshards; i++)
+		count += TWREAD_ONCE(c->shards[i].count);
+	return count;
+}
+
+/* @brief	Maximum number of cached objects. */
+static size_t
+twlru_capacity(const struct twlru *c)
+{
+	size_t		capacity = 0;
+	unsigned int	i;
+
+	for (i = 0; i < c->nshards; i++)
+		capacity += c->shards[i].capacity;
+	return capacity;
+}
+
+
+#endif	/* TWLRU_H */
@@ -0,0 +1,353 @@
+/* @file        twpool.h
+ * @brief       Fixed size object allocator with per-thread caches.
+ * @details     Objects of one size are carved out of page sized (or bigger,
+ *              for big objects) slabs, so objects allocated together lie
+ *              next to each other in memory. Free objects are kept on lists
+ *              threaded through a twlist_head placed over the object's own
+ *              memory, at offset 0 or at the offset given to
+ *              twpool_init_link, no bookkeeping is allocated per object.
+ *              The pool's free list is protected by a mutex. Threads which
+ *              allocate often keep a twpool_cache each: a private magazine
+ *              of free objects refilled from and flushed to the pool
+ *              TWPOOL_MAGAZINE objects at a time, so the lock is taken once
+ *              per that many operations.
+ *              Slabs are only released when the pool is destroyed, so the
+ *              memory of a freed object stays readable. The free link does
+ *              overwrite sizeof(struct twlist_head) bytes of it though: for
+ *              objects found by lockless readers, e.g. over twlist_nulls
+ *              chains, use twpool_init_link with a link which doesn't
+ *              overlap the twhlist_nulls_node or anything else the readers
+ *              look at, then those stay intact while the object is free.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWPOOL_H
+#define TWPOOL_H
+
+
+#include "twlist.h"
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+
+/* Number of objects moved between a thread cache and the pool at once.
+ * A cache holds up to twice as many. */
+#define TWPOOL_MAGAZINE		32
+
+/* Objects are aligned to at least this many bytes. */
+#define TWPOOL_ALIGN		(2 * sizeof(void *))
+
+/* Slabs hold at least this many objects. */
+#define TWPOOL_MIN_PER_SLAB	8
+
+struct twpool
+{
+	pthread_mutex_t		lock;
+	struct twlist_head	free;		/* free objects */
+	struct twlist_head	slabs;
+	size_t			obj_size;
+	size_t			link_off;	/* offset of the free link */
+	size_t			slab_size;
+	size_t			per_slab;	/* objects in a slab */
+	size_t			nfree;		/* length of free */
+	size_t			nslabs;
+	size_t			page;
+};
+
+/* @brief	Per-thread magazine of free objects of a pool.
+ * @details	Must be used by one thread only. */
+struct twpool_cache
+{
+	struct twpool		*pool;
+	struct twlist_head	free;
+	size_t			count;
+};
+
+/* Header at the start of each slab, objects follow. */
+struct twpool_slab
+{
+	struct twlist_head	link;
+};
+
+#define __TWPOOL_ROUNDUP(x, a)	(((x) + (a) - 1) / (a) * (a))
+
+#define __TWPOOL_SLAB_HDR	__TWPOOL_ROUNDUP(sizeof(struct twpool_slab), \
+							TWPOOL_ALIGN)
+
+/* The free link of object @obj. */
+static struct twlist_head *
+__twpool_link(size_t link_off, void *obj)
+{
+	return (struct twlist_head *) ((unsigned char *) obj + link_off);
+}
+
+/* The object of free link @link. */
+static void *
+__twpool_obj(size_t link_off, struct twlist_head *link)
+{
+	return (unsigned char *) link - link_off;
+}
+
+/* @brief	Initialize a pool of objects of @obj_size bytes whose free
+ * link lives at @link_off.
+ * @details	While an object is free the pool keeps a twlist_head at
+ * @link_off in it, the rest of the object is left alone. @link_off must be
+ * aligned for a pointer. Returns 0 on success, -1 on error. */
+static int
+twpool_init_link(struct twpool *p, size_t obj_size, size_t link_off)
+{
+	long	page = sysconf(_SC_PAGESIZE);
+	size_t	slab;
+
+	if (page <= 0)
+		page = 4096;
+	if (link_off % sizeof(void *))
+		return -1;
+	if (obj_size < link_off + sizeof(struct twlist_head))
+		obj_size = link_off + sizeof(struct twlist_head);
+	obj_size = __TWPOOL_ROUNDUP(obj_size, TWPOOL_ALIGN);
+
+	slab = (size_t) page;
+	while ((slab - __TWPOOL_SLAB_HDR) / obj_size < TWPOOL_MIN_PER_SLAB)
+		slab += (size_t) page;
+
+	if (pthread_mutex_init(&p->lock, NULL) != 0)
+		return -1;
+	TWINIT_LIST_HEAD(&p->free);
+	TWINIT_LIST_HEAD(&p->slabs);
+	p->obj_size = obj_size;
+	p->link_off = link_off;
+	p->slab_size = slab;
+	p->per_slab = (slab - __TWPOOL_SLAB_HDR) / obj_size;
+	p->nfree = 0;
+	p->nslabs = 0;
+	p->page = (size_t) page;
+	return 0;
+}
+
+/* @brief	Initialize a pool of objects of @obj_size bytes.
+ * @details	The free link overlays the first bytes of free objects, see
+ * twpool_init_link. Returns 0 on success, -1 on error. */
+static int
+twpool_init(struct twpool *p, size_t obj_size)
+{
+	return twpool_init_link(p, obj_size, 0);
+}
+
+/* @brief	Release all memory of the pool.
+ * @details	Objects still allocated become invalid, thread caches must
+ * have been destroyed before. */
+static void
+twpool_destroy(struct twpool *p)
+{
+	struct twlist_head *pos, *n;
+
+	twlist_for_each_safe(pos, n, &p->slabs)
+		free(twlist_entry(pos, struct twpool_slab, link));
+	TWINIT_LIST_HEAD(&p->slabs);
+	TWINIT_LIST_HEAD(&p->free);
+	p->nfree = 0;
+	p->nslabs = 0;
+	pthread_mutex_destroy(&p->lock);
+}
+
+/* Add a new slab to the free list, lock held. Objects are queued in
+ * address order so that they are handed out that way. */
+static int
+__twpool_grow(struct twpool *p)
+{
+	struct twpool_slab	*slab;
+	unsigned char		*obj;
+	size_t			i;
+
+	if (posix_memalign((void **) &slab, p->page, p->slab_size) != 0)
+		return -1;
+	twlist_add(&slab->link, &p->slabs);
+	obj = (unsigned char *) slab + __TWPOOL_SLAB_HDR;
+	for (i = 0; i < p->per_slab; i++, obj += p->obj_size)
+		twlist_add_tail(__twpool_link(p->link_off, obj), &p->free);
+	p->nfree += p->per_slab;
+	p->nslabs++;
+	return 0;
+}
+
+static void *
+__twpool_alloc(struct twpool *p)
+{
+	struct twlist_head *obj;
+
+	if (twlist_empty(&p->free) && __twpool_grow(p) != 0)
+		return NULL;
+	obj = p->free.next;
+	twlist_del(obj);
+	p->nfree--;
+	return __twpool_obj(p->link_off, obj);
+}
+
+/* @brief	Allocate an object from the pool.
+ * @details	Returns NULL if memory can't be allocated. */
+static void *
+twpool_alloc(struct twpool *p)
+{
+	void *obj;
+
+	pthread_mutex_lock(&p->lock);
+	obj = __twpool_alloc(p);
+	pthread_mutex_unlock(&p->lock);
+	return obj;
+}
+
+/* @brief	Return an object to the pool. */
+static void
+twpool_free(struct twpool *p, void *obj)
+{
+	pthread_mutex_lock(&p->lock);
+	twlist_add(__twpool_link(p->link_off, obj), &p->free);
+	p->nfree++;
+	pthread_mutex_unlock(&p->lock);
+}
+
+/* @brief	Allocate up to @n objects with one lock round trip.
+ * @details	Returns the number of objects stored in @objs, less than @n
+ * only if memory ran out. */
+static size_t
+twpool_alloc_bulk(struct twpool *p, void **objs, size_t n)
+{
+	size_t i;
+
+	pthread_mutex_lock(&p->lock);
+	for (i = 0; i < n; i++)
+	{
+		objs[i] = __twpool_alloc(p);
+		if (!objs[i])
+			break;
+	}
+	pthread_mutex_unlock(&p->lock);
+	return i;
+}
+
+/* @brief	Return @n objects to the pool with one lock round trip. */
+static void
+twpool_free_bulk(struct twpool *p, void **objs, size_t n)
+{
+	size_t i;
+
+	pthread_mutex_lock(&p->lock);
+	for (i = 0; i < n; i++)
+		twlist_add(__twpool_link(p->link_off, objs[i]), &p->free);
+	p->nfree += n;
+	pthread_mutex_unlock(&p->lock);
+}
+
+/* @brief	Size of the objects, as rounded by twpool_init. */
+static size_t
+twpool_obj_size(const struct twpool *p)
+{
+	return p->obj_size;
+}
+
+/* @brief	Initialize a thread cache of pool @p. */
+static void
+twpool_cache_init(struct twpool_cache *c, struct twpool *p)
+{
+	c->pool = p;
+	TWINIT_LIST_HEAD(&c->free);
+	c->count = 0;
+}
+
+/* Move a magazine from the pool to the cache, returns 0 if the pool
+ * couldn't give anything. */
+static size_t
+__twpool_cache_refill(struct twpool_cache *c)
+{
+	struct twpool		*p = c->pool;
+	struct twlist_head	*entry;
+	size_t			i, n;
+
+	pthread_mutex_lock(&p->lock);
+	if (p->nfree < TWPOOL_MAGAZINE)
+		__twpool_grow(p);
+	n = p->nfree < TWPOOL_MAGAZINE ? p->nfree : TWPOOL_MAGAZINE;
+	if (n)
+	{
+		entry = &p->free;
+		for (i = 0; i < n; i++)
+			entry = entry->next;
+		twlist_cut_position(&c->free, &p->free, entry);
+		p->nfree -= n;
+		c->count = n;
+	}
+	pthread_mutex_unlock(&p->lock);
+	return n;
+}
+
+/* Move @n least recently freed objects back to the pool, keeping the
+ * cache hot ones. */
+static void
+__twpool_cache_flush(struct twpool_cache *c, size_t n)
+{
+	struct twpool		*p = c->pool;
+	struct twlist_head	hot, *entry;
+	size_t			i;
+
+	/* cut off the first count - n objects, flush what is left */
+	entry = &c->free;
+	for (i = 0; i < c->count - n; i++)
+		entry = entry->next;
+	twlist_cut_position(&hot, &c->free, entry);
+
+	pthread_mutex_lock(&p->lock);
+	twlist_splice_init(&c->free, &p->free);
+	p->nfree += n;
+	pthread_mutex_unlock(&p->lock);
+
+	twlist_splice(&hot, &c->free);
+	c->count -= n;
+}
+
+/* @brief	Allocate an object through a thread cache.
+ * @details	Takes the pool lock only when the cache is empty. Returns NULL
+ * if memory can't be allocated. */
+static void *
+twpool_cache_alloc(struct twpool_cache *c)
+{
+	struct twlist_head *obj;
+
+	if (!c->count && !__twpool_cache_refill(c))
+		return NULL;
+	obj = c->free.next;
+	twlist_del(obj);
+	c->count--;
+	return __twpool_obj(c->pool->link_off, obj);
+}
+
+/* @brief	Free an object through a thread cache.
+ * @details	The object may have been allocated by any thread. Takes the
+ * pool lock only when the cache overflows. */
+static void
+twpool_cache_free(struct twpool_cache *c, void *obj)
+{
+	twlist_add(__twpool_link(c->pool->link_off, obj), &c->free);
+	c->count++;
+	if (c->count > 2 * TWPOOL_MAGAZINE)
+		__twpool_cache_flush(c, TWPOOL_MAGAZINE);
+}
+
+/* @brief	Return all objects cached by the thread to the pool. */
+static void
+twpool_cache_destroy(struct twpool_cache *c)
+{
+	if (c->count)
+		__twpool_cache_flush(c, c->count);
+}
+
+
+#endif	/* TWPOOL_H */
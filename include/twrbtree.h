@@ -0,0 +1,674 @@
+/* @file        twrbtree.h
+ * @brief       Intrusive red-black tree.
+ * @details     Based on Linux Kernel rbtree. struct twrb_node is embedded in
+ *              user objects and the object is recovered with twrb_entry, so
+ *              the tree never allocates and there is no extra pointer hop
+ *              from a node to its data. Parent pointer and node's color share
+ *              one word, nodes have to be aligned to at least 4 bytes.
+ *              Insertion is done in two steps, like in the kernel: the caller
+ *              walks the tree to find the place for the new node, links it
+ *              with twrb_link_node and rebalances with twrb_insert_color.
+ *              twrb_add, twrb_find and twrb_lower_bound wrap the common
+ *              cases given a comparison callback.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              rbtree.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWRBTREE_H
+#define TWRBTREE_H
+
+
+#include "twlist.h"
+
+
+#include <stddef.h>
+
+
+#define TWRB_RED	0
+#define TWRB_BLACK	1
+
+struct twrb_node
+{
+	unsigned long		__rb_parent_color;
+	struct twrb_node	*rb_right;
+	struct twrb_node	*rb_left;
+} __attribute__((aligned(sizeof(long))));
+
+struct twrb_root
+{
+	struct twrb_node	*rb_node;
+};
+
+#define TWRB_ROOT	(struct twrb_root) { NULL, }
+
+#define twrb_parent(r)	((struct twrb_node *) ((r)->__rb_parent_color & ~3UL))
+
+#define twrb_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+#define twrb_entry_safe(ptr, type, member) __extension__		\
+	({ __typeof__(ptr) ____ptr = (ptr);				\
+		____ptr ? twrb_entry(____ptr, type, member) : NULL;	\
+	})
+
+#define TWRB_EMPTY_ROOT(root)	((root)->rb_node == NULL)
+
+/* 'empty' nodes are nodes that are known not to be inserted in a tree */
+#define TWRB_EMPTY_NODE(node)	\
+	((node)->__rb_parent_color == (unsigned long) (node))
+#define TWRB_CLEAR_NODE(node)	\
+	((node)->__rb_parent_color = (unsigned long) (node))
+
+#define __twrb_parent(pc)	((struct twrb_node *) ((pc) & ~3UL))
+#define __twrb_color(pc)	((pc) & 1)
+#define __twrb_is_black(pc)	__twrb_color(pc)
+#define __twrb_is_red(pc)	(!__twrb_color(pc))
+#define twrb_color(rb)		__twrb_color((rb)->__rb_parent_color)
+#define twrb_is_red(rb)		__twrb_is_red((rb)->__rb_parent_color)
+#define twrb_is_black(rb)	__twrb_is_black((rb)->__rb_parent_color)
+
+static void
+twrb_set_parent(struct twrb_node *rb, struct twrb_node *p)
+{
+	rb->__rb_parent_color = twrb_color(rb) | (unsigned long) p;
+}
+
+static void
+twrb_set_parent_color(struct twrb_node *rb, struct twrb_node *p, int color)
+{
+	rb->__rb_parent_color = (unsigned long) p | color;
+}
+
+static void
+__twrb_change_child(struct twrb_node *old, struct twrb_node *new_node,
+			struct twrb_node *parent, struct twrb_root *root)
+{
+	if (parent)
+	{
+		if (parent->rb_left == old)
+			parent->rb_left = new_node;
+		else
+			parent->rb_right = new_node;
+	} else
+		root->rb_node = new_node;
+}
+
+/* Helper for rotations: @new_node takes over @old's parent and color, @old
+ * becomes a child of @new_node with given @color. */
+static void
+__twrb_rotate_set_parents(struct twrb_node *old, struct twrb_node *new_node,
+				struct twrb_root *root, int color)
+{
+	struct twrb_node *parent = twrb_parent(old);
+
+	new_node->__rb_parent_color = old->__rb_parent_color;
+	twrb_set_parent_color(old, new_node, color);
+	__twrb_change_child(old, new_node, parent, root);
+}
+
+/* @brief	Link a new node into the tree.
+ * @node:	the node to insert
+ * @parent:	the node which will be @node's parent
+ * @rb_link:	address of the child pointer of @parent to set
+ * @details	Must be followed by twrb_insert_color. */
+static void
+twrb_link_node(struct twrb_node *node, struct twrb_node *parent,
+				struct twrb_node **rb_link)
+{
+	node->__rb_parent_color = (unsigned long) parent;
+	node->rb_left = node->rb_right = NULL;
+	*rb_link = node;
+}
+
+/* @brief	Rebalance the tree after twrb_link_node. */
+static void
+twrb_insert_color(struct twrb_node *node, struct twrb_root *root)
+{
+	struct twrb_node *parent = twrb_parent(node), *gparent, *tmp;
+
+	for (;;)
+	{
+		/* loop invariant: node is red */
+		if (!parent)
+		{
+			/* inserted the root or node got propagated up to it,
+			 * only place where black height grows */
+			twrb_set_parent_color(node, NULL, TWRB_BLACK);
+			break;
+		}
+
+		/* if there is a black parent, we are done */
+		if (twrb_is_black(parent))
+			break;
+
+		gparent = twrb_parent(parent);
+		tmp = gparent->rb_right;
+		if (parent != tmp)	/* parent == gparent->rb_left */
+		{
+			if (tmp && twrb_is_red(tmp))
+			{
+				/* Case 1 - node's uncle is red, color flips */
+				twrb_set_parent_color(tmp, gparent, TWRB_BLACK);
+				twrb_set_parent_color(parent, gparent, TWRB_BLACK);
+				node = gparent;
+				parent = twrb_parent(node);
+				twrb_set_parent_color(node, parent, TWRB_RED);
+				continue;
+			}
+
+			tmp = parent->rb_right;
+			if (node == tmp)
+			{
+				/* Case 2 - node's uncle is black and node is
+				 * the parent's right child, left rotate at
+				 * parent */
+				tmp = node->rb_left;
+				parent->rb_right = tmp;
+				node->rb_left = parent;
+				if (tmp)
+					twrb_set_parent_color(tmp, parent,
+								TWRB_BLACK);
+				twrb_set_parent_color(parent, node, TWRB_RED);
+				parent = node;
+				tmp = node->rb_right;
+			}
+
+			/* Case 3 - node's uncle is black and node is
+			 * the parent's left child, right rotate at gparent */
+			gparent->rb_left = tmp;	/* == parent->rb_right */
+			parent->rb_right = gparent;
+			if (tmp)
+				twrb_set_parent_color(tmp, gparent, TWRB_BLACK);
+			__twrb_rotate_set_parents(gparent, parent, root, TWRB_RED);
+			break;
+		} else {
+			tmp = gparent->rb_left;
+			if (tmp && twrb_is_red(tmp))
+			{
+				/* Case 1 - color flips */
+				twrb_set_parent_color(tmp, gparent, TWRB_BLACK);
+				twrb_set_parent_color(parent, gparent, TWRB_BLACK);
+				node = gparent;
+				parent = twrb_parent(node);
+				twrb_set_parent_color(node, parent, TWRB_RED);
+				continue;
+			}
+
+			tmp = parent->rb_left;
+			if (node == tmp)
+			{
+				/* Case 2 - right rotate at parent */
+				tmp = node->rb_right;
+				parent->rb_left = tmp;
+				node->rb_right = parent;
+				if (tmp)
+					twrb_set_parent_color(tmp, parent,
+								TWRB_BLACK);
+				twrb_set_parent_color(parent, node, TWRB_RED);
+				parent = node;
+				tmp = node->rb_left;
+			}
+
+			/* Case 3 - left rotate at gparent */
+			gparent->rb_right = tmp;	/* == parent->rb_left */
+			parent->rb_left = gparent;
+			if (tmp)
+				twrb_set_parent_color(tmp, gparent, TWRB_BLACK);
+			__twrb_rotate_set_parents(gparent, parent, root, TWRB_RED);
+			break;
+		}
+	}
+}
+
+/* Unlink @node, returns the node where black height is short by one
+ * and the tree has to be rebalanced from, or NULL. */
+static struct twrb_node *
+__twrb_erase(struct twrb_node *node, struct twrb_root *root)
+{
+	struct twrb_node	*child = node->rb_right;
+	struct twrb_node	*tmp = node->rb_left;
+	struct twrb_node	*parent, *rebalance;
+	unsigned long		pc;
+
+	if (!tmp)
+	{
+		/* Case 1: node to erase has no more than 1 child (easy!).
+		 * If there is one child it must be red and node black. */
+		pc = node->__rb_parent_color;
+		parent = __twrb_parent(pc);
+		__twrb_change_child(node, child, parent, root);
+		if (child)
+		{
+			child->__rb_parent_color = pc;
+			rebalance = NULL;
+		} else
+			rebalance = __twrb_is_black(pc) ? parent : NULL;
+	} else if (!child) {
+		/* still case 1, but this time the child is node->rb_left */
+		tmp->__rb_parent_color = pc = node->__rb_parent_color;
+		parent = __twrb_parent(pc);
+		__twrb_change_child(node, tmp, parent, root);
+		rebalance = NULL;
+	} else {
+		struct twrb_node *successor = child, *child2;
+
+		tmp = child->rb_left;
+		if (!tmp)
+		{
+			/* Case 2: node's successor is its right child */
+			parent = successor;
+			child2 = successor->rb_right;
+		} else {
+			/* Case 3: node's successor is leftmost under
+			 * node's right child subtree */
+			do {
+				parent = successor;
+				successor = tmp;
+				tmp = tmp->rb_left;
+			} while (tmp);
+			child2 = successor->rb_right;
+			parent->rb_left = child2;
+			successor->rb_right = child;
+			twrb_set_parent(child, successor);
+		}
+
+		tmp = node->rb_left;
+		successor->rb_left = tmp;
+		twrb_set_parent(tmp, successor);
+
+		pc = node->__rb_parent_color;
+		tmp = __twrb_parent(pc);
+		__twrb_change_child(node, successor, tmp, root);
+
+		if (child2)
+		{
+			successor->__rb_parent_color = pc;
+			twrb_set_parent_color(child2, parent, TWRB_BLACK);
+			rebalance = NULL;
+		} else {
+			unsigned long pc2 = successor->__rb_parent_color;
+
+			successor->__rb_parent_color = pc;
+			rebalance = __twrb_is_black(pc2) ? parent : NULL;
+		}
+	}
+	return rebalance;
+}
+
+/* Restore red-black properties after erase, @parent's subtree on the
+ * side of the erased node is short of one black node. */
+static void
+__twrb_erase_color(struct twrb_node *parent, struct twrb_root *root)
+{
+	struct twrb_node *node = NULL, *sibling, *tmp1, *tmp2;
+
+	for (;;)
+	{
+		/* Loop invariants:
+		 * - node is black (or NULL on first iteration)
+		 * - node is not the root (parent is not NULL)
+		 * - all leaf paths going through parent and node have a
+		 *   black node count that is 1 lower than other leaf paths */
+		sibling = parent->rb_right;
+		if (node != sibling)	/* node == parent->rb_left */
+		{
+			if (twrb_is_red(sibling))
+			{
+				/* Case 1 - left rotate at parent */
+				tmp1 = sibling->rb_left;
+				parent->rb_right = tmp1;
+				sibling->rb_left = parent;
+				twrb_set_parent_color(tmp1, parent, TWRB_BLACK);
+				__twrb_rotate_set_parents(parent, sibling, root,
+								TWRB_RED);
+				sibling = tmp1;
+			}
+			tmp1 = sibling->rb_right;
+			if (!tmp1 || twrb_is_black(tmp1))
+			{
+				tmp2 = sibling->rb_left;
+				if (!tmp2 || twrb_is_black(tmp2))
+				{
+					/* Case 2 - sibling color flip */
+					twrb_set_parent_color(sibling, parent,
+								TWRB_RED);
+					if (twrb_is_red(parent))
+						parent->__rb_parent_color |= TWRB_BLACK;
+					else {
+						node = parent;
+						parent = twrb_parent(node);
+						if (parent)
+							continue;
+					}
+					break;
+				}
+				/* Case 3 - right rotate at sibling */
+				tmp1 = tmp2->rb_right;
+				sibling->rb_left = tmp1;
+				tmp2->rb_right = sibling;
+				parent->rb_right = tmp2;
+				if (tmp1)
+					twrb_set_parent_color(tmp1, sibling,
+								TWRB_BLACK);
+				tmp1 = sibling;
+				sibling = tmp2;
+			}
+			/* Case 4 - left rotate at parent + color flips */
+			tmp2 = sibling->rb_left;
+			parent->rb_right = tmp2;
+			sibling->rb_left = parent;
+			twrb_set_parent_color(tmp1, sibling, TWRB_BLACK);
+			if (tmp2)
+				twrb_set_parent(tmp2, parent);
+			__twrb_rotate_set_parents(parent, sibling, root,
+								TWRB_BLACK);
+			break;
+		} else {
+			sibling = parent->rb_left;
+			if (twrb_is_red(sibling))
+			{
+				/* Case 1 - right rotate at parent */
+				tmp1 = sibling->rb_right;
+				parent->rb_left = tmp1;
+				sibling->rb_right = parent;
+				twrb_set_parent_color(tmp1, parent, TWRB_BLACK);
+				__twrb_rotate_set_parents(parent, sibling, root,
+								TWRB_RED);
+				sibling = tmp1;
+			}
+			tmp1 = sibling->rb_left;
+			if (!tmp1 || twrb_is_black(tmp1))
+			{
+				tmp2 = sibling->rb_right;
+				if (!tmp2 || twrb_is_black(tmp2))
+				{
+					/* Case 2 - sibling color flip */
+					twrb_set_parent_color(sibling, parent,
+								TWRB_RED);
+					if (twrb_is_red(parent))
+						parent->__rb_parent_color |= TWRB_BLACK;
+					else {
+						node = parent;
+						parent = twrb_parent(node);
+						if (parent)
+							continue;
+					}
+					break;
+				}
+				/* Case 3 - left rotate at sibling */
+				tmp1 = tmp2->rb_left;
+				sibling->rb_right = tmp1;
+				tmp2->rb_left = sibling;
+				parent->rb_left = tmp2;
+				if (tmp1)
+					twrb_set_parent_color(tmp1, sibling,
+								TWRB_BLACK);
+				tmp1 = sibling;
+				sibling = tmp2;
+			}
+			/* Case 4 - right rotate at parent + color flips */
+			tmp2 = sibling->rb_right;
+			parent->rb_left = tmp2;
+			sibling->rb_right = parent;
+			twrb_set_parent_color(tmp1, sibling, TWRB_BLACK);
+			if (tmp2)
+				twrb_set_parent(tmp2, parent);
+			__twrb_rotate_set_parents(parent, sibling, root,
+								TWRB_BLACK);
+			break;
+		}
+	}
+}
+
+/* @brief	Remove a node from the tree.
+ * @details	The node isn't cleared, use TWRB_CLEAR_NODE if you need
+ * TWRB_EMPTY_NODE to report it as not inserted. */
+static void
+twrb_erase(struct twrb_node *node, struct twrb_root *root)
+{
+	struct twrb_node *rebalance;
+
+	rebalance = __twrb_erase(node, root);
+	if (rebalance)
+		__twrb_erase_color(rebalance, root);
+}
+
+/* @brief	Replace @victim with @new_node in place, without rebalancing.
+ * @details	@new_node must sort the same as @victim. */
+static void
+twrb_replace_node(struct twrb_node *victim, struct twrb_node *new_node,
+					struct twrb_root *root)
+{
+	struct twrb_node *parent = twrb_parent(victim);
+
+	*new_node = *victim;
+	if (victim->rb_left)
+		twrb_set_parent(victim->rb_left, new_node);
+	if (victim->rb_right)
+		twrb_set_parent(victim->rb_right, new_node);
+	__twrb_change_child(victim, new_node, parent, root);
+}
+
+/* @brief	First node in sort order or NULL if the tree is empty. */
+static struct twrb_node *
+twrb_first(const struct twrb_root *root)
+{
+	struct twrb_node *n = root->rb_node;
+
+	if (!n)
+		return NULL;
+	while (n->rb_left)
+		n = n->rb_left;
+	return n;
+}
+
+/* @brief	Last node in sort order or NULL if the tree is empty. */
+static struct twrb_node *
+twrb_last(const struct twrb_root *root)
+{
+	struct twrb_node *n = root->rb_node;
+
+	if (!n)
+		return NULL;
+	while (n->rb_right)
+		n = n->rb_right;
+	return n;
+}
+
+/* @brief	Next node in sort order or NULL. */
+static struct twrb_node *
+twrb_next(const struct twrb_node *node)
+{
+	struct twrb_node *parent;
+
+	if (TWRB_EMPTY_NODE(node))
+		return NULL;
+
+	/* if we have a right-hand child, go down and then left as far
+	 * as we can */
+	if (node->rb_right)
+	{
+		node = node->rb_right;
+		while (node->rb_left)
+			node = node->rb_left;
+		return (struct twrb_node *) node;
+	}
+
+	/* no right-hand children, go up till we find an ancestor which
+	 * is a left-hand child of its parent */
+	while ((parent = twrb_parent(node)) && node == parent->rb_right)
+		node = parent;
+	return parent;
+}
+
+/* @brief	Previous node in sort order or NULL. */
+static struct twrb_node *
+twrb_prev(const struct twrb_node *node)
+{
+	struct twrb_node *parent;
+
+	if (TWRB_EMPTY_NODE(node))
+		return NULL;
+
+	if (node->rb_left)
+	{
+		node = node->rb_left;
+		while (node->rb_right)
+			node = node->rb_right;
+		return (struct twrb_node *) node;
+	}
+
+	while ((parent = twrb_parent(node)) && node == parent->rb_left)
+		node = parent;
+	return parent;
+}
+
+static struct twrb_node *
+__twrb_left_deepest_node(const struct twrb_node *node)
+{
+	for (;;)
+	{
+		if (node->rb_left)
+			node = node->rb_left;
+		else if (node->rb_right)
+			node = node->rb_right;
+		else
+			return (struct twrb_node *) node;
+	}
+}
+
+/* @brief	Next node in postorder, children before their parents. */
+static struct twrb_node *
+twrb_next_postorder(const struct twrb_node *node)
+{
+	const struct twrb_node *parent;
+
+	if (!node)
+		return NULL;
+	parent = twrb_parent(node);
+
+	/* if we're sitting on node, we've already seen our children */
+	if (parent && node == parent->rb_left && parent->rb_right)
+		/* if we are the parent's left node, go to the parent's right
+		 * node then all the way down to the left */
+		return __twrb_left_deepest_node(parent->rb_right);
+	/* otherwise we are the parent's right node, and the parent
+	 * should be next */
+	return (struct twrb_node *) parent;
+}
+
+/* @brief	First node in postorder. */
+static struct twrb_node *
+twrb_first_postorder(const struct twrb_root *root)
+{
+	if (!root->rb_node)
+		return NULL;
+	return __twrb_left_deepest_node(root->rb_node);
+}
+
+/* @brief	Insert @node into the tree ordered by @less.
+ * @less:	returns non zero if the first node sorts before the second
+ * @details	Nodes equal to already inserted ones go after them. */
+static void
+twrb_add(struct twrb_node *node, struct twrb_root *root,
+	int (*less)(const struct twrb_node *, const struct twrb_node *))
+{
+	struct twrb_node **link = &root->rb_node, *parent = NULL;
+
+	while (*link)
+	{
+		parent = *link;
+		if (less(node, parent))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	twrb_link_node(node, parent, link);
+	twrb_insert_color(node, root);
+}
+
+/* @brief	Find a node equal to @key.
+ * @cmp:	returns < 0, 0 or > 0 if @key is less than, equal to or greater
+ *		than the node
+ * @details	Returns any of the matching nodes or NULL. */
+static struct twrb_node *
+twrb_find(const void *key, const struct twrb_root *root,
+	int (*cmp)(const void *key, const struct twrb_node *))
+{
+	struct twrb_node	*node = root->rb_node;
+	int			c;
+
+	while (node)
+	{
+		c = cmp(key, node);
+		if (c < 0)
+			node = node->rb_left;
+		else if (c > 0)
+			node = node->rb_right;
+		else
+			return node;
+	}
+	return NULL;
+}
+
+/* @brief	Find the first node not less than @key.
+ * @cmp:	as in twrb_find
+ * @details	Returns NULL if all nodes are less than @key. */
+static struct twrb_node *
+twrb_lower_bound(const void *key, const struct twrb_root *root,
+	int (*cmp)(const void *key, const struct twrb_node *))
+{
+	struct twrb_node *node = root->rb_node, *match = NULL;
+
+	while (node)
+	{
+		if (cmp(key, node) <= 0)
+		{
+			match = node;
+			node = node->rb_left;
+		} else
+			node = node->rb_right;
+	}
+	return match;
+}
+
+/* @brief	Iterate over tree of given type in sort order.
+ * @pos:	the type * to use as a loop cursor
+ * @root:	the &struct twrb_root
+ * @member:	the name of the twrb_node within the struct */
+#define twrb_for_each_entry(pos, root, member)				\
+	for (pos = twrb_entry_safe(twrb_first(root), __typeof__(*(pos)), member);\
+		pos;							\
+		pos = twrb_entry_safe(twrb_next(&(pos)->member),	\
+			__typeof__(*(pos)), member))
+
+/* @brief	Iterate over tree of given type in sort order starting
+ * from the current point.
+ * @pos:	the type * to use as a loop cursor, first entry visited
+ * @member:	the name of the twrb_node within the struct */
+#define twrb_for_each_entry_from(pos, member)				\
+	for (; pos;							\
+		pos = twrb_entry_safe(twrb_next(&(pos)->member),	\
+			__typeof__(*(pos)), member))
+
+/* @brief	Postorder iteration over tree of given type, safe against
+ * removal of the entry.
+ * @pos:	the type * to use as a loop cursor
+ * @n:		another type * to use as temporary storage
+ * @root:	the &struct twrb_root
+ * @member:	the name of the twrb_node within the struct
+ * @details	Children are visited before their parents, so all entries
+ * can be freed without erasing them first. The tree is not rebalanced,
+ * twrb_erase must not be called on the entries. */
+#define twrb_postorder_for_each_entry_safe(pos, n, root, member)	\
+	for (pos = twrb_entry_safe(twrb_first_postorder(root),		\
+			__typeof__(*(pos)), member);			\
+		pos && (n = twrb_entry_safe(twrb_next_postorder(&(pos)->member),\
+			__typeof__(*(pos)), member), 1);		\
+		pos = n)
+
+
+#endif	/* TWRBTREE_H */
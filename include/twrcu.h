@@ -0,0 +1,187 @@
+/* @file        twrcu.h
+ * @brief       Userspace epoch based reclamation for the _rcu lists.
+ * @details     Readers register with a domain and bracket their lookups
+ *              with twrcu_read_lock/twrcu_read_unlock. Those only store the
+ *              current epoch into reader's own counter, readers never wait.
+ *              Writers unlink nodes with the _rcu primitives and either wait
+ *              for all readers which could still see them (twrcu_synchronize)
+ *              or queue them with twrcu_call and free them in batches with
+ *              twrcu_reclaim.
+ *              Read-side critical sections don't nest, twrcu_synchronize and
+ *              twrcu_reclaim must not be called from inside of one.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWRCU_H
+#define TWRCU_H
+
+
+#include "twlist.h"
+#include "twlist_rcu.h"
+
+
+#include <pthread.h>
+#include <sched.h>
+
+
+/* @brief	Deferred callback, embed it in objects freed with twrcu_call. */
+struct twrcu_head
+{
+	struct twrcu_head	*next;
+	void			(*func)(struct twrcu_head *head);
+};
+
+struct twrcu_domain
+{
+	unsigned long		gp;		/* current epoch, never 0 */
+	pthread_mutex_t		lock;		/* readers list and gp updates */
+	struct twlist_head	readers;
+	pthread_mutex_t		cb_lock;	/* pending callbacks */
+	struct twrcu_head	*cbs;
+};
+
+/* @brief	Per thread reader state.
+ * @details	ctr is 0 outside of read-side critical sections and the epoch
+ * observed on entry otherwise. */
+struct twrcu_reader
+{
+	unsigned long		ctr;
+	struct twrcu_domain	*d;
+	struct twlist_head	link;
+};
+
+/* @brief	Initialize reclamation domain.
+ * @details	Returns 0 on success, -1 on error. */
+static int
+twrcu_domain_init(struct twrcu_domain *d)
+{
+	d->gp = 1;
+	TWINIT_LIST_HEAD(&d->readers);
+	d->cbs = NULL;
+	if (pthread_mutex_init(&d->lock, NULL) != 0)
+		return -1;
+	if (pthread_mutex_init(&d->cb_lock, NULL) != 0)
+	{
+		pthread_mutex_destroy(&d->lock);
+		return -1;
+	}
+	return 0;
+}
+
+/* @brief	Register calling thread as a reader of the domain. */
+static void
+twrcu_register(struct twrcu_domain *d, struct twrcu_reader *r)
+{
+	r->ctr = 0;
+	r->d = d;
+	pthread_mutex_lock(&d->lock);
+	twlist_add(&r->link, &d->readers);
+	pthread_mutex_unlock(&d->lock);
+}
+
+/* @brief	Unregister a reader, it must be outside of critical section. */
+static void
+twrcu_unregister(struct twrcu_reader *r)
+{
+	struct twrcu_domain *d = r->d;
+
+	pthread_mutex_lock(&d->lock);
+	twlist_del(&r->link);
+	pthread_mutex_unlock(&d->lock);
+}
+
+/* @brief	Enter read-side critical section.
+ * @details	The exchange is a full barrier: our epoch is visible to
+ * writers before we load any pointer of the protected structure. */
+static void
+twrcu_read_lock(struct twrcu_reader *r)
+{
+	__atomic_exchange_n(&r->ctr, __atomic_load_n(&r->d->gp,
+				__ATOMIC_RELAXED), __ATOMIC_SEQ_CST);
+}
+
+/* @brief	Leave read-side critical section. */
+static void
+twrcu_read_unlock(struct twrcu_reader *r)
+{
+	__atomic_store_n(&r->ctr, 0, __ATOMIC_RELEASE);
+}
+
+/* @brief	Wait until all read-side critical sections which were running
+ * at the time of the call have completed.
+ * @details	Anything unlinked before the call can be freed after it. */
+static void
+twrcu_synchronize(struct twrcu_domain *d)
+{
+	struct twrcu_reader	*r;
+	unsigned long		gp, ctr;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&d->lock);
+	gp = d->gp + 1;
+	if (gp == 0)
+		gp = 1;
+	__atomic_store_n(&d->gp, gp, __ATOMIC_SEQ_CST);
+	twlist_for_each_entry(r, &d->readers, link)
+	{
+		/* readers which entered after the epoch bump can't see
+		 * anything unlinked before it */
+		while ((ctr = __atomic_load_n(&r->ctr, __ATOMIC_ACQUIRE)) != 0
+				&& ctr != gp)
+			sched_yield();
+	}
+	pthread_mutex_unlock(&d->lock);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* @brief	Queue @func to be called on @head after a grace period.
+ * @details	Callbacks are run by twrcu_reclaim. */
+static void
+twrcu_call(struct twrcu_domain *d, struct twrcu_head *head,
+			void (*func)(struct twrcu_head *head))
+{
+	head->func = func;
+	pthread_mutex_lock(&d->cb_lock);
+	head->next = d->cbs;
+	d->cbs = head;
+	pthread_mutex_unlock(&d->cb_lock);
+}
+
+/* @brief	Run all callbacks queued so far.
+ * @details	Waits for one grace period for the whole batch. */
+static void
+twrcu_reclaim(struct twrcu_domain *d)
+{
+	struct twrcu_head *list, *next;
+
+	pthread_mutex_lock(&d->cb_lock);
+	list = d->cbs;
+	d->cbs = NULL;
+	pthread_mutex_unlock(&d->cb_lock);
+	if (!list)
+		return;
+
+	twrcu_synchronize(d);
+	for (; list; list = next)
+	{
+		next = list->next;
+		list->func(list);
+	}
+}
+
+/* @brief	Run pending callbacks and release domain resources.
+ * @details	All readers must have been unregistered. */
+static void
+twrcu_domain_destroy(struct twrcu_domain *d)
+{
+	twrcu_reclaim(d);
+	pthread_mutex_destroy(&d->cb_lock);
+	pthread_mutex_destroy(&d->lock);
+}
+
+
+#endif	/* TWRCU_H */
@@ -0,0 +1,319 @@
+/* @file        twskiplist.h
+ * @brief       Intrusive skip list.
+ * @details     Ordered container with O(log n) expected insert, delete and
+ *              seek. Nodes are embedded in user objects like twlist_head.
+ *              Level 0 of the list is an ordinary twlist, so all the elements
+ *              can be walked in order (or backwards) exactly like a twlist,
+ *              and the node's higher levels are an embedded tower of forward
+ *              pointers. Each node is promoted to the next level with
+ *              probability 1/4.
+ *              Elements with equal keys are kept in insertion order.
+ *              Not thread safe, the caller serializes access.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWSKIPLIST_H
+#define TWSKIPLIST_H
+
+
+#include "twlist.h"
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* Height of the tallest tower. With promotion probability of 1/4 the list
+ * stays balanced up to about 4^TWSKIPLIST_MAX_LEVEL elements, each level
+ * costs a pointer in every node. */
+#ifndef TWSKIPLIST_MAX_LEVEL
+#define TWSKIPLIST_MAX_LEVEL	12
+#endif
+
+struct twskiplist_node
+{
+	struct twlist_head	list;	/* level 0 */
+	unsigned int		level;	/* height of the tower */
+	struct twskiplist_node	*next[TWSKIPLIST_MAX_LEVEL - 1];	/* levels 1.. */
+};
+
+/* @brief	Ordering of two nodes.
+ * @details	Must return < 0, 0 or > 0 if @a is less than, equal to or
+ * greater than @b. */
+typedef int (*twskiplist_cmp_func_t)(const struct twskiplist_node *a,
+					const struct twskiplist_node *b);
+
+/* @brief	Ordering of a node and a key, for lookups.
+ * @details	Must return < 0, 0 or > 0 if @n is less than, equal to or
+ * greater than @key and agree with the node ordering of the list. */
+typedef int (*twskiplist_key_cmp_func_t)(const struct twskiplist_node *n,
+					const void *key);
+
+struct twskiplist
+{
+	struct twskiplist_node	head;	/* sentinel, head.list is list head */
+	unsigned int		level;	/* levels in use, at least 1 */
+	size_t			count;
+	uint64_t		rnd;	/* state of level generator */
+	twskiplist_cmp_func_t	cmp;
+};
+
+#define twskiplist_entry(ptr, type, member) \
+		tw_container_of(ptr, type, member)
+
+#define twskiplist_entry_safe(ptr, type, member) __extension__		\
+	({ __typeof__(ptr) ____ptr = (ptr);				\
+		____ptr ? twskiplist_entry(____ptr, type, member) : NULL; \
+	})
+
+/* @brief	Initialize an empty skip list.
+ * @sl:	the list
+ * @cmp:	node ordering
+ * @seed:	seed of the level generator, any value */
+static void
+twskiplist_init(struct twskiplist *sl, twskiplist_cmp_func_t cmp,
+					uint64_t seed)
+{
+	unsigned int i;
+
+	TWINIT_LIST_HEAD(&sl->head.list);
+	sl->head.level = TWSKIPLIST_MAX_LEVEL;
+	for (i = 0; i < TWSKIPLIST_MAX_LEVEL - 1; i++)
+		sl->head.next[i] = NULL;
+	sl->level = 1;
+	sl->count = 0;
+	sl->rnd = seed | 1;
+	sl->cmp = cmp;
+}
+
+/* Next node on @level or NULL at the end of the list. */
+static struct twskiplist_node *
+__twskiplist_next(const struct twskiplist *sl,
+			const struct twskiplist_node *n, unsigned int level)
+{
+	if (level)
+		return n->next[level - 1];
+	if (n->list.next == &sl->head.list)
+		return NULL;
+	return twlist_entry(n->list.next, struct twskiplist_node, list);
+}
+
+static void
+__twskiplist_set_next(struct twskiplist_node *n, unsigned int level,
+					struct twskiplist_node *next)
+{
+	n->next[level - 1] = next;
+}
+
+/* Height of a new tower: 1 + number of trailing zero bit pairs of
+ * a random number. */
+static unsigned int
+__twskiplist_random_level(struct twskiplist *sl)
+{
+	uint64_t	r;
+	unsigned int	level;
+
+	/* xorshift64 */
+	r = sl->rnd;
+	r ^= r << 13;
+	r ^= r >> 7;
+	r ^= r << 17;
+	sl->rnd = r;
+
+	level = 1 + __builtin_ctzll(r | (1ULL << 63)) / 2;
+	return level < TWSKIPLIST_MAX_LEVEL ? level : TWSKIPLIST_MAX_LEVEL;
+}
+
+/* @brief	Check whether skip list is empty. */
+static int
+twskiplist_empty(const struct twskiplist *sl)
+{
+	return twlist_empty(&sl->head.list);
+}
+
+/* @brief	Number of nodes in the list. */
+static size_t
+twskiplist_count(const struct twskiplist *sl)
+{
+	return sl->count;
+}
+
+/* @brief	Smallest node or NULL if the list is empty. */
+static struct twskiplist_node *
+twskiplist_first(const struct twskiplist *sl)
+{
+	return __twskiplist_next(sl, &sl->head, 0);
+}
+
+/* @brief	Greatest node or NULL if the list is empty. */
+static struct twskiplist_node *
+twskiplist_last(const struct twskiplist *sl)
+{
+	if (twskiplist_empty(sl))
+		return NULL;
+	return twlist_entry(sl->head.list.prev, struct twskiplist_node, list);
+}
+
+/* @brief	Successor of @n or NULL. */
+static struct twskiplist_node *
+twskiplist_next(const struct twskiplist *sl, const struct twskiplist_node *n)
+{
+	return __twskiplist_next(sl, n, 0);
+}
+
+/* @brief	Predecessor of @n or NULL. */
+static struct twskiplist_node *
+twskiplist_prev(const struct twskiplist *sl, const struct twskiplist_node *n)
+{
+	if (n->list.prev == &sl->head.list)
+		return NULL;
+	return twlist_entry(n->list.prev, struct twskiplist_node, list);
+}
+
+/* @brief	Insert a node.
+ * @sl:	the list
+ * @n:		the node to insert, must not be in any list
+ * @details	@n goes after all nodes equal to it. */
+static void
+twskiplist_insert(struct twskiplist *sl, struct twskiplist_node *n)
+{
+	struct twskiplist_node	*update[TWSKIPLIST_MAX_LEVEL];
+	struct twskiplist_node	*x = &sl->head, *nx;
+	unsigned int		i, level;
+
+	i = sl->level;
+	while (i--)
+	{
+		while ((nx = __twskiplist_next(sl, x, i)) && sl->cmp(nx, n) <= 0)
+			x = nx;
+		update[i] = x;
+	}
+
+	level = __twskiplist_random_level(sl);
+	for (i = sl->level; i < level; i++)
+		update[i] = &sl->head;
+	if (level > sl->level)
+		sl->level = level;
+
+	n->level = level;
+	twlist_add(&n->list, &update[0]->list);
+	for (i = 1; i < level; i++)
+	{
+		__twskiplist_set_next(n, i, update[i]->next[i - 1]);
+		__twskiplist_set_next(update[i], i, n);
+	}
+	sl->count++;
+}
+
+/* @brief	Remove a node from the list.
+ * @sl:	the list
+ * @n:		the node to remove, must be in @sl */
+static void
+twskiplist_del(struct twskiplist *sl, struct twskiplist_node *n)
+{
+	struct twskiplist_node	*x = &sl->head, *nx;
+	unsigned int		i = sl->level;
+
+	while (i-- > 1)
+	{
+		/* above the tower of @n only smaller nodes may be passed,
+		 * equal ones could be behind @n */
+		if (i >= n->level)
+		{
+			while ((nx = x->next[i - 1]) && sl->cmp(nx, n) < 0)
+				x = nx;
+			continue;
+		}
+		while ((nx = x->next[i - 1]) != n)
+			x = nx;
+		__twskiplist_set_next(x, i, n->next[i - 1]);
+	}
+	twlist_del(&n->list);
+
+	while (sl->level > 1 && !sl->head.next[sl->level - 2])
+		sl->level--;
+	sl->count--;
+}
+
+/* @brief	Find the first node not less than @key.
+ * @sl:	the list
+ * @key:	the key to look for
+ * @kcmp:	ordering of nodes and keys
+ * @details	Returns NULL if all nodes are less than @key. */
+static struct twskiplist_node *
+twskiplist_seek(const struct twskiplist *sl, const void *key,
+				twskiplist_key_cmp_func_t kcmp)
+{
+	const struct twskiplist_node	*x = &sl->head;
+	struct twskiplist_node		*nx;
+	unsigned int			i = sl->level;
+
+	while (i--)
+	{
+		while ((nx = __twskiplist_next(sl, x, i)) && kcmp(nx, key) < 0)
+			x = nx;
+	}
+	return __twskiplist_next(sl, x, 0);
+}
+
+/* @brief	Find the first node equal to @key or NULL. */
+static struct twskiplist_node *
+twskiplist_find(const struct twskiplist *sl, const void *key,
+				twskiplist_key_cmp_func_t kcmp)
+{
+	struct twskiplist_node *n = twskiplist_seek(sl, key, kcmp);
+
+	if (n && kcmp(n, key) == 0)
+		return n;
+	return NULL;
+}
+
+/* @brief	Iterate over skip list of given type in order.
+ * @pos:	the type * to use as a loop cursor
+ * @sl:	the &struct twskiplist
+ * @member:	the name of the twskiplist_node within the struct */
+#define twskiplist_for_each_entry(pos, sl, member)			\
+		twlist_for_each_entry(pos, &(sl)->head.list, member.list)
+
+/* @brief	Iterate over skip list of given type in reverse order.
+ * @pos:	the type * to use as a loop cursor
+ * @sl:	the &struct twskiplist
+ * @member:	the name of the twskiplist_node within the struct */
+#define twskiplist_for_each_entry_reverse(pos, sl, member)		\
+		twlist_for_each_entry_reverse(pos, &(sl)->head.list, member.list)
+
+/* @brief	Iterate over skip list safe against removal of list entry.
+ * @pos:	the type * to use as a loop cursor
+ * @n:		another type * to use as temporary storage
+ * @sl:	the &struct twskiplist
+ * @member:	the name of the twskiplist_node within the struct */
+#define twskiplist_for_each_entry_safe(pos, n, sl, member)		\
+		twlist_for_each_entry_safe(pos, n, &(sl)->head.list, member.list)
+
+/* @brief	Iterate over skip list from the current point.
+ * @pos:	the type * to use as a loop cursor, first entry visited
+ * @sl:	the &struct twskiplist
+ * @member:	the name of the twskiplist_node within the struct */
+#define twskiplist_for_each_entry_from(pos, sl, member)			\
+		twlist_for_each_entry_from(pos, &(sl)->head.list, member.list)
+
+/* @brief	Iterate over all entries with keys in [@from, @to).
+ * @pos:	the type * to use as a loop cursor
+ * @sl:	the &struct twskiplist
+ * @member:	the name of the twskiplist_node within the struct
+ * @from:	the lowest key to visit
+ * @to:		the key to stop at
+ * @kcmp:	ordering of nodes and keys */
+#define twskiplist_for_each_entry_range(pos, sl, member, from, to, kcmp) \
+	for (pos = twskiplist_entry_safe(twskiplist_seek(sl, from, kcmp),	\
+			__typeof__(*(pos)), member);				\
+		pos && (kcmp)(&(pos)->member, to) < 0;				\
+		pos = twskiplist_entry_safe(twskiplist_next(sl, &(pos)->member),\
+			__typeof__(*(pos)), member))
+
+
+#endif	/* TWSKIPLIST_H */
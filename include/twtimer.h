@@ -0,0 +1,232 @@
+/* @file        twtimer.h
+ * @brief       Hierarchical timer wheel of twlist buckets.
+ * @details     Based on the Linux Kernel cascading timer wheel. Time is
+ *              counted in ticks of the caller's choosing. Timers due within
+ *              256 ticks hang in one of the 256 slots of the first level,
+ *              one slot per tick; timers further away hang in one of the 64
+ *              slots of the level matching their distance, each of those
+ *              slots covering 2^(8 + 6 * (level - 1)) ticks. Whenever the
+ *              lower level wraps, the next slot of the level above is
+ *              spliced off and its timers are redistributed (cascaded) one
+ *              level down. Timers are intrusive, adding and cancelling is
+ *              O(1) and the wheel allocates nothing.
+ *              Five levels cover 2^32 ticks. Timers further away are parked
+ *              in the last level 2^32 ticks ahead and placed again from
+ *              there, so they still fire on time.
+ *              The wheel is not thread safe, lock it if needed.
+ * @author      Piotr Gregor <piotrek.gregor at gmail.com>, based on Linux Kernel
+ *              timer wheel.
+ * @version     0.1.2
+ * @date        16 Oct 2026
+ * @copyright   LGPLv2.1
+ */
+
+
+#ifndef TWTIMER_H
+#define TWTIMER_H
+
+
+#include "twlist.h"
+
+
+#include <stdint.h>
+
+
+#define TWTIMER_ROOT_BITS	8
+#define TWTIMER_LVL_BITS	6
+#define TWTIMER_ROOT_SIZE	(1 << TWTIMER_ROOT_BITS)
+#define TWTIMER_LVL_SIZE	(1 << TWTIMER_LVL_BITS)
+#define TWTIMER_ROOT_MASK	(TWTIMER_ROOT_SIZE - 1)
+#define TWTIMER_LVL_MASK	(TWTIMER_LVL_SIZE - 1)
+
+/* Levels above the first one. */
+#define TWTIMER_LEVELS		4
+
+/* Furthest ahead the wheel can hold a timer, in ticks. */
+#define TWTIMER_MAX_TIMEOUT	0xffffffffULL
+
+struct twtimer
+{
+	struct twlist_head	entry;
+	uint64_t		expires;	/* tick */
+	void			(*fn)(struct twtimer *t);
+};
+
+struct twtimer_wheel
+{
+	uint64_t		now;		/* next tick to process */
+	struct twlist_head	root[TWTIMER_ROOT_SIZE];
+	struct twlist_head	lvl[TWTIMER_LEVELS][TWTIMER_LVL_SIZE];
+};
+
+#define twtimer_entry(ptr, type, member) tw_container_of(ptr, type, member)
+
+/* @brief	Initialize a timer.
+ * @t:		the timer
+ * @fn:		called by twtimer_run when the timer fires, gets the timer,
+ *		use twtimer_entry to get the containing object */
+static void
+twtimer_init(struct twtimer *t, void (*fn)(struct twtimer *t))
+{
+	TWINIT_LIST_HEAD(&t->entry);
+	t->expires = 0;
+	t->fn = fn;
+}
+
+/* @brief	Initialize a wheel.
+ * @w:		the wheel
+ * @now:	current tick */
+static void
+twtimer_wheel_init(struct twtimer_wheel *w, uint64_t now)
+{
+	size_t i, j;
+
+	w->now = now;
+	for (i = 0; i < TWTIMER_ROOT_SIZE; i++)
+		TWINIT_LIST_HEAD(&w->root[i]);
+	for (i = 0; i < TWTIMER_LEVELS; i++)
+		for (j = 0; j < TWTIMER_LVL_SIZE; j++)
+			TWINIT_LIST_HEAD(&w->lvl[i][j]);
+}
+
+/* Slot of @expires on level @n (0 is the first level above the root). */
+#define __TWTIMER_IDX(expires, n)					\
+	(((expires) >> (TWTIMER_ROOT_BITS + (n) * TWTIMER_LVL_BITS)) &	\
+							TWTIMER_LVL_MASK)
+
+/* Link @t into the slot its expiry falls into, relative to w->now. */
+static void
+__twtimer_add(struct twtimer_wheel *w, struct twtimer *t)
+{
+	uint64_t		expires = t->expires;
+	uint64_t		idx = expires - w->now;
+	struct twlist_head	*slot;
+
+	if ((int64_t) idx < 0)
+	{
+		/* already due, fires on the next tick processed */
+		slot = &w->root[w->now & TWTIMER_ROOT_MASK];
+	} else if (idx < TWTIMER_ROOT_SIZE) {
+		slot = &w->root[expires & TWTIMER_ROOT_MASK];
+	} else if (idx < 1ULL << (TWTIMER_ROOT_BITS + TWTIMER_LVL_BITS)) {
+		slot = &w->lvl[0][__TWTIMER_IDX(expires, 0)];
+	} else if (idx < 1ULL << (TWTIMER_ROOT_BITS + 2 * TWTIMER_LVL_BITS)) {
+		slot = &w->lvl[1][__TWTIMER_IDX(expires, 1)];
+	} else if (idx < 1ULL << (TWTIMER_ROOT_BITS + 3 * TWTIMER_LVL_BITS)) {
+		slot = &w->lvl[2][__TWTIMER_IDX(expires, 2)];
+	} else {
+		if (idx > TWTIMER_MAX_TIMEOUT)
+			expires = w->now + TWTIMER_MAX_TIMEOUT;
+		slot = &w->lvl[3][__TWTIMER_IDX(expires, 3)];
+	}
+	twlist_add_tail(&t->entry, slot);
+}
+
+/* @brief	Test whether a timer is in a wheel. */
+static int
+twtimer_pending(const struct twtimer *t)
+{
+	return !twlist_empty(&t->entry);
+}
+
+/* @brief	Start a timer.
+ * @w:		the wheel
+ * @t:		the timer, must not be pending
+ * @expires:	tick at which the timer fires, a tick already processed
+ *		means the next one */
+static void
+twtimer_add(struct twtimer_wheel *w, struct twtimer *t, uint64_t expires)
+{
+	t->expires = expires;
+	__twtimer_add(w, t);
+}
+
+/* @brief	Stop a timer.
+ * @details	Returns 1 if the timer was pending, 0 otherwise. */
+static int
+twtimer_del(struct twtimer *t)
+{
+	if (!twtimer_pending(t))
+		return 0;
+	twlist_del_init(&t->entry);
+	return 1;
+}
+
+/* @brief	Change the expiry of a timer, pending or not.
+ * @details	Returns 1 if the timer was pending, 0 otherwise. */
+static int
+twtimer_mod(struct twtimer_wheel *w, struct twtimer *t, uint64_t expires)
+{
+	int ret = twtimer_del(t);
+
+	twtimer_add(w, t, expires);
+	return ret;
+}
+
+/* Move all timers of slot @index of level @n one level down. Returns
+ * @index, so that the next level is cascaded only when this one wraps. */
+static size_t
+__twtimer_cascade(struct twtimer_wheel *w, size_t n, size_t index)
+{
+	struct twtimer		*t, *tmp;
+	struct twlist_head	list;
+
+	TWINIT_LIST_HEAD(&list);
+	twlist_splice_init(&w->lvl[n][index], &list);
+	twlist_for_each_entry_safe(t, tmp, &list, entry)
+		__twtimer_add(w, t);
+	return index;
+}
+
+/* @brief	Collect the timers due by tick @now.
+ * @w:		the wheel
+ * @now:	current tick
+ * @expired:	list the due timers are appended to, in tick order
+ * @details	Whole slots are spliced onto @expired, timers are not touched
+ * one by one. They stay pending, linked into @expired, until the caller
+ * removes them with twtimer_del (or twlist_del_init on the entry). Time
+ * may jump, every tick in between is processed. */
+static void
+twtimer_expire(struct twtimer_wheel *w, uint64_t now,
+					struct twlist_head *expired)
+{
+	size_t index;
+
+	while ((int64_t) (now - w->now) >= 0)
+	{
+		index = w->now & TWTIMER_ROOT_MASK;
+		if (!index &&
+			!__twtimer_cascade(w, 0, __TWTIMER_IDX(w->now, 0)) &&
+			!__twtimer_cascade(w, 1, __TWTIMER_IDX(w->now, 1)) &&
+			!__twtimer_cascade(w, 2, __TWTIMER_IDX(w->now, 2)))
+			__twtimer_cascade(w, 3, __TWTIMER_IDX(w->now, 3));
+		w->now++;
+		twlist_splice_tail_init(&w->root[index], expired);
+	}
+}
+
+/* @brief	Fire the timers due by tick @now.
+ * @details	Each timer is removed from the wheel before its callback is
+ * called, the callback may add it again or add and delete others. Returns
+ * the number of timers fired. */
+static size_t
+twtimer_run(struct twtimer_wheel *w, uint64_t now)
+{
+	struct twlist_head	expired;
+	struct twtimer		*t;
+	size_t			n = 0;
+
+	TWINIT_LIST_HEAD(&expired);
+	twtimer_expire(w, now, &expired);
+	while (!twlist_empty(&expired))
+	{
+		t = twlist_first_entry(&expired, struct twtimer, entry);
+		twlist_del_init(&t->entry);
+		t->fn(t);
+		n++;
+	}
+	return n;
+}
+
+
+#endif	/* TWTIMER_H */
@@ -0,0 +1,1522 @@
+/// @file	twbench.c
+/// @brief	Microbenchmarks for twlist.h, twhash.h and the other tables.
+/// @details	Usage: twbench [n ...], n are data sizes (default 1000 1000000).
+///		Prints one CSV line per benchmark to stdout:
+///		bench,n,dist,hit,ns_per_op,ops_per_sec
+///		dist is the key distribution (seq, uniform), the order in
+///		which entries are visited or the key length of hash function
+///		benchmarks, hit is the lookup hit ratio in percent.
+///		Columns that don't apply are "-". twhash_sharded_SxT is a
+///		table of S shards shared by T threads, ns_per_op is wall
+///		time over all threads' ops.
+/// @author	Piotr Gregor piotrek.gregor at gmail.com
+/// @version	0.1.2
+/// @date	16 Oct 2026
+/// @copyright	LGPLv2.1
+
+
+#include "twlist.h"		// list
+#include "twhash.h"		// hash, hashtable
+#include "twhash_seed.h"	// hash seeds
+#include "twhash_oa.h"		// open addressing hashtable
+#include "twlist_sort.h"	// list sort
+#include "twskiplist.h"		// skip list
+#include "twrbtree.h"		// red-black tree
+#include "twlru.h"		// lru cache
+#include "twpool.h"		// object pool
+#include "twhash_sharded.h"	// sharded hashtable
+#include "twtimer.h"		// timer wheel
+#include "twheap.h"		// pairing heap
+#include "twilist.h"		// index linked list
+#include "twllist.h"		// lock-free llist
+#include "twfifo_mpsc.h"	// lock-free mpsc queue
+#include "twhash_snap.h"	// hashtable snapshot
+#include "twhash_shm.h"	// shared memory hashtable
+
+
+#include <stdlib.h>             // everything
+#include <stdio.h>              // most I/O
+#include <stdint.h>		// fixed width integers
+#include <string.h>             // memset, etc.
+#include <time.h>		// clock_gettime
+#include <assert.h>		// assertion
+#include <pthread.h>		// threads
+#include <unistd.h>		// getpid, unlink
+
+
+// every benchmark repeats on fresh data until it did at least that many ops
+#define TWBENCH_MIN_OPS		2000000
+#define TWBENCH_DEFAULT_N	{ 1000, 1000000 }
+
+// benchmarked object
+struct benchobj
+{
+	uint64_t		key;
+	struct twlist_head	link;
+	struct twhlist_node	hnode;
+	struct twhash_oa_node	onode;
+};
+
+// skip list nodes are big, keep them out of benchobj
+struct benchskip
+{
+	uint64_t		key;
+	struct twskiplist_node	node;
+};
+
+struct benchrb
+{
+	uint64_t		key;
+	struct twrb_node	node;
+};
+
+struct benchmsg
+{
+	uint64_t		key;
+	struct twllist_node	lnode;
+	struct twlist_head	qnode;
+};
+
+// small records in an array, linked by pointers or by indices
+struct benchrec
+{
+	uint32_t		key;
+	struct twlist_head	link;
+};
+
+struct benchirec
+{
+	uint32_t		key;
+	struct twilist_node	link;
+};
+
+struct benchheap
+{
+	uint64_t		key;
+	struct twheap_node	node;
+};
+
+// data set for one size and key distribution
+struct benchset
+{
+	size_t			n;
+	const char		*dist;
+	struct benchobj		*objs;
+	uint32_t		*perm;		// random permutation of 0..n-1
+	uint64_t		*keys;		// lookup keys
+	struct twhlist_head	*ht;
+	unsigned int		bits;
+};
+
+// object of the shared memory hashtable
+struct benchshm
+{
+	uint64_t		key;
+	struct twhash_shm_node	node;
+};
+
+// keep results alive
+static volatile uint64_t	sink;
+static uint64_t			rnd_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t
+twbench_rand(void)
+{
+	// xorshift64*
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+	return rnd_state * 0x2545f4914f6cdd1dULL;
+}
+
+static double
+twbench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t
+twbench_rounds(size_t n)
+{
+	return n >= TWBENCH_MIN_OPS ? 1 : (TWBENCH_MIN_OPS + n - 1) / n;
+}
+
+static void
+twbench_report(const char *bench, size_t n, const char *dist, const char *hit,
+					size_t ops, double ns)
+{
+	printf("%s,%zu,%s,%s,%.3f,%.0f\n", bench, n, dist, hit,
+			ns / ops, ops / ns * 1e9);
+	fflush(stdout);
+}
+
+static void
+twbench_list_build(struct benchset *s, struct twlist_head *h)
+{
+	size_t i;
+
+	TWINIT_LIST_HEAD(h);
+	for (i = 0; i < s->n; i++)
+		twlist_add_tail(&s->objs[i].link, h);
+}
+
+static void
+twbench_list_add(struct benchset *s)
+{
+	struct twlist_head	h;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		TWINIT_LIST_HEAD(&h);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_add(&s->objs[i].link, &h);
+		ns += twbench_now() - t;
+	}
+	twbench_report("twlist_add", s->n, "-", "-", rounds * s->n, ns);
+
+	ns = 0;
+	for (r = 0; r < rounds; r++)
+	{
+		TWINIT_LIST_HEAD(&h);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_add_tail(&s->objs[i].link, &h);
+		ns += twbench_now() - t;
+	}
+	twbench_report("twlist_add_tail", s->n, "-", "-", rounds * s->n, ns);
+}
+
+static void
+twbench_list_del(struct benchset *s)
+{
+	struct twlist_head	h;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		twbench_list_build(s, &h);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_del(&s->objs[i].link);
+		ns += twbench_now() - t;
+		assert(twlist_empty(&h));
+	}
+	twbench_report("twlist_del", s->n, "seq", "-", rounds * s->n, ns);
+
+	ns = 0;
+	for (r = 0; r < rounds; r++)
+	{
+		twbench_list_build(s, &h);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_del(&s->objs[s->perm[i]].link);
+		ns += twbench_now() - t;
+		assert(twlist_empty(&h));
+	}
+	twbench_report("twlist_del", s->n, "random", "-", rounds * s->n, ns);
+}
+
+static void
+twbench_list_iterate(struct benchset *s)
+{
+	struct twlist_head	h;
+	struct benchobj		*pos;
+	size_t			r, rounds = twbench_rounds(s->n);
+	uint64_t		sum = 0;
+	double			t, ns;
+
+	twbench_list_build(s, &h);
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+		twlist_for_each_entry(pos, &h, link)
+			sum += pos->key;
+	ns = twbench_now() - t;
+	sink = sum;
+	twbench_report("twlist_for_each_entry", s->n, "-", "-",
+						rounds * s->n, ns);
+}
+
+// hand n messages over to a consumer: pushed one by one, taken as one
+// batch with twllist and with a mutex protected twlist, one by one with
+// twfifo_mpsc; one op is a push and its share of the take
+static void
+twbench_llist(struct benchset *s)
+{
+	TWLLIST_HEAD(h);
+	pthread_mutex_t		lock = PTHREAD_MUTEX_INITIALIZER;
+	twfifo_mpsc_queue	*q;
+	struct benchmsg		*msgs, *pos;
+	struct twllist_node	*first;
+	struct twlist_head	*l, lh, batch;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	uint64_t		sum = 0;
+	double			t, ns_ll = 0, ns_q = 0, ns_lock = 0;
+
+	msgs = malloc(s->n * sizeof(*msgs));
+	q = malloc(sizeof(*q));
+	if (!msgs || !q)
+		goto out;
+	for (i = 0; i < s->n; i++)
+		msgs[i].key = i;
+	twfifo_mpsc_init(q);
+	for (r = 0; r < rounds; r++)
+	{
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twllist_add(&msgs[i].lnode, &h);
+		first = twllist_reverse_order(twllist_del_all(&h));
+		twllist_for_each_entry(pos, first, lnode)
+			sum += pos->key;
+		ns_ll += twbench_now() - t;
+
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twfifo_mpsc_enqueue(&msgs[i].qnode, q);
+		while (twfifo_mpsc_dequeue(q, l))
+			sum += twlist_entry(l, struct benchmsg, qnode)->key;
+		ns_q += twbench_now() - t;
+
+		TWINIT_LIST_HEAD(&lh);
+		TWINIT_LIST_HEAD(&batch);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+		{
+			pthread_mutex_lock(&lock);
+			twlist_add_tail(&msgs[i].qnode, &lh);
+			pthread_mutex_unlock(&lock);
+		}
+		pthread_mutex_lock(&lock);
+		twlist_splice_init(&lh, &batch);
+		pthread_mutex_unlock(&lock);
+		twlist_for_each(l, &batch)
+			sum += twlist_entry(l, struct benchmsg, qnode)->key;
+		ns_lock += twbench_now() - t;
+	}
+	sink = sum;
+	twbench_report("twllist_add_del_all", s->n, "-", "-",
+					rounds * s->n, ns_ll);
+	twbench_report("twfifo_mpsc_enqueue_dequeue", s->n, "-", "-",
+					rounds * s->n, ns_q);
+	twbench_report("twlist_mutex_add_splice", s->n, "-", "-",
+					rounds * s->n, ns_lock);
+out:
+	free(msgs);
+	free(q);
+}
+
+// lists of array records threaded in random order: build, walk, delete
+static void
+twbench_ilist(struct benchset *s)
+{
+	struct benchrec		*recs, *pos;
+	struct benchirec	*irecs, *ipos;
+	struct twlist_head	h;
+	struct twilist_head	ih;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	uint64_t		sum = 0;
+	double			t, ns_add = 0, ns_iter = 0, ns_del = 0;
+
+	recs = malloc(s->n * sizeof(*recs));
+	irecs = malloc(s->n * sizeof(*irecs));
+	if (!recs || !irecs)
+		goto out;
+	for (i = 0; i < s->n; i++)
+		recs[i].key = irecs[i].key = (uint32_t) i;
+
+	for (r = 0; r < rounds; r++)
+	{
+		TWINIT_LIST_HEAD(&h);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_add_tail(&recs[s->perm[i]].link, &h);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		twlist_for_each_entry(pos, &h, link)
+			sum += pos->key;
+		ns_iter += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlist_del(&recs[i].link);
+		ns_del += twbench_now() - t;
+	}
+	twbench_report("twlist_rec_add_tail", s->n, "random", "-",
+						rounds * s->n, ns_add);
+	twbench_report("twlist_rec_for_each_entry", s->n, "random", "-",
+						rounds * s->n, ns_iter);
+	twbench_report("twlist_rec_del", s->n, "random", "-",
+						rounds * s->n, ns_del);
+
+	ns_add = ns_iter = ns_del = 0;
+	for (r = 0; r < rounds; r++)
+	{
+		TWINIT_ILIST_HEAD(&ih);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twilist_add_tail(irecs, link, s->perm[i], &ih);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		twilist_for_each_entry(ipos, irecs, link, &ih)
+			sum += ipos->key;
+		ns_iter += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twilist_del(irecs, link, (uint32_t) i, &ih);
+		ns_del += twbench_now() - t;
+		assert(twilist_empty(&ih));
+	}
+	sink = sum;
+	twbench_report("twilist_add_tail", s->n, "random", "-",
+						rounds * s->n, ns_add);
+	twbench_report("twilist_for_each_entry", s->n, "random", "-",
+						rounds * s->n, ns_iter);
+	twbench_report("twilist_del", s->n, "random", "-",
+						rounds * s->n, ns_del);
+out:
+	free(recs);
+	free(irecs);
+}
+
+static void
+twbench_list_splice(struct benchset *s)
+{
+	struct twlist_head	a, b;
+	size_t			i, rounds = twbench_rounds(s->n);
+	double			t, ns;
+
+	TWINIT_LIST_HEAD(&a);
+	twbench_list_build(s, &b);
+	t = twbench_now();
+	for (i = 0; i < rounds * s->n; i++)
+	{
+		// move the whole list back and forth
+		if (i % 2)
+			twlist_splice_init(&a, &b);
+		else
+			twlist_splice_init(&b, &a);
+	}
+	ns = twbench_now() - t;
+	twbench_report("twlist_splice", s->n, "-", "-", rounds * s->n, ns);
+}
+
+static int
+twbench_list_cmp(void *priv, const struct twlist_head *a,
+				const struct twlist_head *b)
+{
+	(void) priv;
+	return twlist_entry(a, struct benchobj, link)->key >
+		twlist_entry(b, struct benchobj, link)->key;
+}
+
+static int
+twbench_qsort_cmp(const void *a, const void *b)
+{
+	uint64_t ka = (*(struct benchobj * const *) a)->key;
+	uint64_t kb = (*(struct benchobj * const *) b)->key;
+
+	return (ka > kb) - (ka < kb);
+}
+
+// in-place merge sort vs copying into an array, qsort and rebuilding
+static void
+twbench_list_sort(struct benchset *s)
+{
+	struct twlist_head	h;
+	struct benchobj		*pos, **arr;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		twbench_list_build(s, &h);
+		t = twbench_now();
+		twlist_sort(NULL, &h, twbench_list_cmp);
+		ns += twbench_now() - t;
+	}
+	twbench_report("twlist_sort", s->n, s->dist, "-", rounds * s->n, ns);
+
+	arr = malloc(s->n * sizeof(*arr));
+	if (!arr)
+		return;
+	ns = 0;
+	for (r = 0; r < rounds; r++)
+	{
+		twbench_list_build(s, &h);
+		t = twbench_now();
+		i = 0;
+		twlist_for_each_entry(pos, &h, link)
+			arr[i++] = pos;
+		qsort(arr, s->n, sizeof(*arr), twbench_qsort_cmp);
+		TWINIT_LIST_HEAD(&h);
+		for (i = 0; i < s->n; i++)
+			twlist_add_tail(&arr[i]->link, &h);
+		ns += twbench_now() - t;
+	}
+	free(arr);
+	twbench_report("twlist_qsort_rebuild", s->n, s->dist, "-",
+						rounds * s->n, ns);
+}
+
+static int
+twbench_skip_cmp(const struct twskiplist_node *a,
+			const struct twskiplist_node *b)
+{
+	uint64_t ka = twskiplist_entry(a, struct benchskip, node)->key;
+	uint64_t kb = twskiplist_entry(b, struct benchskip, node)->key;
+
+	return (ka > kb) - (ka < kb);
+}
+
+static int
+twbench_skip_key_cmp(const struct twskiplist_node *n, const void *key)
+{
+	uint64_t k = twskiplist_entry(n, struct benchskip, node)->key;
+
+	return (k > *(const uint64_t *) key) - (k < *(const uint64_t *) key);
+}
+
+static void
+twbench_skiplist(struct benchset *s)
+{
+	struct twskiplist	sl;
+	struct benchskip	*objs;
+	uint64_t		sum = 0;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns_add = 0, ns_seek = 0, ns_del = 0;
+
+	objs = malloc(s->n * sizeof(*objs));
+	if (!objs)
+		return;
+	for (i = 0; i < s->n; i++)
+	{
+		objs[i].key = s->objs[i].key;
+		s->keys[i] = s->objs[s->perm[i]].key;
+	}
+	for (r = 0; r < rounds; r++)
+	{
+		twskiplist_init(&sl, twbench_skip_cmp, r + 1);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twskiplist_insert(&sl, &objs[i].node);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			sum += (uintptr_t) twskiplist_seek(&sl, &s->keys[i],
+						twbench_skip_key_cmp);
+		ns_seek += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twskiplist_del(&sl, &objs[s->perm[i]].node);
+		ns_del += twbench_now() - t;
+	}
+	sink = sum;
+	free(objs);
+	twbench_report("twskiplist_insert", s->n, s->dist, "-",
+						rounds * s->n, ns_add);
+	twbench_report("twskiplist_seek", s->n, s->dist, "100",
+						rounds * s->n, ns_seek);
+	twbench_report("twskiplist_del", s->n, s->dist, "-",
+						rounds * s->n, ns_del);
+}
+
+static int
+twbench_rb_less(const struct twrb_node *a, const struct twrb_node *b)
+{
+	return twrb_entry(a, struct benchrb, node)->key <
+		twrb_entry(b, struct benchrb, node)->key;
+}
+
+static int
+twbench_rb_cmp(const void *key, const struct twrb_node *n)
+{
+	uint64_t k = twrb_entry(n, struct benchrb, node)->key;
+
+	return (*(const uint64_t *) key > k) - (*(const uint64_t *) key < k);
+}
+
+static void
+twbench_rbtree(struct benchset *s)
+{
+	struct twrb_root	root;
+	struct benchrb		*objs;
+	uint64_t		sum = 0;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns_add = 0, ns_find = 0, ns_del = 0;
+
+	objs = malloc(s->n * sizeof(*objs));
+	if (!objs)
+		return;
+	for (i = 0; i < s->n; i++)
+	{
+		objs[i].key = s->objs[i].key;
+		s->keys[i] = s->objs[s->perm[i]].key;
+	}
+	for (r = 0; r < rounds; r++)
+	{
+		root = TWRB_ROOT;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twrb_add(&objs[i].node, &root, twbench_rb_less);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			sum += (uintptr_t) twrb_find(&s->keys[i], &root,
+							twbench_rb_cmp);
+		ns_find += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twrb_erase(&objs[s->perm[i]].node, &root);
+		ns_del += twbench_now() - t;
+	}
+	sink = sum;
+	free(objs);
+	twbench_report("twrb_add", s->n, s->dist, "-", rounds * s->n, ns_add);
+	twbench_report("twrb_find", s->n, s->dist, "100", rounds * s->n, ns_find);
+	twbench_report("twrb_erase", s->n, s->dist, "-", rounds * s->n, ns_del);
+}
+
+static int
+twbench_heap_less(const struct twheap_node *a, const struct twheap_node *b)
+{
+	return twheap_entry(a, struct benchheap, node)->key <
+		twheap_entry(b, struct benchheap, node)->key;
+}
+
+// insert all, decrease the key of every other in random order, pop all
+static void
+twbench_heap(struct benchset *s)
+{
+	struct twheap		h;
+	struct benchheap	*objs, *obj;
+	uint64_t		prev = 0;
+	size_t			i, r, unordered = 0, rounds = twbench_rounds(s->n);
+	double			t, ns_add = 0, ns_dec = 0, ns_pop = 0;
+
+	objs = malloc(s->n * sizeof(*objs));
+	if (!objs)
+		return;
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+			objs[i].key = s->objs[i].key;
+		twheap_init(&h, twbench_heap_less);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twheap_insert(&h, &objs[i].node);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i += 2)
+		{
+			obj = &objs[s->perm[i]];
+			obj->key >>= 1;
+			twheap_decrease(&h, &obj->node);
+		}
+		ns_dec += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+		{
+			obj = twheap_entry(twheap_pop(&h), struct benchheap, node);
+			unordered += obj->key < prev;
+			prev = obj->key;
+		}
+		ns_pop += twbench_now() - t;
+		prev = 0;
+	}
+	free(objs);
+	// asserts are compiled out here, check the order anyway
+	if (unordered)
+	{
+		fprintf(stderr, "twbench: twheap_pop out of order\n");
+		abort();
+	}
+	twbench_report("twheap_insert", s->n, s->dist, "-", rounds * s->n, ns_add);
+	twbench_report("twheap_decrease", s->n, s->dist, "-",
+				rounds * ((s->n + 1) / 2), ns_dec);
+	twbench_report("twheap_pop", s->n, s->dist, "-", rounds * s->n, ns_pop);
+}
+
+// cache of half the data set, every insert past that evicts
+static void
+twbench_lru(struct benchset *s)
+{
+	struct twlru		c;
+	struct twlru_node	*nodes;
+	uint64_t		sum = 0;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns_add = 0, ns_get = 0;
+
+	nodes = malloc(s->n * sizeof(*nodes));
+	if (!nodes)
+		return;
+	for (i = 0; i < s->n; i++)
+		s->keys[i] = s->objs[s->perm[i]].key;
+	for (r = 0; r < rounds; r++)
+	{
+		if (twlru_init(&c, s->n / 2, 16, NULL, NULL) != 0)
+			break;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twlru_insert(&c, &nodes[i], s->objs[i].key);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			sum += (uintptr_t) twlru_get(&c, s->keys[i]);
+		ns_get += twbench_now() - t;
+		twlru_free(&c);
+	}
+	sink = sum;
+	free(nodes);
+	twbench_report("twlru_insert", s->n, s->dist, "-", rounds * s->n, ns_add);
+	twbench_report("twlru_get", s->n, s->dist, "50", rounds * s->n, ns_get);
+}
+
+// allocate n objects and free them in random order, one op is an alloc
+// and a free
+static void
+twbench_pool(struct benchset *s)
+{
+	struct twpool		p;
+	struct twpool_cache	c;
+	void			**objs;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			t, ns;
+
+	objs = malloc(s->n * sizeof(*objs));
+	if (!objs)
+		return;
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+			objs[i] = malloc(sizeof(struct benchobj));
+		for (i = 0; i < s->n; i++)
+			free(objs[s->perm[i]]);
+	}
+	ns = twbench_now() - t;
+	twbench_report("malloc_free", s->n, "-", "-", rounds * s->n, ns);
+
+	if (twpool_init(&p, sizeof(struct benchobj)) != 0)
+		goto out;
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+			objs[i] = twpool_alloc(&p);
+		for (i = 0; i < s->n; i++)
+			twpool_free(&p, objs[s->perm[i]]);
+	}
+	ns = twbench_now() - t;
+	twbench_report("twpool_alloc_free", s->n, "-", "-", rounds * s->n, ns);
+
+	twpool_cache_init(&c, &p);
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+			objs[i] = twpool_cache_alloc(&c);
+		for (i = 0; i < s->n; i++)
+			twpool_cache_free(&c, objs[s->perm[i]]);
+	}
+	ns = twbench_now() - t;
+	twbench_report("twpool_cache_alloc_free", s->n, "-", "-",
+						rounds * s->n, ns);
+	twpool_cache_destroy(&c);
+	twpool_destroy(&p);
+out:
+	free(objs);
+}
+
+static size_t	timers_fired;
+
+static void
+twbench_timer_fn(struct twtimer *t)
+{
+	(void) t;
+	timers_fired++;
+}
+
+// n timeouts spread over 2^16 ticks: arm all, re-arm all later (activity
+// on a connection), cancel every 4th, then run the wheel to the end
+static void
+twbench_timer(struct benchset *s)
+{
+	struct twtimer_wheel	*w;
+	struct twtimer		*timers;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	uint64_t		now;
+	double			t, ns_add = 0, ns_mod = 0, ns_del = 0, ns_run = 0;
+
+	w = malloc(sizeof(*w));
+	timers = malloc(s->n * sizeof(*timers));
+	if (!w || !timers)
+		goto out;
+	for (i = 0; i < s->n; i++)
+		twtimer_init(&timers[i], twbench_timer_fn);
+	timers_fired = 0;
+	for (r = 0; r < rounds; r++)
+	{
+		twtimer_wheel_init(w, 0);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twtimer_add(w, &timers[i], s->objs[i].key & 0xffff);
+		ns_add += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twtimer_mod(w, &timers[s->perm[i]],
+				(s->objs[s->perm[i]].key & 0xffff) + 1000);
+		ns_mod += twbench_now() - t;
+		t = twbench_now();
+		for (i = 0; i < s->n; i += 4)
+			twtimer_del(&timers[s->perm[i]]);
+		ns_del += twbench_now() - t;
+		t = twbench_now();
+		for (now = 0; now <= 0xffff + 1000; now += 16)
+			twtimer_run(w, now);
+		ns_run += twbench_now() - t;
+	}
+	assert(timers_fired == rounds * (s->n - (s->n + 3) / 4));
+	twbench_report("twtimer_add", s->n, s->dist, "-", rounds * s->n, ns_add);
+	twbench_report("twtimer_mod", s->n, s->dist, "-", rounds * s->n, ns_mod);
+	twbench_report("twtimer_del", s->n, s->dist, "-",
+				rounds * ((s->n + 3) / 4), ns_del);
+	twbench_report("twtimer_run", s->n, s->dist, "-", timers_fired, ns_run);
+out:
+	free(timers);
+	free(w);
+}
+
+struct benchsharded
+{
+	struct twhash_sharded	*t;
+	struct benchset		*s;
+	size_t			id;		// objects id, id + nthreads, ..
+	size_t			nthreads;
+	size_t			ops;
+	size_t			found;
+};
+
+// 90% lookups of random keys, 10% removal and re-insertion of an object
+// owned by the thread
+static void *
+twbench_sharded_worker(void *arg)
+{
+	struct benchsharded	*a = arg;
+	struct benchset		*s = a->s;
+	struct benchobj		*obj, *own;
+	uint64_t		rnd = 0x9e3779b97f4a7c15ULL * (a->id + 1);
+	size_t			i, j = a->id;
+	uint64_t		key;
+
+	for (i = 0; i < a->ops; i++)
+	{
+		rnd ^= rnd << 13;
+		rnd ^= rnd >> 7;
+		rnd ^= rnd << 17;
+		if (i % 10 == 9)
+		{
+			own = &s->objs[j];
+			twhash_sharded_del(a->t, &own->hnode, own->key);
+			twhash_sharded_add(a->t, &own->hnode, own->key);
+			j += a->nthreads;
+			if (j >= s->n)
+				j = a->id;
+			continue;
+		}
+		key = s->objs[rnd % s->n].key;
+		obj = twhash_sharded_lookup(a->t, obj, hnode, key,
+						obj->key == key);
+		a->found += obj != NULL;
+	}
+	return NULL;
+}
+
+// throughput of a table shared by 1..8 threads, with one lock for the
+// whole table (1 shard) and with 64 shards
+static void
+twbench_sharded(struct benchset *s)
+{
+	static const unsigned int	threads[] = { 1, 2, 4, 8 };
+	static const unsigned int	shard_bits[] = { 0, 6 };
+	struct benchsharded		args[8];
+	pthread_t			th[8];
+	struct twhash_sharded		t;
+	size_t				i, k, ti, ops, found;
+	unsigned int			bits;
+	char				bench[64];
+	double				tm, ns;
+
+	ops = twbench_rounds(s->n) * s->n;
+	for (k = 0; k < TWARRAY_SIZE(shard_bits); k++)
+	{
+		bits = s->bits > shard_bits[k] ? s->bits - shard_bits[k] : 1;
+		if (twhash_sharded_init(&t, shard_bits[k], bits) != 0)
+			return;
+		for (i = 0; i < s->n; i++)
+			twhash_sharded_add(&t, &s->objs[i].hnode, s->objs[i].key);
+		for (ti = 0; ti < TWARRAY_SIZE(threads); ti++)
+		{
+			tm = twbench_now();
+			for (i = 0; i < threads[ti]; i++)
+			{
+				args[i].t = &t;
+				args[i].s = s;
+				args[i].id = i;
+				args[i].nthreads = threads[ti];
+				args[i].ops = ops / threads[ti];
+				args[i].found = 0;
+				if (pthread_create(&th[i], NULL,
+					twbench_sharded_worker, &args[i]) != 0)
+					break;
+			}
+			found = 0;
+			while (i--)
+			{
+				pthread_join(th[i], NULL);
+				found += args[i].found;
+			}
+			ns = twbench_now() - tm;
+			sink = found;
+			snprintf(bench, sizeof(bench), "twhash_sharded_%ux%u",
+					1U << shard_bits[k], threads[ti]);
+			twbench_report(bench, s->n, s->dist, "100",
+					ops / threads[ti] * threads[ti], ns);
+		}
+		twhash_sharded_free(&t);
+	}
+}
+
+static void
+twbench_hash_build(struct benchset *s)
+{
+	size_t i;
+
+	__twhash_init(s->ht, (size_t) 1 << s->bits);
+	for (i = 0; i < s->n; i++)
+		twhash_add_bits(s->ht, &s->objs[i].hnode, s->objs[i].key, s->bits);
+}
+
+static void
+twbench_hash_add(struct benchset *s)
+{
+	size_t	i, r, rounds = twbench_rounds(s->n);
+	double	t, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		__twhash_init(s->ht, (size_t) 1 << s->bits);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twhash_add_bits(s->ht, &s->objs[i].hnode,
+					s->objs[i].key, s->bits);
+		ns += twbench_now() - t;
+	}
+	twbench_report("twhash_add", s->n, s->dist, "-", rounds * s->n, ns);
+}
+
+static void
+twbench_hash_lookup(struct benchset *s, unsigned int hit)
+{
+	struct benchobj	*obj;
+	size_t		i, r, found = 0, rounds = twbench_rounds(s->n);
+	char		hitstr[8];
+	double		t, ns;
+
+	// hit% of keys are in the table, misses differ in the lowest bit
+	for (i = 0; i < s->n; i++)
+	{
+		s->keys[i] = s->objs[s->perm[i]].key;
+		if (i % 100 >= hit)
+			s->keys[i] |= 1;
+	}
+	twbench_hash_build(s);
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			twhash_for_each_possible_bits(s->ht, obj, hnode,
+						s->keys[i], s->bits)
+			{
+				if (obj->key == s->keys[i])
+				{
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	ns = twbench_now() - t;
+	assert(found == rounds * (s->n / 100 * hit +
+				(s->n % 100 < hit ? s->n % 100 : hit)));
+	sink = found;
+	snprintf(hitstr, sizeof(hitstr), "%u", hit);
+	twbench_report("twhash_for_each_possible", s->n, s->dist, hitstr,
+						rounds * s->n, ns);
+}
+
+// same as twbench_hash_lookup with the table hashed by SipHash-1-3
+static void
+twbench_hash_lookup_seeded(struct benchset *s, unsigned int hit)
+{
+	struct benchobj		*obj;
+	struct twhash_seed	seed;
+	size_t			i, r, found = 0, rounds = twbench_rounds(s->n);
+	char			hitstr[8];
+	double			t, ns;
+
+	twhash_seed_init(&seed);
+	for (i = 0; i < s->n; i++)
+	{
+		s->keys[i] = s->objs[s->perm[i]].key;
+		if (i % 100 >= hit)
+			s->keys[i] |= 1;
+	}
+	__twhash_init(s->ht, (size_t) 1 << s->bits);
+	for (i = 0; i < s->n; i++)
+		twhash_add_seeded_bits(s->ht, &s->objs[i].hnode,
+					s->objs[i].key, &seed, s->bits);
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			twhash_for_each_possible_seeded_bits(s->ht, obj, hnode,
+						s->keys[i], &seed, s->bits)
+			{
+				if (obj->key == s->keys[i])
+				{
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	ns = twbench_now() - t;
+	assert(found == rounds * (s->n / 100 * hit +
+				(s->n % 100 < hit ? s->n % 100 : hit)));
+	sink = found;
+	snprintf(hitstr, sizeof(hitstr), "%u", hit);
+	twbench_report("twhash_for_each_possible_seeded", s->n, s->dist,
+					hitstr, rounds * s->n, ns);
+}
+
+static int
+twbench_match(const struct twhlist_node *node, const void *key)
+{
+	return twhlist_entry(node, struct benchobj, hnode)->key ==
+						*(const uint64_t *) key;
+}
+
+// save the table to a snapshot, map it and look all keys up in it; open is
+// one op whatever n is, compare with twhash_add rebuilding the table
+static void
+twbench_snap(struct benchset *s)
+{
+	struct twhash_snap	snap;
+	const struct benchobj	*obj;
+	char			path[64];
+	size_t			i, r, found = 0, rounds = twbench_rounds(s->n);
+	double			t, ns;
+
+	snprintf(path, sizeof(path), "/tmp/twbench_snap.%d", (int) getpid());
+	twbench_hash_build(s);
+	t = twbench_now();
+	if (__twhash_snap_save(path, s->ht, (size_t) 1 << s->bits, s->bits,
+			offsetof(struct benchobj, hnode),
+			offsetof(struct benchobj, key),
+			sizeof(struct benchobj)) != 0)
+	{
+		fprintf(stderr, "twbench: can't save snapshot %s\n", path);
+		return;
+	}
+	ns = twbench_now() - t;
+	twbench_report("twhash_snap_save", s->n, s->dist, "-", s->n, ns);
+
+	t = twbench_now();
+	if (twhash_snap_open(&snap, path) != 0)
+	{
+		fprintf(stderr, "twbench: can't open snapshot %s\n", path);
+		unlink(path);
+		return;
+	}
+	ns = twbench_now() - t;
+	twbench_report("twhash_snap_open", s->n, s->dist, "-", 1, ns);
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			obj = twhash_snap_lookup(&snap,
+						s->objs[s->perm[i]].key);
+			found += obj != NULL;
+		}
+	}
+	ns = twbench_now() - t;
+	assert(found == rounds * s->n);
+	sink = found;
+	twbench_report("twhash_snap_lookup", s->n, s->dist, "100",
+						rounds * s->n, ns);
+	twhash_snap_close(&snap);
+	unlink(path);
+}
+
+// fill a shared memory table through one mapping and look every key up
+// through another, both under the bucket locks
+static void
+twbench_shm(struct benchset *s)
+{
+	struct twhash_shm	a, b;
+	struct benchshm		*obj;
+	char			name[64];
+	size_t			i, r, found = 0, rounds = twbench_rounds(s->n);
+	double			t, ns;
+
+	snprintf(name, sizeof(name), "/twbench_shm.%d", (int) getpid());
+	if (twhash_shm_create(&a, name, s->bits, ((size_t) 8 << s->bits) +
+			s->n * __TWHASH_SHM_ROUND(sizeof(*obj)) + 4096) != 0)
+	{
+		fprintf(stderr, "twbench: can't create segment %s\n", name);
+		return;
+	}
+	// a second mapping, at another address, stands in for another process
+	if (twhash_shm_open(&b, name) != 0)
+	{
+		fprintf(stderr, "twbench: can't open segment %s\n", name);
+		twhash_shm_close(&a);
+		twhash_shm_unlink(name);
+		return;
+	}
+	twhash_shm_unlink(name);
+
+	t = twbench_now();
+	for (i = 0; i < s->n; i++)
+	{
+		obj = twhash_shm_alloc(&a, sizeof(*obj));
+		obj->key = s->objs[i].key;
+		twhash_shm_add(&a, &obj->node, obj->key);
+	}
+	ns = twbench_now() - t;
+	twbench_report("twhash_shm_add", s->n, s->dist, "-", s->n, ns);
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			const uint64_t key = s->objs[s->perm[i]].key;
+
+			obj = twhash_shm_lookup(&b, obj, node, key,
+							obj->key == key);
+			found += obj != NULL;
+		}
+	}
+	ns = twbench_now() - t;
+	assert(found == rounds * s->n);
+	sink = found;
+	twbench_report("twhash_shm_lookup", s->n, s->dist, "100",
+						rounds * s->n, ns);
+	twhash_shm_close(&b);
+	twhash_shm_close(&a);
+}
+
+// bursts of 64 keys resolved with twhash_lookup_batch or one by one
+static void
+twbench_hash_lookup_batch(struct benchset *s, unsigned int hit)
+{
+	struct twhlist_node	*res[64];
+	struct benchobj		*obj;
+	size_t			i, j, r, m, found, rounds = twbench_rounds(s->n);
+	char			hitstr[8];
+	double			t, ns;
+
+	for (i = 0; i < s->n; i++)
+	{
+		s->keys[i] = s->objs[s->perm[i]].key;
+		if (i % 100 >= hit)
+			s->keys[i] |= 1;
+	}
+	twbench_hash_build(s);
+	snprintf(hitstr, sizeof(hitstr), "%u", hit);
+
+	found = 0;
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i += m)
+		{
+			m = s->n - i < 64 ? s->n - i : 64;
+			for (j = 0; j < m; j++)
+			{
+				res[j] = NULL;
+				twhash_for_each_possible_bits(s->ht, obj, hnode,
+						s->keys[i + j], s->bits)
+				{
+					if (obj->key == s->keys[i + j])
+					{
+						res[j] = &obj->hnode;
+						break;
+					}
+				}
+				found += res[j] != NULL;
+			}
+		}
+	}
+	ns = twbench_now() - t;
+	sink = found;
+	twbench_report("twhash_lookup_loop64", s->n, s->dist, hitstr,
+						rounds * s->n, ns);
+
+	found = 0;
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i += m)
+		{
+			m = s->n - i < 64 ? s->n - i : 64;
+			found += twhash_lookup_batch_bits(s->ht, s->bits,
+					&s->keys[i], m, twbench_match, res);
+		}
+	}
+	ns = twbench_now() - t;
+	assert(found == rounds * (s->n / 100 * hit +
+				(s->n % 100 < hit ? s->n % 100 : hit)));
+	sink = found;
+	twbench_report("twhash_lookup_batch64", s->n, s->dist, hitstr,
+						rounds * s->n, ns);
+}
+
+static void
+twbench_hash_del(struct benchset *s)
+{
+	size_t	i, r, rounds = twbench_rounds(s->n);
+	double	t, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		twbench_hash_build(s);
+		t = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twhash_del(&s->objs[s->perm[i]].hnode);
+		ns += twbench_now() - t;
+	}
+	twbench_report("twhash_del", s->n, s->dist, "-", rounds * s->n, ns);
+}
+
+static void
+twbench_oa_add(struct benchset *s)
+{
+	struct twhash_oa	t;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			tm, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		if (twhash_oa_init(&t, s->n) != 0)
+			return;
+		tm = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twhash_oa_add(&t, &s->objs[i].onode, s->objs[i].key);
+		ns += twbench_now() - tm;
+		twhash_oa_free(&t);
+	}
+	twbench_report("twhash_oa_add", s->n, s->dist, "-", rounds * s->n, ns);
+}
+
+static void
+twbench_oa_lookup(struct benchset *s, unsigned int hit)
+{
+	struct twhash_oa	t;
+	struct twhash_oa_iter	it;
+	struct benchobj		*obj;
+	size_t			i, r, found = 0, rounds = twbench_rounds(s->n);
+	char			hitstr[8];
+	double			tm, ns;
+
+	for (i = 0; i < s->n; i++)
+	{
+		s->keys[i] = s->objs[s->perm[i]].key;
+		if (i % 100 >= hit)
+			s->keys[i] |= 1;
+	}
+	if (twhash_oa_init(&t, s->n) != 0)
+		return;
+	for (i = 0; i < s->n; i++)
+		twhash_oa_add(&t, &s->objs[i].onode, s->objs[i].key);
+	tm = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			twhash_oa_for_each_possible(&t, obj, onode,
+							s->keys[i], it)
+			{
+				if (obj->key == s->keys[i])
+				{
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	ns = twbench_now() - tm;
+	twhash_oa_free(&t);
+	assert(found == rounds * (s->n / 100 * hit +
+				(s->n % 100 < hit ? s->n % 100 : hit)));
+	sink = found;
+	snprintf(hitstr, sizeof(hitstr), "%u", hit);
+	twbench_report("twhash_oa_for_each_possible", s->n, s->dist, hitstr,
+						rounds * s->n, ns);
+}
+
+static void
+twbench_oa_del(struct benchset *s)
+{
+	struct twhash_oa	t;
+	size_t			i, r, rounds = twbench_rounds(s->n);
+	double			tm, ns = 0;
+
+	for (r = 0; r < rounds; r++)
+	{
+		if (twhash_oa_init(&t, s->n) != 0)
+			return;
+		for (i = 0; i < s->n; i++)
+			twhash_oa_add(&t, &s->objs[i].onode, s->objs[i].key);
+		tm = twbench_now();
+		for (i = 0; i < s->n; i++)
+			twhash_oa_del(&t, &s->objs[s->perm[i]].onode);
+		ns += twbench_now() - tm;
+		twhash_oa_free(&t);
+	}
+	twbench_report("twhash_oa_del", s->n, s->dist, "-", rounds * s->n, ns);
+}
+
+// byte at a time FNV-1a, the baseline for byte string hashing
+static uint64_t
+twbench_fnv1a(const void *buf, size_t len, uint64_t seed)
+{
+	const unsigned char	*p = buf;
+	uint64_t		h = 0xcbf29ce484222325ULL ^ seed;
+
+	while (len--)
+		h = (h ^ *p++) * 0x100000001b3ULL;
+	return h;
+}
+
+// SipHash-1-3 in the twhash_buf_fn shape, seed is the first key word
+static uint64_t
+twbench_sip13(const void *buf, size_t len, uint64_t seed)
+{
+	struct twhash_seed k = { seed, 0x0f0e0d0c0b0a0908ULL };
+
+	return twhash_sip13(buf, len, &k);
+}
+
+static void
+twbench_buf_fn(const char *bench, twhash_buf_fn fn, const unsigned char *buf,
+							size_t len)
+{
+	size_t		i, n = TWBENCH_MIN_OPS * 32 / (len + 8);
+	uint64_t	h = 0;
+	char		dist[16];
+	double		t, ns;
+
+	t = twbench_now();
+	for (i = 0; i < n; i++)
+		h += fn(buf + (i & 7), len, h);
+	ns = twbench_now() - t;
+	sink = h;
+	snprintf(dist, sizeof(dist), "len=%zu", len);
+	twbench_report(bench, n, dist, "-", n, ns);
+}
+
+#define TWBENCH_INT_FN(bench, expr)					\
+	do {								\
+		h = 0;							\
+		t = twbench_now();					\
+		for (i = 0; i < n; i++)					\
+			h += (expr);					\
+		ns = twbench_now() - t;					\
+		sink = h;						\
+		twbench_report(bench, n, "u64", "-", n, ns);		\
+	} while (0)
+
+// integer key hashes, each hashes the previous result so that calls chain
+static void
+twbench_int_funcs(void)
+{
+	struct twhash_seed	seed;
+	size_t			i, n = TWBENCH_MIN_OPS * 4;
+	uint64_t		h;
+	double			t, ns;
+
+	twhash_seed_init(&seed);
+	TWBENCH_INT_FN("twhash_32", twhash_32((uint32_t) (h + i), 32));
+	TWBENCH_INT_FN("twhash_64", twhash_64(h + i, 64));
+	TWBENCH_INT_FN("twhash_mix64", twhash_mix64(h + i));
+	TWBENCH_INT_FN("twhash_sip13_u64", twhash_sip13_u64(h + i, &seed));
+}
+
+// hash functions, independent of data size
+static void
+twbench_hash_funcs(void)
+{
+	static const size_t	lens[] = { 8, 13, 16, 32, 64, 256, 1024 };
+	static unsigned char	buf[1024 + 8];
+	size_t			i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = twbench_rand();
+	for (i = 0; i < TWARRAY_SIZE(lens); i++)
+	{
+		twbench_buf_fn("fnv1a", twbench_fnv1a, buf, lens[i]);
+		twbench_buf_fn("twhash_buf64_generic", __twhash_buf_generic,
+							buf, lens[i]);
+		twbench_buf_fn("twhash_sip13", twbench_sip13, buf, lens[i]);
+#ifdef TWHASH_BUF_SSE42
+		if (__builtin_cpu_supports("sse4.2"))
+			twbench_buf_fn("twhash_buf64_sse42", __twhash_buf_sse42,
+							buf, lens[i]);
+#endif
+	}
+}
+
+static int
+twbench_setup(struct benchset *s, size_t n)
+{
+	size_t i, j;
+	uint32_t tmp;
+
+	memset(s, 0, sizeof(*s));
+	s->n = n;
+	// load factor of about 1
+	s->bits = 1;
+	while (((size_t) 1 << s->bits) < n)
+		s->bits++;
+	s->objs = malloc(n * sizeof(*s->objs));
+	s->perm = malloc(n * sizeof(*s->perm));
+	s->keys = malloc(n * sizeof(*s->keys));
+	s->ht = malloc(sizeof(*s->ht) << s->bits);
+	if (!s->objs || !s->perm || !s->keys || !s->ht)
+		return -1;
+	for (i = 0; i < n; i++)
+		s->perm[i] = i;
+	for (i = n - 1; i > 0; i--)
+	{
+		j = twbench_rand() % (i + 1);
+		tmp = s->perm[i];
+		s->perm[i] = s->perm[j];
+		s->perm[j] = tmp;
+	}
+	return 0;
+}
+
+// keys are even so that key | 1 is never in the table
+static void
+twbench_set_keys(struct benchset *s, const char *dist)
+{
+	size_t i;
+
+	s->dist = dist;
+	for (i = 0; i < s->n; i++)
+	{
+		if (!strcmp(dist, "seq"))
+			s->objs[i].key = (uint64_t) i << 1;
+		else
+			s->objs[i].key = twbench_rand() << 1;
+	}
+}
+
+static void
+twbench_teardown(struct benchset *s)
+{
+	free(s->objs);
+	free(s->perm);
+	free(s->keys);
+	free(s->ht);
+}
+
+static void
+twbench_run(size_t n)
+{
+	static const char	*dists[] = { "seq", "uniform" };
+	static const unsigned int hits[] = { 100, 50, 0 };
+	struct benchset		s;
+	size_t			d, h;
+
+	if (twbench_setup(&s, n) != 0)
+	{
+		fprintf(stderr, "twbench: can't allocate data for n=%zu\n", n);
+		twbench_teardown(&s);
+		return;
+	}
+	twbench_set_keys(&s, "seq");
+	twbench_list_add(&s);
+	twbench_list_del(&s);
+	twbench_list_iterate(&s);
+	twbench_list_splice(&s);
+	twbench_ilist(&s);
+	twbench_llist(&s);
+	twbench_pool(&s);
+	for (d = 0; d < TWARRAY_SIZE(dists); d++)
+	{
+		twbench_set_keys(&s, dists[d]);
+		twbench_list_sort(&s);
+		twbench_skiplist(&s);
+		twbench_rbtree(&s);
+		twbench_heap(&s);
+		twbench_lru(&s);
+		twbench_sharded(&s);
+		twbench_timer(&s);
+		twbench_hash_add(&s);
+		for (h = 0; h < TWARRAY_SIZE(hits); h++)
+			twbench_hash_lookup(&s, hits[h]);
+		twbench_hash_lookup_seeded(&s, 100);
+		twbench_hash_lookup_seeded(&s, 0);
+		twbench_hash_lookup_batch(&s, 100);
+		twbench_hash_lookup_batch(&s, 0);
+		twbench_snap(&s);
+		twbench_shm(&s);
+		twbench_hash_del(&s);
+		twbench_oa_add(&s);
+		for (h = 0; h < TWARRAY_SIZE(hits); h++)
+			twbench_oa_lookup(&s, hits[h]);
+		twbench_oa_del(&s);
+	}
+	twbench_teardown(&s);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const size_t	def[] = TWBENCH_DEFAULT_N;
+	size_t			i, n;
+
+	printf("bench,n,dist,hit,ns_per_op,ops_per_sec\n");
+	twbench_int_funcs();
+	twbench_hash_funcs();
+	if (argc < 2)
+	{
+		for (i = 0; i < TWARRAY_SIZE(def); i++)
+			twbench_run(def[i]);
+		return 0;
+	}
+	for (i = 1; i < (size_t) argc; i++)
+	{
+		n = strtoull(argv[i], NULL, 0);
+		if (n < 2)
+		{
+			fprintf(stderr, "twbench: bad size %s\n", argv[i]);
+			return 1;
+		}
+		twbench_run(n);
+	}
+	return 0;
+}
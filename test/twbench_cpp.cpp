@@ -0,0 +1,217 @@
+/// @file	twbench_cpp.cpp
+/// @brief	Microbenchmarks of the C++ wrappers against the C macros.
+/// @details	Usage: twbench_cpp [n ...], n are data sizes (default 1000
+///		1000000). Prints CSV in the format of twbench:
+///		bench,n,dist,hit,ns_per_op,ops_per_sec
+///		Every loop is run once with the C macro and once with the
+///		wrapper over the very same list or table, the two lines should
+///		show the same cost.
+/// @author	Piotr Gregor piotrek.gregor at gmail.com
+/// @version	0.1.2
+/// @date	16 Oct 2026
+/// @copyright	LGPLv2.1
+
+
+#include "twlist.hpp"		// tw::list
+#include "twhash.hpp"		// tw::hash_table
+
+
+#include <cstdlib>		// strtoull
+#include <cstdio>		// printf
+#include <cstdint>		// fixed width integers
+#include <ctime>		// clock_gettime
+#include <cassert>		// assertion
+#include <new>			// nothrow
+
+
+#define TWBENCH_MIN_OPS		2000000
+#define TWBENCH_DEFAULT_N	{ 1000, 1000000 }
+#define TWBENCH_HASH_BITS	20
+
+// benchmarked object
+struct benchobj
+{
+	uint64_t	key;
+	twlist_head	link;
+	twhlist_node	hnode;
+};
+
+typedef tw::list<benchobj, &benchobj::link>			bench_list;
+typedef tw::hash_table<benchobj, &benchobj::hnode, TWBENCH_HASH_BITS>
+								bench_table;
+
+static volatile uint64_t	sink;
+static uint64_t			rnd_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t
+twbench_rand(void)
+{
+	// xorshift64*
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+	return rnd_state * 0x2545f4914f6cdd1dULL;
+}
+
+static double
+twbench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t
+twbench_rounds(size_t n)
+{
+	return n >= TWBENCH_MIN_OPS ? 1 : (TWBENCH_MIN_OPS + n - 1) / n;
+}
+
+static void
+twbench_report(const char *bench, size_t n, const char *dist, const char *hit,
+					size_t ops, double ns)
+{
+	printf("%s,%zu,%s,%s,%.3f,%.0f\n", bench, n, dist, hit,
+			ns / ops, ops / ns * 1e9);
+	fflush(stdout);
+}
+
+static void
+twbench_list_iterate(benchobj *objs, size_t n)
+{
+	bench_list	l;
+	benchobj	*pos;
+	size_t		i, r, rounds = twbench_rounds(n);
+	uint64_t	sum = 0, sum2 = 0;
+	double		t, ns;
+
+	for (i = 0; i < n; i++)
+		l.push_back(objs[i]);
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+		twlist_for_each_entry(pos, l.head(), link)
+			sum += pos->key;
+	ns = twbench_now() - t;
+	twbench_report("twlist_for_each_entry", n, "-", "-", rounds * n, ns);
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+		for (benchobj &x : l)
+			sum2 += x.key;
+	ns = twbench_now() - t;
+	twbench_report("tw::list_range_for", n, "-", "-", rounds * n, ns);
+	assert(sum == sum2);
+	sink = sum + sum2;
+}
+
+// keys are uniform, half of the lookups miss
+static void
+twbench_hash_lookup(benchobj *objs, size_t n)
+{
+	bench_table	*ht = new (std::nothrow) bench_table;
+	uint64_t	*keys = new (std::nothrow) uint64_t[n];
+	benchobj	*obj;
+	size_t		i, r, found = 0, found2 = 0, rounds = twbench_rounds(n);
+	double		t, ns;
+
+	if (!ht || !keys)
+	{
+		fprintf(stderr, "twbench_cpp: can't allocate table for n=%zu\n",
+									n);
+		goto out;
+	}
+	for (i = 0; i < n; i++)
+	{
+		ht->add(objs[i], objs[i].key);
+		keys[i] = objs[(i * 7919) % n].key | (i & 1);
+	}
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			twhash_for_each_possible_bits(ht->buckets(), obj, hnode,
+						keys[i], TWBENCH_HASH_BITS)
+			{
+				if (obj->key == keys[i])
+				{
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	ns = twbench_now() - t;
+	twbench_report("twhash_for_each_possible", n, "uniform", "50",
+							rounds * n, ns);
+
+	t = twbench_now();
+	for (r = 0; r < rounds; r++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			const uint64_t k = keys[i];
+
+			if (ht->find(k, [k](const benchobj &x) {
+						return x.key == k; }))
+				found2++;
+		}
+	}
+	ns = twbench_now() - t;
+	twbench_report("tw::hash_table_find", n, "uniform", "50",
+							rounds * n, ns);
+	assert(found == found2);
+	sink = found + found2;
+out:
+	delete[] keys;
+	delete ht;
+}
+
+static void
+twbench_run(size_t n)
+{
+	benchobj	*objs = new (std::nothrow) benchobj[n];
+	size_t		i;
+
+	if (!objs)
+	{
+		fprintf(stderr, "twbench_cpp: can't allocate data for n=%zu\n",
+									n);
+		return;
+	}
+	// even keys, odd ones miss
+	for (i = 0; i < n; i++)
+		objs[i].key = twbench_rand() & ~1ULL;
+	twbench_list_iterate(objs, n);
+	twbench_hash_lookup(objs, n);
+	delete[] objs;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const size_t	def[] = TWBENCH_DEFAULT_N;
+	size_t			i, n;
+
+	printf("bench,n,dist,hit,ns_per_op,ops_per_sec\n");
+	if (argc < 2)
+	{
+		for (i = 0; i < TWARRAY_SIZE(def); i++)
+			twbench_run(def[i]);
+		return 0;
+	}
+	for (i = 1; i < (size_t) argc; i++)
+	{
+		n = strtoull(argv[i], NULL, 0);
+		if (n < 2)
+		{
+			fprintf(stderr, "twbench_cpp: bad size %s\n", argv[i]);
+			return 1;
+		}
+		twbench_run(n);
+	}
+	return 0;
+}
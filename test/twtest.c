@@ -6,8 +6,31 @@
 /// @copyright	LGPLv2.1
 
 
+// exercise lookup probe counters too
+#define CONFIG_TWHASH_STATS
+
 #include "twlist.h"		// list
 #include "twhash.h"		// hash, hashtable
+#include "twhash_seed.h"	// hash seeds
+#include "twhash_dyn.h"		// resizable hashtable
+#include "twrcu.h"		// rcu reclamation
+#include "twhash_bl.h"		// bit locked hashtable
+#include "twfifo_mpsc.h"	// lock-free mpsc queue
+#include "twfifo_spsc.h"	// bounded spsc ring
+#include "twhash_oa.h"		// open addressing hashtable
+#include "twlist_sort.h"	// list sort
+#include "twskiplist.h"		// skip list
+#include "twrbtree.h"		// red-black tree
+#include "twhash_nulls.h"	// nulls hashtable
+#include "twlru.h"		// lru cache
+#include "twpool.h"		// object pool
+#include "twhash_sharded.h"	// sharded hashtable
+#include "twtimer.h"		// timer wheel
+#include "twheap.h"		// pairing heap
+#include "twilist.h"		// index linked list
+#include "twllist.h"		// lock-free llist
+#include "twhash_snap.h"	// hashtable snapshot
+#include "twhash_shm.h"	// shared memory hashtable
 
 
 #include <stdlib.h>             // everything
@@ -16,7 +39,13 @@
 #include <string.h>             // memset, etc.
 #include <errno.h>		// error codes
 #include <assert.h>		// assertion
+#include <pthread.h>		// threads
+#include <sched.h>		// sched_yield
+#include <unistd.h>		// getpid, unlink, fork
+#include <sys/wait.h>		// waitpid
+
 
+TWHASH_STATS_DEFINE;
 
 // our test struct
 struct gucio
@@ -200,11 +229,2814 @@ twlist_test(void)
 	twlist_test_list_del_init();
 }
 
+// object stored in resizable hashtable
+struct dyngucio
+{
+	uint32_t		key;
+	struct twhash_dyn_node	hnode;
+};
+
+#define TWTEST_DYN_N	10000
+
+static void
+twhash_dyn_test(void)
+{
+	struct twhash_dyn	ht;
+	struct dyngucio		*g, *obj;
+	struct twhlist_node	*tmp;
+	size_t			bkt, n;
+	uint32_t		i;
+	int			found, ret;
+
+	g = malloc(TWTEST_DYN_N * sizeof(*g));
+	assert(g != NULL);
+	ret = twhash_dyn_init(&ht, 4);
+	assert(ret == 0);
+	assert(twhash_dyn_empty(&ht));
+	for (i = 0; i < TWTEST_DYN_N; i++)
+	{
+		g[i].key = i;
+		twhash_dyn_add(&ht, &g[i].hnode, g[i].key);
+
+		// every object is visible, also in the middle of a resize
+		found = 0;
+		twhash_dyn_for_each_possible(&ht, obj, hnode, i)
+		{
+			if (obj->key == i)
+				found++;
+		}
+		assert(found == 1);
+	}
+	assert(twhash_dyn_count(&ht) == TWTEST_DYN_N);
+	assert(((size_t) 1 << ht.bits) * TWHASH_DYN_GROW_LOAD >= TWTEST_DYN_N / 2);
+
+	n = 0;
+	twhash_dyn_for_each(&ht, bkt, obj, hnode)
+		n++;
+	assert(n == TWTEST_DYN_N);
+
+	// delete all but the first 2 objects
+	twhash_dyn_for_each_safe(&ht, bkt, tmp, obj, hnode)
+	{
+		if (obj->key >= 2)
+			twhash_dyn_del(&ht, &obj->hnode);
+	}
+	assert(twhash_dyn_count(&ht) == 2);
+	twhash_dyn_del(&ht, &g[20].hnode);
+	assert(twhash_dyn_count(&ht) == 2);
+
+	// shrink back to the initial size
+	while (twhash_dyn_rehash_step(&ht, 64))
+		;
+	assert(ht.bits == 4);
+	assert(ht.old == NULL);
+	for (i = 0; i < 20; i++)
+	{
+		found = 0;
+		twhash_dyn_for_each_possible(&ht, obj, hnode, i)
+		{
+			if (obj->key == i)
+				found++;
+		}
+		assert(found == (i < 2));
+	}
+
+	twhash_dyn_free(&ht);
+	free(g);
+	(void) ret;
+}
+
+// object stored in rcu enabled hashtable
+struct rcugucio
+{
+	uint32_t		key;
+	int			val;
+	struct twhlist_node	hnode;
+	struct twrcu_head	rcu;
+};
+
+#define TWTEST_RCU_KEYS		64
+#define TWTEST_RCU_UPDATES	20000
+
+static TWDEFINE_HASHTABLE(rcu_ht, 5);
+static struct twrcu_domain	rcu_dom;
+static int			rcu_freed;
+static int			rcu_stop;
+
+static void
+rcugucio_free(struct twrcu_head *head)
+{
+	struct rcugucio *g = tw_container_of(head, struct rcugucio, rcu);
+
+	// a reader that still sees this object will catch it
+	g->val = -1;
+	rcu_freed++;
+	free(g);
+}
+
+static struct rcugucio *
+rcugucio_find(uint32_t key)
+{
+	struct rcugucio *obj;
+
+	twhash_for_each_possible_rcu(rcu_ht, obj, hnode, key)
+	{
+		if (obj->key == key)
+			return obj;
+	}
+	return NULL;
+}
+
+static void *
+twrcu_test_reader(void *arg)
+{
+	struct twrcu_reader	r;
+	struct rcugucio		*obj;
+	uint32_t		key = 0;
+
+	(void) arg;
+	twrcu_register(&rcu_dom, &r);
+	while (!__atomic_load_n(&rcu_stop, __ATOMIC_RELAXED))
+	{
+		twrcu_read_lock(&r);
+		obj = rcugucio_find(key);
+		assert(obj != NULL);
+		assert(obj->val == (int) obj->key);
+		twrcu_read_unlock(&r);
+		key = (key + 1) % TWTEST_RCU_KEYS;
+	}
+	twrcu_unregister(&r);
+	(void) obj;
+	return NULL;
+}
+
+static void
+twrcu_test(void)
+{
+	struct twrcu_reader	r;
+	struct rcugucio		*obj, *g;
+	struct twhlist_node	*tmp;
+	pthread_t		tid;
+	unsigned int		bkt;
+	uint32_t		i;
+	int			ret;
+
+	ret = twrcu_domain_init(&rcu_dom);
+	assert(ret == 0);
+	twhash_init(rcu_ht);
+	for (i = 0; i < TWTEST_RCU_KEYS; i++)
+	{
+		g = malloc(sizeof(*g));
+		assert(g != NULL);
+		g->key = i;
+		g->val = i;
+		twhash_add_rcu(rcu_ht, &g->hnode, g->key);
+	}
+
+	// lookups from a registered reader
+	twrcu_register(&rcu_dom, &r);
+	twrcu_read_lock(&r);
+	for (i = 0; i < TWTEST_RCU_KEYS; i++)
+	{
+		obj = rcugucio_find(i);
+		assert(obj != NULL && obj->key == i);
+	}
+	assert(rcugucio_find(TWTEST_RCU_KEYS) == NULL);
+	twrcu_read_unlock(&r);
+	twrcu_unregister(&r);
+
+	// delete and free after grace period
+	obj = rcugucio_find(7);
+	twhash_del_rcu(&obj->hnode);
+	assert(!twhash_hashed(&obj->hnode));
+	twrcu_call(&rcu_dom, &obj->rcu, rcugucio_free);
+	assert(rcu_freed == 0);
+	twrcu_reclaim(&rcu_dom);
+	assert(rcu_freed == 1);
+	assert(rcugucio_find(7) == NULL);
+	g = malloc(sizeof(*g));
+	assert(g != NULL);
+	g->key = 7;
+	g->val = 7;
+	twhash_add_rcu(rcu_ht, &g->hnode, g->key);
+
+	// single writer replacing objects under a concurrent reader
+	rcu_freed = 0;
+	ret = pthread_create(&tid, NULL, twrcu_test_reader, NULL);
+	assert(ret == 0);
+	for (i = 0; i < TWTEST_RCU_UPDATES; i++)
+	{
+		obj = rcugucio_find(i % TWTEST_RCU_KEYS);
+		g = malloc(sizeof(*g));
+		assert(g != NULL);
+		g->key = obj->key;
+		g->val = obj->val;
+		twhlist_replace_rcu(&obj->hnode, &g->hnode);
+		twrcu_call(&rcu_dom, &obj->rcu, rcugucio_free);
+		if (i % 64 == 63)
+			twrcu_reclaim(&rcu_dom);
+	}
+	__atomic_store_n(&rcu_stop, 1, __ATOMIC_RELAXED);
+	ret = pthread_join(tid, NULL);
+	assert(ret == 0);
+	twrcu_reclaim(&rcu_dom);
+	assert(rcu_freed == TWTEST_RCU_UPDATES);
+
+	twhash_for_each_safe(rcu_ht, bkt, tmp, obj, hnode)
+	{
+		twhash_del_rcu(&obj->hnode);
+		twrcu_call(&rcu_dom, &obj->rcu, rcugucio_free);
+	}
+	twrcu_domain_destroy(&rcu_dom);
+	assert(twhash_empty(rcu_ht) == 0);
+	(void) ret;
+}
+
+// object stored in bit locked hashtable
+struct blgucio
+{
+	uint32_t		key;
+	struct twhlist_bl_node	hnode;
+};
+
+#define TWTEST_BL_THREADS	4
+#define TWTEST_BL_PER_THREAD	2000
+
+static TWDEFINE_HASHTABLE_BL(bl_ht, 4);
+static struct blgucio bl_objs[TWTEST_BL_THREADS * TWTEST_BL_PER_THREAD];
+
+static void *
+twhash_bl_test_writer(void *arg)
+{
+	uint32_t i, first = *(uint32_t *) arg;
+
+	for (i = first; i < first + TWTEST_BL_PER_THREAD; i++)
+	{
+		bl_objs[i].key = i;
+		twhash_bl_add(bl_ht, &bl_objs[i].hnode, bl_objs[i].key);
+	}
+	return NULL;
+}
+
+static void
+twhash_bl_test(void)
+{
+	pthread_t		tid[TWTEST_BL_THREADS];
+	uint32_t		first[TWTEST_BL_THREADS];
+	struct blgucio		*obj;
+	struct twhlist_bl_node	*tmp;
+	uint32_t		i, key;
+	int			found, ret;
+
+	twhash_bl_init(bl_ht);
+	for (i = 0; i < TWTEST_BL_THREADS; i++)
+	{
+		first[i] = i * TWTEST_BL_PER_THREAD;
+		ret = pthread_create(&tid[i], NULL, twhash_bl_test_writer,
+								&first[i]);
+		assert(ret == 0);
+	}
+	for (i = 0; i < TWTEST_BL_THREADS; i++)
+	{
+		ret = pthread_join(tid[i], NULL);
+		assert(ret == 0);
+	}
+
+	for (i = 0; i < TWTEST_BL_THREADS * TWTEST_BL_PER_THREAD; i++)
+	{
+		assert(!twhlist_bl_is_locked(twhash_bl_bucket(bl_ht, i)));
+		assert(twhash_bl_hashed(&bl_objs[i].hnode));
+		obj = twhash_bl_lookup(bl_ht, obj, hnode, i, obj->key == i);
+		assert(obj == &bl_objs[i]);
+	}
+
+	// remove even keys under the bucket lock, odd ones with twhash_bl_del
+	for (key = 0; key < TWTEST_BL_THREADS * TWTEST_BL_PER_THREAD; key += 2)
+	{
+		twhash_bl_lock(bl_ht, key);
+		twhash_bl_for_each_possible_safe(bl_ht, obj, tmp, hnode, key)
+		{
+			if (obj->key == key)
+				twhash_bl_del_locked(&obj->hnode);
+		}
+		twhash_bl_unlock(bl_ht, key);
+		twhash_bl_del(bl_ht, &bl_objs[key + 1].hnode, key + 1);
+	}
+	for (i = 0; i < TWTEST_BL_THREADS * TWTEST_BL_PER_THREAD; i++)
+	{
+		found = 0;
+		twhash_bl_lock(bl_ht, i);
+		twhash_bl_for_each_possible(bl_ht, obj, hnode, i)
+			found++;
+		twhash_bl_unlock(bl_ht, i);
+		assert(found == 0);
+		assert(!twhash_bl_hashed(&bl_objs[i].hnode));
+	}
+	(void) ret;
+}
+
+// message passed through queues
+struct msggucio
+{
+	uint32_t		producer;
+	uint32_t		seq;
+	struct twlist_head	link;
+};
+
+#define TWTEST_MPSC_PRODUCERS	4
+#define TWTEST_MPSC_PER_PRODUCER	20000
+
+static twfifo_mpsc_queue	mpsc_q;
+static struct msggucio		mpsc_msgs[TWTEST_MPSC_PRODUCERS][TWTEST_MPSC_PER_PRODUCER];
+
+static void *
+twfifo_mpsc_test_producer(void *arg)
+{
+	uint32_t i, p = *(uint32_t *) arg;
+
+	for (i = 0; i < TWTEST_MPSC_PER_PRODUCER; i++)
+	{
+		mpsc_msgs[p][i].producer = p;
+		mpsc_msgs[p][i].seq = i;
+		twfifo_mpsc_enqueue(&mpsc_msgs[p][i].link, &mpsc_q);
+	}
+	return NULL;
+}
+
+static void
+twfifo_mpsc_test(void)
+{
+	pthread_t		tid[TWTEST_MPSC_PRODUCERS];
+	uint32_t		id[TWTEST_MPSC_PRODUCERS];
+	uint32_t		next[TWTEST_MPSC_PRODUCERS] = { 0 };
+	struct msggucio		m1, m2, *m;
+	struct twlist_head	*l, *l2;
+	uint32_t		i, n = 0;
+	int			ret;
+
+	// single threaded ordering
+	twfifo_mpsc_init(&mpsc_q);
+	assert(twfifo_mpsc_empty(&mpsc_q));
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == NULL);
+	twfifo_mpsc_enqueue(&m1.link, &mpsc_q);
+	twfifo_mpsc_enqueue(&m2.link, &mpsc_q);
+	assert(!twfifo_mpsc_empty(&mpsc_q));
+	assert(twfifo_mpsc_get_entry(&mpsc_q, struct msggucio, link) == &m1);
+	l2 = twfifo_mpsc_dequeue(&mpsc_q, l);
+	assert(l2 == &m1.link && l == &m1.link);
+	assert(twfifo_mpsc_get_entry(&mpsc_q, struct msggucio, link) == &m2);
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == &m2.link);
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == NULL);
+	assert(twfifo_mpsc_empty(&mpsc_q));
+	twfifo_mpsc_enqueue(&m1.link, &mpsc_q);
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == &m1.link);
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == NULL);
+
+	// concurrent producers, order is kept per producer
+	for (i = 0; i < TWTEST_MPSC_PRODUCERS; i++)
+	{
+		id[i] = i;
+		ret = pthread_create(&tid[i], NULL, twfifo_mpsc_test_producer,
+								&id[i]);
+		assert(ret == 0);
+	}
+	while (n < TWTEST_MPSC_PRODUCERS * TWTEST_MPSC_PER_PRODUCER)
+	{
+		if (!twfifo_mpsc_dequeue(&mpsc_q, l))
+		{
+			sched_yield();
+			continue;
+		}
+		m = twlist_entry(l, struct msggucio, link);
+		assert(m->seq == next[m->producer]);
+		next[m->producer]++;
+		n++;
+	}
+	for (i = 0; i < TWTEST_MPSC_PRODUCERS; i++)
+	{
+		ret = pthread_join(tid[i], NULL);
+		assert(ret == 0);
+	}
+	l = twfifo_mpsc_dequeue_f(&mpsc_q);
+	assert(l == NULL);
+	(void) l2;
+	(void) ret;
+}
+
+#define TWTEST_SPSC_N	100000
+
+static twfifo_spsc_queue	spsc_q;
+
+static void *
+twfifo_spsc_test_producer(void *arg)
+{
+	struct msggucio	*msgs = arg;
+	uint32_t	i;
+
+	for (i = 0; i < TWTEST_SPSC_N; i++)
+	{
+		msgs[i].seq = i;
+		while (twfifo_spsc_enqueue(&msgs[i].link, &spsc_q) != 0)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void
+twfifo_spsc_test(void)
+{
+	struct msggucio		g[20], *msgs;
+	struct twlist_head	*l, *l2, *batch[8];
+	pthread_t		tid;
+	uint32_t		i, n;
+	size_t			cnt;
+	int			ret;
+
+	// single threaded ordering, full ring and wrap around
+	ret = twfifo_spsc_init(&spsc_q, 5);
+	assert(ret == 0);
+	assert(twfifo_spsc_capacity(&spsc_q) == 8);
+	assert(twfifo_spsc_empty(&spsc_q));
+	l = twfifo_spsc_dequeue_f(&spsc_q);
+	assert(l == NULL);
+	for (i = 0; i < 8; i++)
+	{
+		g[i].seq = i;
+		ret = twfifo_spsc_enqueue(&g[i].link, &spsc_q);
+		assert(ret == 0);
+	}
+	ret = twfifo_spsc_enqueue(&g[8].link, &spsc_q);
+	assert(ret == -1);
+	assert(twfifo_spsc_get_entry(&spsc_q, struct msggucio, link) == &g[0]);
+	for (i = 0; i < 8; i++)
+	{
+		l2 = twfifo_spsc_dequeue(&spsc_q, l);
+		assert(l2 == &g[i].link && l == &g[i].link);
+	}
+	l = twfifo_spsc_dequeue_f(&spsc_q);
+	assert(l == NULL);
+	for (i = 8; i < 16; i++)
+	{
+		ret = twfifo_spsc_enqueue(&g[i].link, &spsc_q);
+		assert(ret == 0);
+	}
+	ret = twfifo_spsc_enqueue(&g[16].link, &spsc_q);
+	assert(ret == -1);
+	for (i = 8; i < 16; i++)
+	{
+		l = twfifo_spsc_dequeue_f(&spsc_q);
+		assert(l == &g[i].link);
+	}
+	l = twfifo_spsc_dequeue_f(&spsc_q);
+	assert(l == NULL);
+
+	// bulk
+	for (i = 0; i < 8; i++)
+		batch[i] = &g[i].link;
+	cnt = twfifo_spsc_enqueue_bulk(&spsc_q, batch, 6);
+	assert(cnt == 6);
+	cnt = twfifo_spsc_enqueue_bulk(&spsc_q, batch, 6);
+	assert(cnt == 2);
+	cnt = twfifo_spsc_dequeue_bulk(&spsc_q, batch, 3);
+	assert(cnt == 3);
+	assert(batch[0] == &g[0].link && batch[2] == &g[2].link);
+	cnt = twfifo_spsc_dequeue_bulk(&spsc_q, batch, 8);
+	assert(cnt == 5);
+	assert(batch[3] == &g[0].link && batch[4] == &g[1].link);
+	assert(twfifo_spsc_empty(&spsc_q));
+	twfifo_spsc_free(&spsc_q);
+
+	// two threads
+	msgs = malloc(TWTEST_SPSC_N * sizeof(*msgs));
+	assert(msgs != NULL);
+	ret = twfifo_spsc_init(&spsc_q, 64);
+	assert(ret == 0);
+	ret = pthread_create(&tid, NULL, twfifo_spsc_test_producer, msgs);
+	assert(ret == 0);
+	for (n = 0; n < TWTEST_SPSC_N; )
+	{
+		if (!twfifo_spsc_dequeue(&spsc_q, l))
+		{
+			sched_yield();
+			continue;
+		}
+		assert(l == &msgs[n].link);
+		assert(twlist_entry(l, struct msggucio, link)->seq == n);
+		n++;
+	}
+	ret = pthread_join(tid, NULL);
+	assert(ret == 0);
+	assert(twfifo_spsc_empty(&spsc_q));
+	twfifo_spsc_free(&spsc_q);
+	free(msgs);
+	(void) l2;
+	(void) cnt;
+	(void) ret;
+}
+
+// object stored in open addressing hashtable
+struct oagucio
+{
+	uint64_t		key;
+	struct twhash_oa_node	onode;
+};
+
+#define TWTEST_OA_N	10000
+
+__attribute__((unused)) static int
+twhash_oa_test_count(struct twhash_oa *t, uint64_t key)
+{
+	struct twhash_oa_iter	it;
+	struct oagucio		*obj;
+	int			found = 0;
+
+	twhash_oa_for_each_possible(t, obj, onode, key, it)
+	{
+		if (obj->key == key)
+			found++;
+	}
+	return found;
+}
+
+static void
+twhash_oa_test(void)
+{
+	struct twhash_oa	t;
+	struct oagucio		*g, *obj, dup;
+	size_t			bkt, n;
+	uint64_t		i;
+	int			round, ret;
+
+	g = malloc(TWTEST_OA_N * sizeof(*g));
+	assert(g != NULL);
+	ret = twhash_oa_init(&t, 0);
+	assert(ret == 0);
+	assert(t.mask + 1 == TWHASH_OA_GROUP);
+	assert(twhash_oa_test_count(&t, 1) == 0);
+
+	// grow from the smallest table
+	for (i = 0; i < TWTEST_OA_N; i++)
+	{
+		g[i].key = i * 3;
+		ret = twhash_oa_add(&t, &g[i].onode, g[i].key);
+		assert(ret == 0);
+	}
+	assert(twhash_oa_count(&t) == TWTEST_OA_N);
+	assert(t.count <= (t.mask + 1) - (t.mask + 1) / 8);
+	for (i = 0; i < TWTEST_OA_N * 3; i++)
+		assert(twhash_oa_test_count(&t, i) == (i % 3 == 0));
+
+	n = 0;
+	twhash_oa_for_each(&t, bkt, obj, onode)
+	{
+		assert(obj->key % 3 == 0);
+		n++;
+	}
+	assert(n == TWTEST_OA_N);
+
+	// churn leaves tombstones behind, table must not grow because of them
+	n = t.mask;
+	for (round = 0; round < 10; round++)
+	{
+		for (i = 0; i < TWTEST_OA_N; i += 2)
+		{
+			ret = twhash_oa_del(&t, &g[i].onode);
+			assert(ret == 0);
+		}
+		ret = twhash_oa_del(&t, &g[0].onode);
+		assert(ret == -1);
+		assert(twhash_oa_count(&t) == TWTEST_OA_N / 2);
+		for (i = 0; i < TWTEST_OA_N; i++)
+			assert(twhash_oa_test_count(&t, g[i].key) == (int) (i % 2));
+		for (i = 0; i < TWTEST_OA_N; i += 2)
+		{
+			ret = twhash_oa_add(&t, &g[i].onode, g[i].key);
+			assert(ret == 0);
+		}
+	}
+	assert(t.mask == n);
+	for (i = 0; i < TWTEST_OA_N; i++)
+		assert(twhash_oa_test_count(&t, g[i].key) == 1);
+
+	// duplicates are kept
+	dup.key = g[0].key;
+	ret = twhash_oa_add(&t, &dup.onode, dup.key);
+	assert(ret == 0);
+	assert(twhash_oa_test_count(&t, g[0].key) == 2);
+
+	twhash_oa_free(&t);
+	free(g);
+	(void) ret;
+}
+
+// object with a byte string key
+struct keygucio
+{
+	char			id[24];
+	size_t			len;
+	struct twhlist_node	hnode;
+};
+
+#define TWTEST_KEY_N	1000
+
+static TWDEFINE_HASHTABLE(key_ht, 8);
+
+// max chain length when hashing "session-<i>" strings into 2^10 buckets
+__attribute__((unused)) static unsigned int
+twhash_buf_test_spread(twhash_buf_fn fn)
+{
+	unsigned int	count[1 << 10] = { 0 }, i, b, max = 0;
+	char		id[32];
+	int		len;
+
+	for (i = 0; i < (1 << 10); i++)
+	{
+		len = snprintf(id, sizeof(id), "session-%u", i);
+		b = fn(id, len, 0) >> (64 - 10);
+		if (++count[b] > max)
+			max = count[b];
+	}
+	return max;
+}
+
+static void
+twhash_buf_test(void)
+{
+	unsigned char		buf[256 + 8];
+	uint64_t		h[257];
+	struct keygucio		*g, *obj;
+	struct twhlist_node	*tmp;
+	unsigned int		i, j, found;
+
+	// same bytes hash the same at any alignment, lengths differ
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i * 7;
+	for (i = 0; i <= 256; i++)
+	{
+		memmove(buf + 3, buf, 256);
+		h[i] = twhash_buf64(buf + 3, i);
+		memmove(buf, buf + 3, 256);
+		assert(h[i] == twhash_buf64(buf, i));
+		assert(h[i] == __twhash_buf_generic(buf, i, 0) ||
+				(i >= 64 && __twhash_buf_impl != __twhash_buf_generic));
+		for (j = 0; j < i; j++)
+			assert(h[i] != h[j]);
+	}
+	assert(twhash_buf_test_spread(__twhash_buf_generic) < 12);
+#ifdef TWHASH_BUF_SSE42
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		assert(__twhash_buf_impl == __twhash_buf_sse42);
+		assert(twhash_buf_test_spread(__twhash_buf_sse42) < 12);
+		assert(__twhash_buf_sse42(buf, 200, 0) !=
+				__twhash_buf_sse42(buf, 199, 0));
+	}
+#endif
+
+	// string keys in a hashtable
+	g = malloc(TWTEST_KEY_N * sizeof(*g));
+	assert(g != NULL);
+	twhash_init(key_ht);
+	for (i = 0; i < TWTEST_KEY_N; i++)
+	{
+		g[i].len = snprintf(g[i].id, sizeof(g[i].id), "session-%u", i);
+		twhash_add_key(key_ht, &g[i].hnode, g[i].id, g[i].len);
+	}
+	for (i = 0; i < TWTEST_KEY_N + 10; i++)
+	{
+		char	id[24];
+		size_t	len = snprintf(id, sizeof(id), "session-%u", i);
+
+		found = 0;
+		twhash_for_each_possible_key(key_ht, obj, hnode, id, len)
+		{
+			if (obj->len == len && !memcmp(obj->id, id, len))
+				found++;
+		}
+		assert(found == (i < TWTEST_KEY_N));
+		twhash_for_each_possible_key_safe(key_ht, obj, tmp, hnode, id, len)
+		{
+			if (obj->len == len && !memcmp(obj->id, id, len))
+				twhash_del(&obj->hnode);
+		}
+	}
+	assert(twhash_empty(key_ht) == 0);
+	free(g);
+	(void) h;
+}
+
+// objects with a 64 and 32 bit key
+struct batchgucio
+{
+	uint64_t		key;
+	struct twhlist_node	hnode;
+};
+
+struct batchgucio32
+{
+	uint32_t		key;
+	struct twhlist_node	hnode;
+};
+
+// narrow signed keys, sign extended by twhash_min
+struct batchgucio8
+{
+	int8_t			key;
+	int16_t			key16;
+	struct twhlist_node	hnode;
+	struct twhlist_node	hnode16;
+};
+
+#define TWTEST_BATCH_N	100
+
+static TWDEFINE_HASHTABLE(batch_ht, 5);
+static TWDEFINE_HASHTABLE(batch_ht32, 5);
+static TWDEFINE_HASHTABLE(batch_ht8, 5);
+static TWDEFINE_HASHTABLE(batch_ht16, 5);
+
+static int
+batchgucio_match8(const struct twhlist_node *node, const void *key)
+{
+	const struct batchgucio8 *g =
+		twhlist_entry(node, struct batchgucio8, hnode);
+
+	return g->key == *(const int8_t *) key;
+}
+
+static int
+batchgucio_match16(const struct twhlist_node *node, const void *key)
+{
+	const struct batchgucio8 *g =
+		twhlist_entry(node, struct batchgucio8, hnode16);
+
+	return g->key16 == *(const int16_t *) key;
+}
+
+static int
+batchgucio_match32(const struct twhlist_node *node, const void *key)
+{
+	const struct batchgucio32 *g =
+		twhlist_entry(node, struct batchgucio32, hnode);
+
+	return g->key == *(const uint32_t *) key;
+}
+
+static int
+batchgucio_match(const struct twhlist_node *node, const void *key)
+{
+	const struct batchgucio *g = twhlist_entry(node, struct batchgucio, hnode);
+
+	return g->key == *(const uint64_t *) key;
+}
+
+static void
+twhash_lookup_batch_test(void)
+{
+	struct batchgucio	g[TWTEST_BATCH_N];
+	struct batchgucio32	g32[TWTEST_BATCH_N];
+	struct batchgucio8	g8[TWTEST_BATCH_N];
+	struct twhlist_node	*res[2 * TWTEST_BATCH_N];
+	uint64_t		keys[2 * TWTEST_BATCH_N];
+	uint32_t		keys32[2 * TWTEST_BATCH_N];
+	int8_t			keys8[TWTEST_BATCH_N];
+	int16_t			keys16[TWTEST_BATCH_N];
+	unsigned int		i;
+	size_t			found;
+
+	twhash_init(batch_ht);
+	twhash_init(batch_ht32);
+	for (i = 0; i < TWTEST_BATCH_N; i++)
+	{
+		g[i].key = (uint64_t) i << 40;
+		twhash_add(batch_ht, &g[i].hnode, g[i].key);
+		g32[i].key = i * 2;
+		twhash_add(batch_ht32, &g32[i].hnode, g32[i].key);
+	}
+	// every other key is missing
+	for (i = 0; i < 2 * TWTEST_BATCH_N; i++)
+	{
+		keys[i] = (uint64_t) (i / 2) << 40 | (i % 2);
+		keys32[i] = i;
+	}
+	found = twhash_lookup_batch(batch_ht, keys, 2 * TWTEST_BATCH_N,
+						batchgucio_match, res);
+	assert(found == TWTEST_BATCH_N);
+	for (i = 0; i < 2 * TWTEST_BATCH_N; i++)
+		assert(res[i] == (i % 2 ? NULL : &g[i / 2].hnode));
+	found = twhash_lookup_batch_bits(batch_ht32, TWHASH_BITS(batch_ht32),
+			keys32, 2 * TWTEST_BATCH_N, batchgucio_match32, res);
+	assert(found == TWTEST_BATCH_N);
+	for (i = 0; i < 2 * TWTEST_BATCH_N; i++)
+		assert(res[i] == (i % 2 ? NULL : &g32[i / 2].hnode));
+	found = twhash_lookup_batch(batch_ht, keys, 0, batchgucio_match, res);
+	assert(found == 0);
+
+	// negative narrow keys land in the bucket twhash_add put them in
+	twhash_init(batch_ht8);
+	twhash_init(batch_ht16);
+	for (i = 0; i < TWTEST_BATCH_N; i++)
+	{
+		g8[i].key = (int8_t) (-1 - (int) i);
+		g8[i].key16 = (int16_t) (-1000 - 7 * (int) i);
+		twhash_add(batch_ht8, &g8[i].hnode, g8[i].key);
+		twhash_add(batch_ht16, &g8[i].hnode16, g8[i].key16);
+		keys8[i] = g8[i].key;
+		keys16[i] = g8[i].key16;
+	}
+	found = twhash_lookup_batch(batch_ht8, keys8, TWTEST_BATCH_N,
+						batchgucio_match8, res);
+	assert(found == TWTEST_BATCH_N);
+	for (i = 0; i < TWTEST_BATCH_N; i++)
+		assert(res[i] == &g8[i].hnode);
+	found = twhash_lookup_batch(batch_ht16, keys16, TWTEST_BATCH_N,
+						batchgucio_match16, res);
+	assert(found == TWTEST_BATCH_N);
+	for (i = 0; i < TWTEST_BATCH_N; i++)
+		assert(res[i] == &g8[i].hnode16);
+	(void) found;
+}
+
+// sorted object, val records insertion order to check stability
+struct sortgucio
+{
+	uint32_t		key;
+	unsigned int		val;
+	struct twlist_head	link;
+};
+
+#define TWTEST_SORT_N	1000
+
+static int
+sortgucio_cmp(void *priv, const struct twlist_head *a,
+			const struct twlist_head *b)
+{
+	const struct sortgucio *ga = twlist_entry(a, struct sortgucio, link);
+	const struct sortgucio *gb = twlist_entry(b, struct sortgucio, link);
+
+	(*(unsigned int *) priv)++;
+	return ga->key > gb->key;
+}
+
+static void
+twlist_sort_check(struct twlist_head *h, unsigned int n)
+{
+	struct sortgucio	*pos, *prev = NULL;
+	struct twlist_head	*p;
+	unsigned int		i = 0;
+
+	twlist_for_each_entry(pos, h, link)
+	{
+		assert(pos->link.prev == (prev ? &prev->link : h));
+		if (prev)
+			assert(prev->key < pos->key ||
+				(prev->key == pos->key && prev->val < pos->val));
+		prev = pos;
+		i++;
+	}
+	assert(i == n);
+	assert(h->prev == (prev ? &prev->link : h));
+	// walk back too
+	i = 0;
+	for (p = h->prev; p != h; p = p->prev)
+		i++;
+	assert(i == n);
+	(void) n;
+}
+
+static void
+twlist_sort_test(void)
+{
+	static struct sortgucio	g[TWTEST_SORT_N];
+	struct twlist_head	h;
+	unsigned int		i, n, ncmp;
+
+	TWINIT_LIST_HEAD(&h);
+	ncmp = 0;
+	twlist_sort(&ncmp, &h, sortgucio_cmp);
+	assert(twlist_empty(&h) && ncmp == 0);
+
+	for (n = 1; n <= TWTEST_SORT_N; n = n * 3 + 1)
+	{
+		// random keys with many duplicates
+		TWINIT_LIST_HEAD(&h);
+		srand(n);
+		for (i = 0; i < n; i++)
+		{
+			g[i].key = rand() % (n / 4 + 1);
+			g[i].val = i;
+			twlist_add_tail(&g[i].link, &h);
+		}
+		twlist_sort(&ncmp, &h, sortgucio_cmp);
+		twlist_sort_check(&h, n);
+
+		// sorted and reverse sorted input
+		TWINIT_LIST_HEAD(&h);
+		for (i = 0; i < n; i++)
+		{
+			g[i].key = n - i;
+			g[i].val = i;
+			twlist_add_tail(&g[i].link, &h);
+		}
+		twlist_sort(&ncmp, &h, sortgucio_cmp);
+		twlist_sort_check(&h, n);
+		ncmp = 0;
+		twlist_sort(&ncmp, &h, sortgucio_cmp);
+		twlist_sort_check(&h, n);
+		// n log n bound
+		for (i = 1; (1u << i) < n; i++)
+			;
+		assert(ncmp <= n * i);
+	}
+}
+
+// skip list object, val records insertion order
+struct skipgucio
+{
+	uint32_t		key;
+	unsigned int		val;
+	struct twskiplist_node	node;
+};
+
+#define TWTEST_SKIP_N	2000
+
+static int
+skipgucio_cmp(const struct twskiplist_node *a, const struct twskiplist_node *b)
+{
+	uint32_t ka = twskiplist_entry(a, struct skipgucio, node)->key;
+	uint32_t kb = twskiplist_entry(b, struct skipgucio, node)->key;
+
+	return (ka > kb) - (ka < kb);
+}
+
+static int
+skipgucio_key_cmp(const struct twskiplist_node *n, const void *key)
+{
+	uint32_t k = twskiplist_entry(n, struct skipgucio, node)->key;
+
+	return (k > *(const uint32_t *) key) - (k < *(const uint32_t *) key);
+}
+
+static void
+twskiplist_check(struct twskiplist *sl, unsigned int n)
+{
+	struct skipgucio	*pos, *prev = NULL;
+	unsigned int		i = 0;
+
+	twskiplist_for_each_entry(pos, sl, node)
+	{
+		if (prev)
+			assert(prev->key < pos->key ||
+				(prev->key == pos->key && prev->val < pos->val));
+		prev = pos;
+		i++;
+	}
+	assert(i == n && twskiplist_count(sl) == n);
+	(void) n;
+}
+
+static void
+twskiplist_test(void)
+{
+	static struct skipgucio	g[TWTEST_SKIP_N];
+	struct twskiplist	sl;
+	struct skipgucio	*pos, *tmp;
+	struct twskiplist_node	*n;
+	uint32_t		key, to;
+	unsigned int		i, cnt;
+
+	twskiplist_init(&sl, skipgucio_cmp, 1);
+	assert(twskiplist_empty(&sl));
+	assert(twskiplist_first(&sl) == NULL && twskiplist_last(&sl) == NULL);
+	key = 0;
+	assert(twskiplist_seek(&sl, &key, skipgucio_key_cmp) == NULL);
+
+	// even keys, every key twice
+	srand(7);
+	for (i = 0; i < TWTEST_SKIP_N; i++)
+	{
+		g[i].key = (rand() % (TWTEST_SKIP_N / 2)) * 2;
+		g[i].val = i;
+		twskiplist_insert(&sl, &g[i].node);
+	}
+	twskiplist_check(&sl, TWTEST_SKIP_N);
+	assert(sl.level > 1);
+
+	// seek, find and range
+	for (key = 0; key < TWTEST_SKIP_N + 2; key++)
+	{
+		n = twskiplist_seek(&sl, &key, skipgucio_key_cmp);
+		if (n)
+		{
+			pos = twskiplist_entry(n, struct skipgucio, node);
+			assert(pos->key >= key);
+			n = twskiplist_prev(&sl, n);
+			assert(!n || twskiplist_entry(n, struct skipgucio,
+							node)->key < key);
+		} else {
+			pos = twskiplist_entry(twskiplist_last(&sl),
+						struct skipgucio, node);
+			assert(pos->key < key);
+		}
+		if (key % 2)
+			assert(twskiplist_find(&sl, &key, skipgucio_key_cmp) == NULL);
+	}
+	key = 100;
+	to = 200;
+	cnt = 0;
+	twskiplist_for_each_entry_range(pos, &sl, node, &key, &to,
+						skipgucio_key_cmp)
+	{
+		assert(pos->key >= key && pos->key < to);
+		cnt++;
+	}
+	for (i = 0; i < TWTEST_SKIP_N; i++)
+		cnt -= (g[i].key >= key && g[i].key < to);
+	assert(cnt == 0);
+
+	// delete every other node, then the rest
+	for (i = 0; i < TWTEST_SKIP_N; i += 2)
+		twskiplist_del(&sl, &g[i].node);
+	twskiplist_check(&sl, TWTEST_SKIP_N / 2);
+	for (i = 1; i < TWTEST_SKIP_N; i += 2)
+	{
+		key = g[i].key;
+		n = twskiplist_find(&sl, &key, skipgucio_key_cmp);
+		assert(n && twskiplist_entry(n, struct skipgucio, node)->key == key);
+	}
+	twskiplist_for_each_entry_safe(pos, tmp, &sl, node)
+		twskiplist_del(&sl, &pos->node);
+	assert(twskiplist_empty(&sl) && twskiplist_count(&sl) == 0);
+	assert(sl.level == 1);
+}
+
+// red-black tree object
+struct rbgucio
+{
+	uint32_t		key;
+	struct twrb_node	node;
+};
+
+#define TWTEST_RB_N	2000
+
+static int
+rbgucio_less(const struct twrb_node *a, const struct twrb_node *b)
+{
+	return twrb_entry(a, struct rbgucio, node)->key <
+		twrb_entry(b, struct rbgucio, node)->key;
+}
+
+static int
+rbgucio_cmp(const void *key, const struct twrb_node *n)
+{
+	uint32_t k = twrb_entry(n, struct rbgucio, node)->key;
+
+	return (*(const uint32_t *) key > k) - (*(const uint32_t *) key < k);
+}
+
+// returns black height of the subtree, checks red-black properties
+static int
+twrbtree_check_node(const struct twrb_node *n, const struct twrb_node *parent)
+{
+	int l, r;
+
+	if (!n)
+		return 1;
+	assert(twrb_parent(n) == parent);
+	if (twrb_is_red(n))
+		assert(!parent || twrb_is_black(parent));
+	l = twrbtree_check_node(n->rb_left, n);
+	r = twrbtree_check_node(n->rb_right, n);
+	assert(l == r);
+	(void) parent;
+	(void) r;
+	return l + twrb_is_black(n);
+}
+
+static void
+twrbtree_check(const struct twrb_root *root, unsigned int n)
+{
+	struct rbgucio	*pos, *prev = NULL;
+	unsigned int	i = 0;
+
+	assert(!root->rb_node || twrb_is_black(root->rb_node));
+	twrbtree_check_node(root->rb_node, NULL);
+	twrb_for_each_entry(pos, root, node)
+	{
+		assert(!prev || prev->key <= pos->key);
+		assert(twrb_prev(&pos->node) == (prev ? &prev->node : NULL));
+		prev = pos;
+		i++;
+	}
+	assert(i == n);
+	assert(twrb_last(root) == (prev ? &prev->node : NULL));
+	(void) prev;
+	(void) n;
+}
+
+static void
+twrbtree_test(void)
+{
+	static struct rbgucio	g[TWTEST_RB_N];
+	struct twrb_root	root = TWRB_ROOT;
+	struct twrb_node	*n;
+	struct rbgucio		*pos, *tmp, repl;
+	uint32_t		key;
+	unsigned int		i, cnt;
+
+	assert(TWRB_EMPTY_ROOT(&root));
+	assert(twrb_first(&root) == NULL && twrb_last(&root) == NULL);
+	srand(11);
+	for (i = 0; i < TWTEST_RB_N; i++)
+	{
+		g[i].key = (rand() % TWTEST_RB_N) * 2;
+		twrb_add(&g[i].node, &root, rbgucio_less);
+		if (i % 97 == 0)
+			twrbtree_check(&root, i + 1);
+	}
+	twrbtree_check(&root, TWTEST_RB_N);
+
+	// lookups
+	for (key = 0; key < 2 * TWTEST_RB_N + 2; key++)
+	{
+		n = twrb_lower_bound(&key, &root, rbgucio_cmp);
+		if (n)
+		{
+			assert(twrb_entry(n, struct rbgucio, node)->key >= key);
+			n = twrb_prev(n);
+			assert(!n || twrb_entry(n, struct rbgucio, node)->key < key);
+		} else
+			assert(twrb_entry(twrb_last(&root), struct rbgucio,
+						node)->key < key);
+		n = twrb_find(&key, &root, rbgucio_cmp);
+		if (key % 2)
+			assert(n == NULL);
+		else if (n)
+			assert(twrb_entry(n, struct rbgucio, node)->key == key);
+	}
+
+	// replace keeps the shape
+	repl.key = g[0].key;
+	twrb_replace_node(&g[0].node, &repl.node, &root);
+	twrbtree_check(&root, TWTEST_RB_N);
+	twrb_replace_node(&repl.node, &g[0].node, &root);
+
+	// erase every third, then the rest
+	for (i = 0; i < TWTEST_RB_N; i += 3)
+	{
+		twrb_erase(&g[i].node, &root);
+		TWRB_CLEAR_NODE(&g[i].node);
+		assert(TWRB_EMPTY_NODE(&g[i].node));
+	}
+	cnt = TWTEST_RB_N - (TWTEST_RB_N + 2) / 3;
+	twrbtree_check(&root, cnt);
+	for (i = 0; i < TWTEST_RB_N; i++)
+	{
+		if (i % 3 == 0)
+			continue;
+		twrb_erase(&g[i].node, &root);
+		if (--cnt % 101 == 0)
+			twrbtree_check(&root, cnt);
+	}
+	assert(TWRB_EMPTY_ROOT(&root));
+
+	// postorder visits all and allows dropping the tree
+	for (i = 0; i < TWTEST_RB_N; i++)
+		twrb_add(&g[i].node, &root, rbgucio_less);
+	cnt = 0;
+	twrb_postorder_for_each_entry_safe(pos, tmp, &root, node)
+	{
+		TWRB_CLEAR_NODE(&pos->node);
+		cnt++;
+	}
+	assert(cnt == TWTEST_RB_N);
+}
+
+// object recycled between buckets without a grace period
+struct nullsgucio
+{
+	uint32_t			key;
+	struct twhlist_nulls_node	node;
+};
+
+#define TWTEST_NULLS_KEYS	64
+#define TWTEST_NULLS_MOVES	20000
+
+static TWDEFINE_HASHTABLE_NULLS(nulls_ht, 3);
+static int			nulls_stop;
+
+static void *
+twhash_nulls_test_reader(void *arg)
+{
+	struct nullsgucio		*obj;
+	struct twhlist_nulls_node	*pos;
+	uint32_t			key = 0;
+
+	(void) arg;
+	while (!__atomic_load_n(&nulls_stop, __ATOMIC_RELAXED))
+	{
+		// stable objects have even keys and must always be found
+		obj = twhash_nulls_lookup_rcu(nulls_ht, obj, pos, node, key,
+				__atomic_load_n(&obj->key, __ATOMIC_RELAXED) == key);
+		assert(obj != NULL);
+		key = (key + 2) % TWTEST_NULLS_KEYS;
+		if (key == 0)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void
+twhash_nulls_test(void)
+{
+	static struct nullsgucio	g[TWTEST_NULLS_KEYS];
+	struct nullsgucio		*obj, *a = NULL, *b = NULL;
+	struct twhlist_nulls_node	*pos;
+	pthread_t			tid;
+	unsigned long			ia;
+	uint32_t			i, key;
+	int				ret;
+
+	twhash_nulls_init(nulls_ht);
+	for (i = 0; i < TWHASH_SIZE(nulls_ht); i++)
+	{
+		assert(twhlist_nulls_empty(&nulls_ht[i]));
+		assert(twget_nulls_value(nulls_ht[i].first) == i);
+	}
+	for (i = 0; i < TWTEST_NULLS_KEYS; i++)
+	{
+		g[i].key = i;
+		TWINIT_HLIST_NULLS_NODE(&g[i].node);
+		twhash_nulls_add_rcu(nulls_ht, &g[i].node, g[i].key);
+	}
+	for (i = 0; i < TWTEST_NULLS_KEYS; i++)
+	{
+		obj = twhash_nulls_lookup_rcu(nulls_ht, obj, pos, node, i,
+							obj->key == i);
+		assert(obj == &g[i]);
+	}
+	key = TWTEST_NULLS_KEYS;
+	obj = twhash_nulls_lookup_rcu(nulls_ht, obj, pos, node, key,
+							obj->key == key);
+	assert(obj == NULL);
+
+	// a reader standing on a node which gets moved to another bucket
+	// ends on the other bucket's nulls
+	for (i = 0; i < TWTEST_NULLS_KEYS && !b; i++)
+	{
+		if (!a)
+			a = &g[i];
+		else if (twhash_nulls_idx(nulls_ht, g[i].key) !=
+				twhash_nulls_idx(nulls_ht, a->key))
+			b = &g[i];
+	}
+	assert(a && b);
+	ia = twhash_nulls_idx(nulls_ht, a->key);
+	twhash_nulls_for_each_possible_rcu(nulls_ht, obj, pos, node, a->key)
+	{
+		if (obj == a)
+		{
+			twhash_nulls_del_rcu(&a->node);
+			assert(twhlist_nulls_unhashed(&a->node));
+			twhash_nulls_add_rcu(nulls_ht, &a->node, b->key);
+		}
+	}
+	assert(twis_a_nulls(pos));
+	assert(twget_nulls_value(pos) != ia);
+	twhash_nulls_del_rcu(&a->node);
+	twhash_nulls_add_rcu(nulls_ht, &a->node, a->key);
+
+	// odd keyed objects keep moving between buckets under a reader
+	ret = pthread_create(&tid, NULL, twhash_nulls_test_reader, NULL);
+	assert(ret == 0);
+	for (i = 0; i < TWTEST_NULLS_MOVES; i++)
+	{
+		obj = &g[(i % (TWTEST_NULLS_KEYS / 2)) * 2 + 1];
+		twhash_nulls_del_rcu(&obj->node);
+		key = obj->key + TWTEST_NULLS_KEYS;
+		__atomic_store_n(&obj->key, key % (8 * TWTEST_NULLS_KEYS) | 1,
+							__ATOMIC_RELAXED);
+		twhash_nulls_add_rcu(nulls_ht, &obj->node, obj->key);
+		if (i % 64 == 0)
+			sched_yield();
+	}
+	__atomic_store_n(&nulls_stop, 1, __ATOMIC_RELAXED);
+	ret = pthread_join(tid, NULL);
+	assert(ret == 0);
+	(void) ia;
+	(void) ret;
+}
+
+// cached object
+struct lrugucio
+{
+	int			val;
+	int			refs;
+	struct twlru_node	node;
+};
+
+#define TWTEST_LRU_CAP		64
+#define TWTEST_LRU_THREADS	4
+#define TWTEST_LRU_OPS		20000
+
+static int	lru_evicted;
+
+static void
+lrugucio_evict(struct twlru_node *n, void *priv)
+{
+	struct lrugucio *g = twlru_entry(n, struct lrugucio, node);
+
+	assert(priv == &lru_evicted);
+	(void) priv;
+	g->val = -1;
+	lru_evicted++;
+}
+
+static void
+lrugucio_get(struct twlru_node *n, void *priv)
+{
+	(void) priv;
+	twlru_entry(n, struct lrugucio, node)->refs++;
+}
+
+static const struct twlru_ops lru_ops = {
+	.evict = lrugucio_evict,
+	.get = lrugucio_get,
+};
+
+// objects are owned by the evict callback, freed on eviction
+static void
+lrugucio_evict_free(struct twlru_node *n, void *priv)
+{
+	(void) priv;
+	__atomic_fetch_add(&lru_evicted, 1, __ATOMIC_RELAXED);
+	free(twlru_entry(n, struct lrugucio, node));
+}
+
+static const struct twlru_ops lru_free_ops = {
+	.evict = lrugucio_evict_free,
+};
+
+static struct twlru	lru_mt;
+
+static void *
+twlru_test_worker(void *arg)
+{
+	struct lrugucio	*g;
+	uint64_t	key = (uintptr_t) arg;
+	unsigned int	i;
+
+	for (i = 0; i < TWTEST_LRU_OPS; i++)
+	{
+		key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+		if (i % 3)
+		{
+			g = malloc(sizeof(*g));
+			assert(g != NULL);
+			twlru_insert(&lru_mt, &g->node, key >> 56);
+		}
+		else if ((i % 7) == 0)
+		{
+			struct twlru_node *n = twlru_del(&lru_mt, key >> 56);
+
+			if (n)
+				lrugucio_evict_free(n, NULL);
+		}
+		else
+			// no get callback: the object may go away right after
+			(void) twlru_get(&lru_mt, key >> 56);
+		if (i % 256 == 0)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void
+twlru_test(void)
+{
+	static struct lrugucio	g[2 * TWTEST_LRU_CAP];
+	struct lrugucio		dup;
+	struct twlru		c;
+	struct twlru_node	*n;
+	pthread_t		tid[TWTEST_LRU_THREADS];
+	unsigned int		i;
+	int			ret;
+
+	// single shard behaves like a plain LRU
+	ret = twlru_init(&c, TWTEST_LRU_CAP, 1, &lru_ops, &lru_evicted);
+	assert(ret == 0);
+	assert(twlru_capacity(&c) == TWTEST_LRU_CAP);
+	for (i = 0; i < TWTEST_LRU_CAP; i++)
+	{
+		g[i].val = i;
+		g[i].refs = 0;
+		twlru_insert(&c, &g[i].node, i);
+	}
+	assert(twlru_count(&c) == TWTEST_LRU_CAP && lru_evicted == 0);
+	// touch the oldest half, the other half goes first
+	for (i = 0; i < TWTEST_LRU_CAP / 2; i++)
+	{
+		n = twlru_get(&c, i);
+		assert(n == &g[i].node && g[i].refs == 1);
+	}
+	n = twlru_get(&c, 2 * TWTEST_LRU_CAP);
+	assert(n == NULL);
+	for (i = TWTEST_LRU_CAP; i < TWTEST_LRU_CAP + TWTEST_LRU_CAP / 2; i++)
+	{
+		g[i].val = i;
+		twlru_insert(&c, &g[i].node, i);
+		assert(g[i - TWTEST_LRU_CAP / 2].val == -1);
+	}
+	assert(lru_evicted == TWTEST_LRU_CAP / 2);
+	assert(twlru_count(&c) == TWTEST_LRU_CAP);
+	for (i = 0; i < TWTEST_LRU_CAP / 2; i++)
+	{
+		n = twlru_get(&c, i);
+		assert(n == &g[i].node);
+	}
+	for (i = TWTEST_LRU_CAP / 2; i < TWTEST_LRU_CAP; i++)
+	{
+		n = twlru_get(&c, i);
+		assert(n == NULL);
+	}
+
+	// replacing evicts the old object
+	dup.val = 0;
+	twlru_insert(&c, &dup.node, 0);
+	n = twlru_get(&c, 0);
+	assert(g[0].val == -1 && n == &dup.node);
+	assert(lru_evicted == TWTEST_LRU_CAP / 2 + 1);
+
+	// removed objects go back to the caller
+	n = twlru_del(&c, 1);
+	assert(n == &g[1].node && g[1].val == 1);
+	n = twlru_del(&c, 1);
+	assert(n == NULL);
+	assert(twlru_count(&c) == TWTEST_LRU_CAP - 1);
+
+	lru_evicted = 0;
+	twlru_free(&c);
+	assert(lru_evicted == TWTEST_LRU_CAP - 1);
+
+	// sharded, shard count is rounded up, capacity is not
+	ret = twlru_init(&c, 100, 3, NULL, NULL);
+	assert(ret == 0);
+	assert(c.nshards == 4 && twlru_capacity(&c) == 100);
+	for (i = 0; i < 2 * TWTEST_LRU_CAP; i++)
+		twlru_insert(&c, &g[i].node, i);
+	assert(twlru_count(&c) <= 100);
+	for (i = 0; i < 4; i++)
+		assert(c.shards[i].count > 0 && c.shards[i].count <= 25);
+	twlru_free(&c);
+
+	// the remainder goes to the first shards, one object each
+	ret = twlru_init(&c, 102, 4, NULL, NULL);
+	assert(ret == 0);
+	assert(twlru_capacity(&c) == 102);
+	assert(c.shards[0].capacity == 26 && c.shards[1].capacity == 26);
+	assert(c.shards[2].capacity == 25 && c.shards[3].capacity == 25);
+	for (i = 0; i < 2 * TWTEST_LRU_CAP; i++)
+		twlru_insert(&c, &g[i].node, i);
+	assert(twlru_count(&c) <= 102);
+	twlru_free(&c);
+
+	// at least one object per shard
+	ret = twlru_init(&c, 2, 4, NULL, NULL);
+	assert(ret == 0);
+	assert(twlru_capacity(&c) == 4);
+	twlru_free(&c);
+
+	// concurrent inserts, lookups and removals
+	lru_evicted = 0;
+	ret = twlru_init(&lru_mt, TWTEST_LRU_CAP, 8, &lru_free_ops, NULL);
+	assert(ret == 0);
+	for (i = 0; i < TWTEST_LRU_THREADS; i++)
+	{
+		ret = pthread_create(&tid[i], NULL, twlru_test_worker,
+					(void *) (uintptr_t) (i + 1));
+		assert(ret == 0);
+	}
+	for (i = 0; i < TWTEST_LRU_THREADS; i++)
+	{
+		ret = pthread_join(tid[i], NULL);
+		assert(ret == 0);
+	}
+	assert(twlru_count(&lru_mt) <= twlru_capacity(&lru_mt));
+	twlru_free(&lru_mt);
+	(void) n;
+	(void) ret;
+}
+
+// pooled object
+struct poolgucio
+{
+	uint64_t		key;
+	struct twhlist_node	hnode;
+	unsigned char		pad[40];
+};
+
+// looked up by lockless readers over nulls chains, the pool's free link
+// must not overlay the node
+struct poolnulls
+{
+	struct twhlist_nulls_node	node;
+	struct twlist_head		free;
+	uint64_t			key;
+};
+
+#define TWTEST_POOL_N		1000
+#define TWTEST_POOL_THREADS	4
+#define TWTEST_POOL_OPS		20000
+
+static TWDEFINE_HASHTABLE(pool_ht, 6);
+static struct twpool	pool_mt;
+
+static void *
+twpool_test_worker(void *arg)
+{
+	struct twpool_cache	c;
+	struct poolgucio	*live[64];
+	unsigned int		i, n = 0;
+
+	(void) arg;
+	twpool_cache_init(&c, &pool_mt);
+	for (i = 0; i < TWTEST_POOL_OPS; i++)
+	{
+		if (n < 64 && (i % 3 || n == 0))
+		{
+			live[n] = twpool_cache_alloc(&c);
+			assert(live[n] != NULL);
+			live[n]->key = (uintptr_t) live[n];
+			n++;
+		} else {
+			n--;
+			assert(live[n]->key == (uintptr_t) live[n]);
+			twpool_cache_free(&c, live[n]);
+		}
+		assert(c.count <= 2 * TWPOOL_MAGAZINE);
+		if (i % 256 == 0)
+			sched_yield();
+	}
+	while (n)
+		twpool_cache_free(&c, live[--n]);
+	twpool_cache_destroy(&c);
+	assert(c.count == 0 && twlist_empty(&c.free));
+	return NULL;
+}
+
+static void
+twpool_test(void)
+{
+	static struct poolgucio	*g[TWTEST_POOL_N];
+	struct twpool		p;
+	struct twpool_cache	c;
+	struct poolgucio	*obj;
+	struct poolnulls	*pn;
+	void			*bulk[TWPOOL_MAGAZINE * 3];
+	pthread_t		tid[TWTEST_POOL_THREADS];
+	unsigned int		i, bkt;
+	size_t			cnt, nslabs;
+	int			ret;
+
+	ret = twpool_init(&p, sizeof(struct poolgucio));
+	assert(ret == 0);
+	assert(twpool_obj_size(&p) >= sizeof(struct poolgucio));
+	assert(twpool_obj_size(&p) % TWPOOL_ALIGN == 0);
+
+	// objects of a slab are handed out in address order
+	twhash_init(pool_ht);
+	for (i = 0; i < TWTEST_POOL_N; i++)
+	{
+		g[i] = twpool_alloc(&p);
+		assert(g[i] != NULL);
+		assert((uintptr_t) g[i] % TWPOOL_ALIGN == 0);
+		if (i % p.per_slab)
+			assert((unsigned char *) g[i] ==
+				(unsigned char *) g[i - 1] + twpool_obj_size(&p));
+		g[i]->key = i;
+		twhash_add(pool_ht, &g[i]->hnode, g[i]->key);
+	}
+	assert(p.nslabs == (TWTEST_POOL_N + p.per_slab - 1) / p.per_slab);
+	cnt = 0;
+	twhash_for_each(pool_ht, bkt, obj, hnode)
+	{
+		assert(obj == g[obj->key]);
+		cnt++;
+	}
+	assert(cnt == TWTEST_POOL_N);
+	for (i = 0; i < TWTEST_POOL_N; i++)
+	{
+		twhash_del(&g[i]->hnode);
+		twpool_free(&p, g[i]);
+	}
+	assert(p.nfree == p.nslabs * p.per_slab);
+
+	// freed objects are reused before the pool grows
+	nslabs = p.nslabs;
+	cnt = twpool_alloc_bulk(&p, bulk, TWARRAY_SIZE(bulk));
+	assert(cnt == TWARRAY_SIZE(bulk));
+	assert(p.nslabs == nslabs);
+	twpool_free_bulk(&p, bulk, TWARRAY_SIZE(bulk));
+
+	// thread cache refills and flushes in magazines
+	twpool_cache_init(&c, &p);
+	for (i = 0; i < TWARRAY_SIZE(bulk); i++)
+	{
+		bulk[i] = twpool_cache_alloc(&c);
+		assert(bulk[i] != NULL);
+	}
+	assert(c.count < TWPOOL_MAGAZINE);
+	for (i = 0; i < TWARRAY_SIZE(bulk); i++)
+		twpool_cache_free(&c, bulk[i]);
+	assert(c.count <= 2 * TWPOOL_MAGAZINE && c.count > TWPOOL_MAGAZINE);
+	// the most recently freed object is the next one out
+	obj = twpool_cache_alloc(&c);
+	assert(obj == bulk[TWARRAY_SIZE(bulk) - 1]);
+	twpool_cache_free(&c, obj);
+	twpool_cache_destroy(&c);
+	assert(p.nfree == p.nslabs * p.per_slab);
+	twpool_destroy(&p);
+
+	// with the free link out of the way the node survives free
+	ret = twpool_init_link(&p, sizeof(struct poolnulls),
+					offsetof(struct poolnulls, free));
+	assert(ret == 0);
+	ret = twpool_init_link(&pool_mt, 64, 3);
+	assert(ret == -1);
+	twpool_cache_init(&c, &p);
+	for (i = 0; i < TWARRAY_SIZE(bulk); i++)
+	{
+		pn = i % 2 ? twpool_alloc(&p) : twpool_cache_alloc(&c);
+		assert(pn != NULL);
+		pn->node.next = (struct twhlist_nulls_node *) (uintptr_t)
+								(2 * i + 1);
+		pn->node.pprev = NULL;
+		pn->key = i;
+		bulk[i] = pn;
+	}
+	for (i = 0; i < TWARRAY_SIZE(bulk); i++)
+	{
+		if (i % 2)
+			twpool_free(&p, bulk[i]);
+		else
+			twpool_cache_free(&c, bulk[i]);
+	}
+	for (i = 0; i < TWARRAY_SIZE(bulk); i++)
+	{
+		pn = bulk[i];
+		assert(pn->node.next == (struct twhlist_nulls_node *)
+						(uintptr_t) (2 * i + 1));
+		assert(pn->key == i);
+	}
+	twpool_cache_destroy(&c);
+	twpool_destroy(&p);
+
+	// threads with their own caches share one pool
+	ret = twpool_init(&pool_mt, sizeof(struct poolgucio));
+	assert(ret == 0);
+	for (i = 0; i < TWTEST_POOL_THREADS; i++)
+	{
+		ret = pthread_create(&tid[i], NULL, twpool_test_worker, NULL);
+		assert(ret == 0);
+	}
+	for (i = 0; i < TWTEST_POOL_THREADS; i++)
+	{
+		ret = pthread_join(tid[i], NULL);
+		assert(ret == 0);
+	}
+	assert(pool_mt.nfree == pool_mt.nslabs * pool_mt.per_slab);
+	twpool_destroy(&pool_mt);
+	(void) nslabs;
+	(void) ret;
+}
+
+#define TWTEST_STATS_N	100
+
+static TWDEFINE_HASHTABLE(stats_ht, 4);
+
+static void
+twhash_stats_test(void)
+{
+	struct batchgucio	g[TWTEST_STATS_N], *obj;
+	struct twhash_stats	st;
+	struct twhash_dyn	dyn;
+	struct twhash_dyn_node	dn[TWTEST_STATS_N];
+	unsigned long		lookups, probes;
+	size_t			i, sum;
+	int			ret;
+
+	twhash_init(stats_ht);
+	twhash_stats(stats_ht, &st);
+	assert(st.buckets == 16 && st.used == 0 && st.entries == 0);
+	assert(st.max_chain == 0 && st.p99_chain == 0);
+	assert(st.load_factor == 0 && st.mean_chain == 0);
+	assert(st.hist[0] == 16);
+
+	// all in one bucket
+	for (i = 0; i < TWTEST_STATS_N; i++)
+	{
+		g[i].key = 42;
+		twhash_add(stats_ht, &g[i].hnode, g[i].key);
+	}
+	twhash_stats(stats_ht, &st);
+	assert(st.used == 1 && st.entries == TWTEST_STATS_N);
+	assert(st.max_chain == TWTEST_STATS_N && st.p99_chain == TWTEST_STATS_N);
+	assert(st.hist[0] == 15 && st.hist[TWHASH_STATS_HIST - 1] == 1);
+	assert(st.mean_chain == TWTEST_STATS_N);
+	assert(st.load_factor == (double) TWTEST_STATS_N / 16);
+
+	// probes: a miss walks the whole chain
+	lookups = twhash_probes.lookups;
+	probes = twhash_probes.probes;
+	twhash_for_each_possible(stats_ht, obj, hnode, (uint64_t) 42)
+		if (obj->key != 42)
+			break;
+	assert(twhash_probes.lookups == lookups + 1);
+	assert(twhash_probes.probes == probes + TWTEST_STATS_N);
+	twhash_for_each_possible(stats_ht, obj, hnode, (uint64_t) 42)
+		break;
+	assert(twhash_probes.lookups == lookups + 2);
+	assert(twhash_probes.probes == probes + TWTEST_STATS_N + 1);
+	for (i = 0; i < TWTEST_STATS_N; i++)
+		twhash_del(&g[i].hnode);
+
+	// spread keys, histogram adds up
+	for (i = 0; i < TWTEST_STATS_N; i++)
+	{
+		g[i].key = i;
+		twhash_add(stats_ht, &g[i].hnode, g[i].key);
+	}
+	twhash_stats_bits(stats_ht, TWHASH_BITS(stats_ht), &st);
+	sum = 0;
+	for (i = 0; i < TWHASH_STATS_HIST; i++)
+		sum += st.hist[i] * i;
+	assert(sum == TWTEST_STATS_N && st.entries == TWTEST_STATS_N);
+	assert(st.used + st.hist[0] == 16);
+	assert(st.p99_chain <= st.max_chain && st.p99_chain > 0);
+
+	// resizable table, also in the middle of a resize
+	ret = twhash_dyn_init(&dyn, 4);
+	assert(ret == 0);
+	for (i = 0; i < TWTEST_STATS_N; i++)
+	{
+		twhash_dyn_add(&dyn, &dn[i], (uint32_t) i);
+		twhash_dyn_stats(&dyn, &st);
+		assert(st.entries == i + 1);
+	}
+	assert(st.buckets >= TWTEST_STATS_N);
+	twhash_dyn_free(&dyn);
+	(void) lookups;
+	(void) probes;
+	(void) ret;
+}
+
+#define TWTEST_SEEDED_N	1000
+
+static TWDEFINE_HASHTABLE(seeded_ht, 6);
+
+static void
+twhash_seeded_test(void)
+{
+	struct batchgucio	*g, *obj;
+	struct twhash_seed	seed, seed2;
+	unsigned char		msg[15];
+	size_t			i, found;
+	int			differ;
+
+	// SipHash-2-4 reference vectors, key 00 01 .. 0f
+	seed.k0 = 0x0706050403020100ULL;
+	seed.k1 = 0x0f0e0d0c0b0a0908ULL;
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char) i;
+	assert(__twhash_sip(msg, 0, &seed, 2, 4) == 0x726fdb47dd0e0e31ULL);
+	assert(__twhash_sip(msg, 8, &seed, 2, 4) == 0x93f5f5799a932462ULL);
+	assert(__twhash_sip(msg, 15, &seed, 2, 4) == 0xa129ca6149be45e5ULL);
+
+	// the unrolled integer variant matches the byte one
+	for (i = 0; i < 100; i++)
+	{
+		uint64_t v = i * 0x9e3779b97f4a7c15ULL;
+
+		assert(twhash_sip13_u64(v, &seed) == twhash_sip13(&v, 8, &seed));
+		(void) v;
+	}
+
+	// another seed moves keys to other buckets
+	twhash_seed_init(&seed);
+	twhash_seed_init(&seed2);
+	assert(seed.k0 != seed2.k0 || seed.k1 != seed2.k1);
+	differ = 0;
+	for (i = 0; i < 100; i++)
+		if (twhash_seeded(i, &seed, 10) != twhash_seeded(i, &seed2, 10))
+			differ++;
+	assert(differ > 50);
+	assert(twhash_buf_seeded("gucio", 5, &seed, 10) ==
+			twhash_sip13("gucio", 5, &seed) >> 54);
+
+	// add and look up through a seeded table
+	g = malloc(TWTEST_SEEDED_N * sizeof(*g));
+	assert(g);
+	twhash_init(seeded_ht);
+	for (i = 0; i < TWTEST_SEEDED_N; i++)
+	{
+		g[i].key = i << 12;
+		twhash_add_seeded(seeded_ht, &g[i].hnode, g[i].key, &seed);
+	}
+	for (i = 0; i < TWTEST_SEEDED_N; i++)
+	{
+		found = 0;
+		twhash_for_each_possible_seeded(seeded_ht, obj, hnode,
+						g[i].key, &seed)
+			if (obj->key == g[i].key)
+				found++;
+		assert(found == 1);
+		found = 0;
+		twhash_for_each_possible_seeded_bits(seeded_ht, obj, hnode,
+				g[i].key, &seed, TWHASH_BITS(seeded_ht))
+			if (obj == &g[i])
+				found++;
+		assert(found == 1);
+	}
+	found = 0;
+	twhash_for_each_possible_seeded(seeded_ht, obj, hnode,
+					(uint64_t) 1, &seed)
+		if (obj->key == 1)
+			found++;
+	assert(found == 0);
+	for (i = 0; i < TWTEST_SEEDED_N; i++)
+		twhash_del(&g[i].hnode);
+	assert(twhash_empty(seeded_ht) == 0);
+	free(g);
+}
+
+#define TWTEST_SHARDED_N	1000
+#define TWTEST_SHARDED_THREADS	4
+
+struct sharded_arg
+{
+	struct twhash_sharded	*t;
+	struct batchgucio	*g;	/* objects owned by the thread */
+	size_t			n;
+	size_t			found;
+};
+
+static int
+twhash_sharded_test_sum(struct twhlist_node *node, void *priv)
+{
+	struct batchgucio *obj = twhlist_entry(node, struct batchgucio, hnode);
+
+	*(uint64_t *) priv += obj->key;
+	return 0;
+}
+
+static int
+twhash_sharded_test_stop(struct twhlist_node *node, void *priv)
+{
+	(void) node;
+	return ++*(size_t *) priv == 10 ? 7 : 0;
+}
+
+// each thread removes and re-adds its own objects, looking them up in
+// between, while the other threads do the same in the other shards
+static void *
+twhash_sharded_test_worker(void *arg)
+{
+	struct sharded_arg	*a = arg;
+	struct batchgucio	*obj;
+	size_t			r, i;
+
+	for (r = 0; r < 20; r++)
+	{
+		for (i = 0; i < a->n; i++)
+		{
+			obj = twhash_sharded_remove(a->t, obj, hnode,
+				a->g[i].key, obj->key == a->g[i].key);
+			assert(obj == &a->g[i]);
+			obj = twhash_sharded_lookup(a->t, obj, hnode,
+				a->g[i].key, obj->key == a->g[i].key);
+			assert(obj == NULL);
+			twhash_sharded_add(a->t, &a->g[i].hnode, a->g[i].key);
+			obj = twhash_sharded_lookup(a->t, obj, hnode,
+				a->g[i].key, obj->key == a->g[i].key);
+			assert(obj == &a->g[i]);
+			a->found++;
+		}
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void
+twhash_sharded_test(void)
+{
+	struct twhash_sharded	t;
+	struct batchgucio	*g, *obj;
+	struct twhlist_node	*tmp;
+	struct sharded_arg	args[TWTEST_SHARDED_THREADS];
+	pthread_t		th[TWTEST_SHARDED_THREADS];
+	uint64_t		sum = 0;
+	size_t			i, visited = 0, per;
+	int			ret;
+
+	ret = twhash_sharded_init(&t, 2, 31);
+	assert(ret == -1);
+	ret = twhash_sharded_init(&t, 4, 6);
+	assert(ret == 0);
+	g = malloc(TWTEST_SHARDED_N * sizeof(*g));
+	assert(g);
+	for (i = 0; i < TWTEST_SHARDED_N; i++)
+	{
+		g[i].key = i * 3;
+		twhash_sharded_add(&t, &g[i].hnode, g[i].key);
+	}
+	assert(twhash_sharded_count(&t) == TWTEST_SHARDED_N);
+	for (i = 0; i < 16; i++)
+		assert(t.shards[i].count > 0);
+
+	// lookups, hits and misses
+	for (i = 0; i < TWTEST_SHARDED_N; i++)
+	{
+		obj = twhash_sharded_lookup(&t, obj, hnode, g[i].key,
+						obj->key == g[i].key);
+		assert(obj == &g[i]);
+		obj = twhash_sharded_lookup(&t, obj, hnode, g[i].key + 1,
+						obj->key == g[i].key + 1);
+		assert(obj == NULL);
+	}
+
+	// iteration under the caller's lock
+	twhash_sharded_read_lock(&t, g[5].key);
+	i = 0;
+	twhash_sharded_for_each_possible(&t, obj, hnode, g[5].key)
+		if (obj == &g[5])
+			i++;
+	twhash_sharded_unlock(&t, g[5].key);
+	assert(i == 1);
+	twhash_sharded_write_lock(&t, g[6].key);
+	twhash_sharded_for_each_possible_safe(&t, obj, tmp, hnode, g[6].key)
+		if (obj == &g[6])
+			twhash_sharded_del_locked(&t, &obj->hnode, obj->key);
+	twhash_sharded_add_locked(&t, &g[6].hnode, g[6].key);
+	twhash_sharded_unlock(&t, g[6].key);
+	assert(twhash_sharded_count(&t) == TWTEST_SHARDED_N);
+
+	// whole table walk
+	ret = twhash_sharded_for_each(&t, twhash_sharded_test_sum, &sum);
+	assert(ret == 0);
+	assert(sum == 3ULL * TWTEST_SHARDED_N * (TWTEST_SHARDED_N - 1) / 2);
+	ret = twhash_sharded_for_each(&t, twhash_sharded_test_stop, &visited);
+	assert(ret == 7 && visited == 10);
+
+	// concurrent writers and readers
+	per = TWTEST_SHARDED_N / TWTEST_SHARDED_THREADS;
+	for (i = 0; i < TWTEST_SHARDED_THREADS; i++)
+	{
+		args[i].t = &t;
+		args[i].g = &g[i * per];
+		args[i].n = per;
+		args[i].found = 0;
+		ret = pthread_create(&th[i], NULL, twhash_sharded_test_worker,
+								&args[i]);
+		assert(ret == 0);
+	}
+	for (i = 0; i < TWTEST_SHARDED_THREADS; i++)
+	{
+		ret = pthread_join(th[i], NULL);
+		assert(ret == 0 && args[i].found == 20 * per);
+	}
+	assert(twhash_sharded_count(&t) == TWTEST_SHARDED_N);
+
+	for (i = 0; i < TWTEST_SHARDED_N; i++)
+		twhash_sharded_del(&t, &g[i].hnode, g[i].key);
+	assert(twhash_sharded_count(&t) == 0);
+	/* removing an object twice must not underflow the count */
+	twhash_sharded_del(&t, &g[0].hnode, g[0].key);
+	assert(twhash_sharded_count(&t) == 0);
+	twhash_sharded_free(&t);
+	free(g);
+	(void) ret;
+}
+
+#define TWTEST_TIMER_N		2000
+#define TWTEST_TIMER_SPAN	(1 << 21)
+
+struct timergucio
+{
+	struct twtimer	timer;
+	uint64_t	fired;
+	unsigned int	count;
+};
+
+static uint64_t		timer_now;
+static struct twtimer_wheel timer_wheel;
+
+static void
+twtimer_test_fn(struct twtimer *t)
+{
+	struct timergucio *g = twtimer_entry(t, struct timergucio, timer);
+
+	g->fired = timer_now;
+	g->count++;
+}
+
+// fires 3 times, every 10 ticks
+static void
+twtimer_test_rearm_fn(struct twtimer *t)
+{
+	struct timergucio *g = twtimer_entry(t, struct timergucio, timer);
+
+	twtimer_test_fn(t);
+	if (g->count < 3)
+		twtimer_add(&timer_wheel, t, timer_now + 10);
+}
+
+static void
+twtimer_test(void)
+{
+	static const uint64_t	edges[] = { 0, 1, 255, 256, 257, (1 << 14) - 1,
+					1 << 14, (1 << 14) + 1, 1 << 20,
+					(1 << 20) + 300, TWTEST_TIMER_SPAN - 1 };
+	struct twtimer_wheel	*w = &timer_wheel;
+	struct timergucio	*g;
+	struct twlist_head	expired;
+	struct twtimer		*t, *tmp;
+	uint64_t		start, prev;
+	size_t			i, fired, collected;
+	int			ret;
+
+	g = malloc(TWTEST_TIMER_N * sizeof(*g));
+	assert(g);
+
+	// every timer fires at its tick, across all levels and starting
+	// right before a 2^32 boundary so that every level wraps
+	start = 0xffffffffULL - 3000;
+	twtimer_wheel_init(w, start);
+	srand(7);
+	for (i = 0; i < TWTEST_TIMER_N; i++)
+	{
+		twtimer_init(&g[i].timer, twtimer_test_fn);
+		g[i].count = 0;
+		if (i < TWARRAY_SIZE(edges))
+			twtimer_add(w, &g[i].timer, start + edges[i]);
+		else
+			twtimer_add(w, &g[i].timer,
+				start + (uint64_t) rand() % TWTEST_TIMER_SPAN);
+		assert(twtimer_pending(&g[i].timer));
+	}
+	// cancel every 10th random one, move the one after it
+	for (i = TWARRAY_SIZE(edges); i < TWTEST_TIMER_N; i += 10)
+	{
+		ret = twtimer_del(&g[i].timer);
+		assert(ret == 1);
+		ret = twtimer_del(&g[i].timer);
+		assert(ret == 0);
+		if (i + 1 < TWTEST_TIMER_N)
+		{
+			ret = twtimer_mod(w, &g[i + 1].timer,
+				g[i + 1].timer.expires / 2 + start / 2 + 77);
+			assert(ret == 1);
+		}
+	}
+	fired = 0;
+	for (timer_now = start; timer_now < start + TWTEST_TIMER_SPAN;
+							timer_now++)
+		fired += twtimer_run(w, timer_now);
+	for (i = 0; i < TWTEST_TIMER_N; i++)
+	{
+		assert(!twtimer_pending(&g[i].timer));
+		if (i >= TWARRAY_SIZE(edges) &&
+				(i - TWARRAY_SIZE(edges)) % 10 == 0)
+		{
+			assert(g[i].count == 0);
+			fired++;
+			continue;
+		}
+		assert(g[i].count == 1 && g[i].fired == g[i].timer.expires);
+	}
+	assert(fired == TWTEST_TIMER_N);
+
+	// time jumps, due timers are collected in one batch in tick order
+	twtimer_wheel_init(w, 100);
+	for (i = 0; i < TWTEST_TIMER_N; i++)
+	{
+		g[i].count = 0;
+		twtimer_add(w, &g[i].timer, 100 + (uint64_t) rand() % 5000);
+	}
+	TWINIT_LIST_HEAD(&expired);
+	twtimer_expire(w, 2099, &expired);
+	collected = 0;
+	prev = 0;
+	twlist_for_each_entry_safe(t, tmp, &expired, entry)
+	{
+		assert(t->expires <= 2099 && t->expires >= prev);
+		prev = t->expires;
+		ret = twtimer_del(t);
+		assert(ret == 1);
+		collected++;
+	}
+	for (i = 0; i < TWTEST_TIMER_N; i++)
+		assert(twtimer_pending(&g[i].timer) ==
+					(g[i].timer.expires > 2099));
+	timer_now = 6000;
+	fired = twtimer_run(w, timer_now);
+	assert(fired == TWTEST_TIMER_N - collected);
+
+	// overdue timers fire on the next tick, callbacks can re-arm
+	twtimer_add(w, &g[0].timer, 10);
+	twtimer_init(&g[1].timer, twtimer_test_rearm_fn);
+	g[0].count = g[1].count = 0;
+	twtimer_add(w, &g[1].timer, timer_now + 1);
+	for (timer_now = 6001; timer_now < 6100; timer_now++)
+		twtimer_run(w, timer_now);
+	assert(g[0].count == 1 && g[0].fired == 6001);
+	assert(g[1].count == 3 && g[1].fired == 6021);
+
+	// far timers are parked, not clamped
+	twtimer_add(w, &g[2].timer, timer_now + (1ULL << 40));
+	assert(g[2].timer.expires == timer_now + (1ULL << 40));
+	fired = twtimer_run(w, timer_now + (1 << 16));
+	assert(fired == 0);
+	ret = twtimer_del(&g[2].timer);
+	assert(ret == 1);
+	free(g);
+	(void) prev;
+	(void) ret;
+}
+
+struct heapgucio
+{
+	int			key;
+	int			in;	/* in the heap */
+	struct twheap_node	node;
+	struct twlist_head	list;
+};
+
+#define TWTEST_HEAP_N	1000
+
+static int
+twheap_test_less(const struct twheap_node *a, const struct twheap_node *b)
+{
+	return twheap_entry(a, struct heapgucio, node)->key <
+			twheap_entry(b, struct heapgucio, node)->key;
+}
+
+// smallest key of the objects in the heap, by brute force
+__attribute__((unused)) static int
+twheap_test_min(struct heapgucio *g, size_t n)
+{
+	int	min = 0x7fffffff;
+	size_t	i;
+
+	for (i = 0; i < n; i++)
+		if (g[i].in && g[i].key < min)
+			min = g[i].key;
+	return min;
+}
+
+static void
+twheap_test(void)
+{
+	struct twheap		h, h2;
+	struct heapgucio	*g, *obj;
+	struct twheap_node	*n;
+	struct twlist_head	all;
+	size_t			i, in = 0, op;
+	int			prev;
+
+	g = malloc(TWTEST_HEAP_N * sizeof(*g));
+	assert(g);
+	twheap_init(&h, twheap_test_less);
+	n = twheap_pop(&h);
+	assert(twheap_empty(&h) && n == NULL);
+
+	// objects live on a list too, decrease and delete reach them through it
+	TWINIT_LIST_HEAD(&all);
+	srand(11);
+	for (i = 0; i < TWTEST_HEAP_N; i++)
+	{
+		g[i].key = rand() % 10000;
+		g[i].in = 0;
+		twlist_add_tail(&g[i].list, &all);
+	}
+
+	for (op = 0; op < 20000; op++)
+	{
+		i = (size_t) rand() % TWTEST_HEAP_N;
+		obj = &g[i];
+		switch (rand() % 4)
+		{
+		case 0:
+			if (obj->in)
+				break;
+			obj->key = rand() % 10000;
+			twheap_insert(&h, &obj->node);
+			obj->in = 1;
+			in++;
+			break;
+		case 1:
+			n = twheap_pop(&h);
+			if (!in)
+			{
+				assert(!n);
+				break;
+			}
+			obj = twheap_entry(n, struct heapgucio, node);
+			assert(obj->in);
+			obj->in = 0;
+			assert(obj->key <= twheap_test_min(g, TWTEST_HEAP_N));
+			in--;
+			break;
+		case 2:
+			if (!obj->in)
+				break;
+			obj->key -= rand() % 5000;
+			twheap_decrease(&h, &obj->node);
+			break;
+		case 3:
+			if (!obj->in)
+				break;
+			twheap_del(&h, &obj->node);
+			obj->in = 0;
+			in--;
+			break;
+		}
+		assert(twheap_count(&h) == in);
+		if (in)
+			assert(twheap_entry(twheap_min(&h), struct heapgucio,
+				node)->key == twheap_test_min(g, TWTEST_HEAP_N));
+	}
+
+	// meld with a second heap, then everything pops in order
+	twheap_init(&h2, twheap_test_less);
+	twlist_for_each_entry(obj, &all, list)
+	{
+		if (obj->in)
+			continue;
+		obj->key = rand() % 10000;
+		twheap_insert(&h2, &obj->node);
+		obj->in = 1;
+	}
+	twheap_meld(&h, &h2);
+	assert(twheap_empty(&h2) && twheap_count(&h) == TWTEST_HEAP_N);
+	prev = -0x7fffffff;
+	for (i = 0; i < TWTEST_HEAP_N; i++)
+	{
+		obj = twheap_entry(twheap_pop(&h), struct heapgucio, node);
+		assert(obj->key >= prev);
+		prev = obj->key;
+	}
+	assert(twheap_empty(&h) && twheap_count(&h) == 0);
+	free(g);
+	(void) prev;
+}
+
+struct ilistgucio
+{
+	uint32_t		key;
+	struct twilist_node	link;
+};
+
+#define TWTEST_ILIST_N	64
+
+// keys of the list in order must be @keys
+static void
+twilist_test_check(struct ilistgucio *g, struct twilist_head *h,
+					const uint32_t *keys, size_t n)
+{
+	struct ilistgucio	*pos;
+	uint32_t		i;
+	size_t			k = 0;
+
+	twilist_for_each_entry(pos, g, link, h)
+	{
+		assert(k < n && pos->key == keys[k]);
+		k++;
+	}
+	assert(k == n);
+	twilist_for_each_prev(i, g, link, h)
+	{
+		k--;
+		assert(g[i].key == keys[k]);
+	}
+	assert(k == 0);
+	assert(twilist_empty(h) == (n == 0));
+	assert(twilist_is_singular(h) == (n == 1));
+	(void) keys;
+	(void) n;
+}
+
+static void
+twilist_test(void)
+{
+	static struct ilistgucio	g[TWTEST_ILIST_N];
+	struct twilist_head		h = TWILIST_HEAD_INIT, h2;
+	struct ilistgucio		*pos, *n;
+	uint32_t			i, tmp;
+	size_t				count;
+
+	assert(sizeof(struct twilist_node) == 8);
+	for (i = 0; i < TWTEST_ILIST_N; i++)
+		g[i].key = i * 10;
+
+	twilist_test_check(g, &h, NULL, 0);
+	twilist_add(g, link, 1, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 10 }, 1);
+	twilist_add(g, link, 2, &h);
+	twilist_add_tail(g, link, 3, &h);
+	twilist_add_tail(g, link, 4, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 20, 10, 30, 40 }, 4);
+	assert(twilist_is_last(4, &h) && !twilist_is_last(3, &h));
+	assert(twilist_index(g, twilist_first_entry_or_null(g, &h)) == 2);
+
+	// del first, middle, last
+	twilist_del(g, link, 2, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 10, 30, 40 }, 3);
+	twilist_del(g, link, 3, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 10, 40 }, 2);
+	twilist_del(g, link, 4, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 10 }, 1);
+	twilist_del(g, link, 1, &h);
+	twilist_test_check(g, &h, NULL, 0);
+
+	// splices, to the front and the end, into empty and non-empty lists
+	TWINIT_ILIST_HEAD(&h2);
+	twilist_add_tail(g, link, 5, &h2);
+	twilist_add_tail(g, link, 6, &h2);
+	twilist_splice_init(g, link, &h2, &h);
+	assert(twilist_empty(&h2));
+	twilist_test_check(g, &h, (const uint32_t []) { 50, 60 }, 2);
+	twilist_add_tail(g, link, 7, &h2);
+	twilist_add_tail(g, link, 8, &h2);
+	twilist_splice(g, link, &h2, &h);
+	twilist_test_check(g, &h, (const uint32_t []) { 70, 80, 50, 60 }, 4);
+	TWINIT_ILIST_HEAD(&h2);
+	twilist_splice_tail_init(g, link, &h, &h2);
+	twilist_test_check(g, &h2, (const uint32_t []) { 70, 80, 50, 60 }, 4);
+	twilist_add(g, link, 9, &h);
+	twilist_add(g, link, 10, &h);
+	twilist_splice_tail_init(g, link, &h, &h2);
+	twilist_test_check(g, &h2,
+		(const uint32_t []) { 70, 80, 50, 60, 100, 90 }, 6);
+	twilist_splice_tail(g, link, &h, &h2);
+	twilist_test_check(g, &h2,
+		(const uint32_t []) { 70, 80, 50, 60, 100, 90 }, 6);
+
+	// moves between lists
+	twilist_move(g, link, 5, &h2, &h);
+	twilist_move_tail(g, link, 7, &h2, &h);
+	twilist_test_check(g, &h2,
+		(const uint32_t []) { 80, 60, 100, 90 }, 4);
+	twilist_test_check(g, &h, (const uint32_t []) { 50, 70 }, 2);
+	twilist_move_tail(g, link, 5, &h, &h2);
+	twilist_move(g, link, 7, &h, &h2);
+	twilist_test_check(g, &h, NULL, 0);
+	twilist_test_check(g, &h2,
+		(const uint32_t []) { 70, 80, 60, 100, 90, 50 }, 6);
+
+	// removal while iterating
+	count = 0;
+	twilist_for_each_safe(i, tmp, g, link, &h2)
+	{
+		if (g[i].key == 60 || g[i].key == 70)
+			twilist_del(g, link, i, &h2);
+		count++;
+	}
+	assert(count == 6);
+	twilist_test_check(g, &h2,
+		(const uint32_t []) { 80, 100, 90, 50 }, 4);
+	twilist_for_each_entry_safe(pos, n, g, link, &h2)
+		twilist_del(g, link, twilist_index(g, pos), &h2);
+	twilist_test_check(g, &h2, NULL, 0);
+	count = 0;
+	twilist_for_each_entry_reverse(pos, g, link, &h2)
+		count++;
+	assert(count == 0);
+}
+
+struct llistgucio
+{
+	uint32_t		producer;
+	uint32_t		seq;
+	struct twllist_node	node;
+};
+
+#define TWTEST_LLIST_PRODUCERS		4
+#define TWTEST_LLIST_PER_PRODUCER	20000
+
+static TWLLIST_HEAD(llist_h);
+static struct llistgucio	llist_msgs[TWTEST_LLIST_PRODUCERS][TWTEST_LLIST_PER_PRODUCER];
+
+static void *
+twllist_test_producer(void *arg)
+{
+	uint32_t i, p = *(uint32_t *) arg;
+
+	for (i = 0; i < TWTEST_LLIST_PER_PRODUCER; i++)
+	{
+		llist_msgs[p][i].producer = p;
+		llist_msgs[p][i].seq = i;
+		twllist_add(&llist_msgs[p][i].node, &llist_h);
+		if (i % 1000 == 0)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void
+twllist_test(void)
+{
+	pthread_t		tid[TWTEST_LLIST_PRODUCERS];
+	uint32_t		id[TWTEST_LLIST_PRODUCERS];
+	uint32_t		next[TWTEST_LLIST_PRODUCERS] = { 0 };
+	struct llistgucio	m[3], *pos, *tmp;
+	struct twllist_node	*first, *n;
+	uint32_t		i, count = 0, batches = 0;
+	int			ret;
+
+	// single threaded ordering
+	TWINIT_LLIST_HEAD(&llist_h);
+	assert(twllist_empty(&llist_h));
+	first = twllist_del_all(&llist_h);
+	assert(first == NULL);
+	first = twllist_del_first(&llist_h);
+	assert(first == NULL);
+	for (i = 0; i < 3; i++)
+		m[i].seq = i;
+	ret = twllist_add(&m[0].node, &llist_h);
+	assert(ret == 1);
+	ret = twllist_add(&m[1].node, &llist_h);
+	assert(ret == 0);
+	ret = twllist_add(&m[2].node, &llist_h);
+	assert(ret == 0);
+	assert(!twllist_empty(&llist_h));
+	first = twllist_del_first(&llist_h);
+	assert(first == &m[2].node);
+	first = twllist_del_all(&llist_h);
+	assert(twllist_empty(&llist_h));
+	assert(first == &m[1].node && twllist_next(first) == &m[0].node);
+	first = twllist_reverse_order(first);
+	i = 0;
+	twllist_for_each_entry(pos, first, node)
+	{
+		assert(pos->seq == i);
+		i++;
+	}
+	assert(i == 2);
+
+	// batch add of a prepared chain
+	m[0].node.next = &m[1].node;
+	m[1].node.next = &m[2].node;
+	ret = twllist_add_batch(&m[0].node, &m[2].node, &llist_h);
+	assert(ret == 1);
+	i = 0;
+	twllist_for_each_safe(n, first, twllist_del_all(&llist_h))
+		i++;
+	assert(i == 3);
+
+	// concurrent producers, the consumer takes whole batches, order is
+	// kept per producer once a batch is reversed
+	for (i = 0; i < TWTEST_LLIST_PRODUCERS; i++)
+	{
+		id[i] = i;
+		ret = pthread_create(&tid[i], NULL, twllist_test_producer,
+								&id[i]);
+		assert(ret == 0);
+	}
+	while (count < TWTEST_LLIST_PRODUCERS * TWTEST_LLIST_PER_PRODUCER)
+	{
+		first = twllist_del_all(&llist_h);
+		if (!first)
+		{
+			sched_yield();
+			continue;
+		}
+		batches++;
+		first = twllist_reverse_order(first);
+		twllist_for_each_entry_safe(pos, tmp, first, node)
+		{
+			assert(pos->seq == next[pos->producer]);
+			next[pos->producer]++;
+			count++;
+		}
+	}
+	for (i = 0; i < TWTEST_LLIST_PRODUCERS; i++)
+	{
+		ret = pthread_join(tid[i], NULL);
+		assert(ret == 0);
+	}
+	assert(batches <= count);
+	first = twllist_del_all(&llist_h);
+	assert(first == NULL);
+	(void) ret;
+}
+
+struct snapgucio
+{
+	uint64_t		key;
+	int			val;
+	struct twhlist_node	hnode;
+};
+
+#define TWTEST_SNAP_N	1000
+
+static void
+twhash_snap_test(void)
+{
+	TWDEFINE_HASHTABLE(ht, 6);
+	struct snapgucio		*g;
+	const struct snapgucio		*obj;
+	const struct twhash_snap_rec	*rec;
+	struct twhash_snap		s;
+	char				path[64];
+	size_t				i, bkt, n;
+	int				ret;
+	FILE				*f;
+
+	snprintf(path, sizeof(path), "/tmp/twtest_snap.%d", (int) getpid());
+	g = malloc(TWTEST_SNAP_N * sizeof(*g));
+	assert(g);
+	twhash_init(ht);
+
+	// an empty table gives an empty snapshot
+	ret = twhash_snap_save(path, ht, 4, struct snapgucio, hnode, key);
+	assert(ret == 0);
+	ret = twhash_snap_open(&s, path);
+	assert(ret == 0);
+	assert(twhash_snap_count(&s) == 0);
+	assert(twhash_snap_lookup(&s, 1) == NULL);
+	twhash_snap_close(&s);
+
+	// snapshot bits differ from the table's, records are rehashed
+	for (i = 0; i < TWTEST_SNAP_N; i++)
+	{
+		g[i].key = i * 0x9e3779b97f4a7c15ULL;
+		g[i].val = i;
+		twhash_add(ht, &g[i].hnode, g[i].key);
+	}
+	ret = twhash_snap_save(path, ht, 10, struct snapgucio, hnode, key);
+	assert(ret == 0);
+	// the table is left as it was
+	for (i = 0; i < TWTEST_SNAP_N; i++)
+		assert(twhash_hashed(&g[i].hnode));
+	ret = twhash_snap_open(&s, path);
+	assert(ret == 0);
+	assert(twhash_snap_count(&s) == TWTEST_SNAP_N);
+	ret = twhash_snap_willneed(&s);
+	assert(ret == 0);
+
+	// copies are found in the mapping, the node is zeroed
+	for (i = 0; i < TWTEST_SNAP_N; i++)
+	{
+		obj = twhash_snap_lookup(&s, g[i].key);
+		assert(obj && obj != &g[i]);
+		assert(obj->key == g[i].key && obj->val == (int) i);
+		assert(obj->hnode.next == NULL && obj->hnode.pprev == NULL);
+		assert(((uintptr_t) obj) % TWHASH_SNAP_ALIGN == 0);
+		assert(twhash_snap_lookup(&s, g[i].key + 1) == NULL);
+	}
+
+	// every record once, records of a bucket hash to it
+	n = 0;
+	twhash_snap_for_each(&s, bkt, rec)
+	{
+		assert(twhash_64(rec->key, 10) == bkt);
+		obj = twhash_snap_entry(rec, struct snapgucio);
+		assert(obj->key == rec->key);
+		n++;
+	}
+	assert(n == TWTEST_SNAP_N);
+	n = 0;
+	twhash_snap_for_each_possible(&s, rec, g[7].key)
+		if (rec->key == g[7].key)
+			n++;
+	assert(n == 1);
+	twhash_snap_close(&s);
+
+	// a file which is not a complete snapshot is refused
+	f = fopen(path, "r+");
+	assert(f);
+	ret = fputc('X', f);
+	assert(ret != EOF);
+	fclose(f);
+	ret = twhash_snap_open(&s, path);
+	assert(ret == -1);
+	f = fopen(path, "w");
+	assert(f);
+	fclose(f);
+	ret = twhash_snap_open(&s, path);
+	assert(ret == -1);
+	ret = unlink(path);
+	assert(ret == 0);
+	ret = twhash_snap_open(&s, path);
+	assert(ret == -1);
+
+	// bad bits are refused before anything is written
+	errno = 0;
+	ret = twhash_snap_save(path, ht, 0, struct snapgucio, hnode, key);
+	assert(ret == -1 && errno == EINVAL);
+	ret = twhash_snap_save(path, ht, 33, struct snapgucio, hnode, key);
+	assert(ret == -1 && errno == EINVAL);
+	assert(access(path, F_OK) == -1);
+	free(g);
+	(void) obj;
+	(void) ret;
+}
+
+struct shmgucio
+{
+	uint64_t		key;
+	int			val;
+	struct twhash_shm_node	node;
+};
+
+#define TWTEST_SHM_N	2000
+
+// add keys [from, to) through @t
+static void
+twhash_shm_test_add(struct twhash_shm *t, size_t from, size_t to)
+{
+	struct shmgucio	*g;
+	size_t		i;
+
+	for (i = from; i < to; i++)
+	{
+		g = twhash_shm_alloc(t, sizeof(*g));
+		assert(g);
+		g->key = i;
+		g->val = (int) i;
+		twhash_shm_add(t, &g->node, g->key);
+		if (i % 64 == 0)
+			sched_yield();
+	}
+}
+
+static void
+twhash_shm_test(void)
+{
+	struct twhash_shm	a, b;
+	struct shmgucio		*obj, *obj2;
+	char			name[64];
+	size_t			i, n;
+	pid_t			pid;
+	int			status, ret;
+	void			*p;
+
+	snprintf(name, sizeof(name), "/twtest_shm.%d", (int) getpid());
+	ret = twhash_shm_open(&a, name);
+	assert(ret == -1);
+	// too small for its buckets
+	ret = twhash_shm_create(&a, name, 10, 1024);
+	assert(ret == -1);
+	ret = twhash_shm_create(&a, name, 10, 1 << 20);
+	assert(ret == 0);
+	ret = twhash_shm_create(&b, name, 10, 1 << 20);
+	assert(ret == -1);
+	assert(twhash_shm_count(&a) == 0);
+
+	// a second mapping of the segment, at another address
+	ret = twhash_shm_open(&b, name);
+	assert(ret == 0);
+	assert(a.base != b.base && b.bits == 10);
+
+	// a child process adds the odd keys, the parent the even ones
+	pid = fork();
+	assert(pid >= 0);
+	if (pid == 0)
+	{
+		struct twhash_shm c;
+
+		if (twhash_shm_open(&c, name) != 0)
+			_exit(1);
+		for (i = 1; i < TWTEST_SHM_N; i += 2)
+			twhash_shm_test_add(&c, i, i + 1);
+		twhash_shm_close(&c);
+		_exit(0);
+	}
+	for (i = 0; i < TWTEST_SHM_N; i += 2)
+		twhash_shm_test_add(&a, i, i + 1);
+	ret = waitpid(pid, &status, 0);
+	assert(ret == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	assert(twhash_shm_count(&a) == TWTEST_SHM_N);
+
+	// both mappings find every object, at their own addresses
+	for (i = 0; i < TWTEST_SHM_N; i++)
+	{
+		obj = twhash_shm_lookup(&a, obj, node, i, obj->key == i);
+		obj2 = twhash_shm_lookup(&b, obj2, node, i, obj2->key == i);
+		assert(obj && obj2 && obj->val == (int) i);
+		assert(twhash_shm_off(&a, obj) == twhash_shm_off(&b, obj2));
+		assert(twhash_shm_hashed(&obj->node));
+	}
+	obj = twhash_shm_lookup(&a, obj, node, TWTEST_SHM_N,
+						obj->key == TWTEST_SHM_N);
+	assert(obj == NULL);
+
+	// objects in one bucket under its lock
+	twhash_shm_lock(&b, 5);
+	n = 0;
+	twhash_shm_for_each_possible(&b, obj, node, 5)
+	{
+		assert(twhash_64(obj->key, 10) == twhash_64(5, 10));
+		n += obj->key == 5;
+	}
+	assert(n == 1);
+	twhash_shm_unlock(&b, 5);
+
+	// delete through one mapping, gone in the other
+	for (i = 0; i < TWTEST_SHM_N; i += 3)
+	{
+		obj = twhash_shm_lookup(&a, obj, node, i, obj->key == i);
+		assert(obj);
+		twhash_shm_del(&a, &obj->node, i);
+		assert(!twhash_shm_hashed(&obj->node));
+		// deleting again does nothing
+		twhash_shm_del(&a, &obj->node, i);
+	}
+	for (i = 0; i < TWTEST_SHM_N; i++)
+	{
+		obj = twhash_shm_lookup(&b, obj, node, i, obj->key == i);
+		assert((obj == NULL) == (i % 3 == 0));
+	}
+	assert(twhash_shm_count(&b) ==
+			TWTEST_SHM_N - (TWTEST_SHM_N + 2) / 3);
+
+	// the segment runs out
+	n = twhash_shm_avail(&a) / TWHASH_SHM_ALIGN;
+	for (i = 0; i < n; i++)
+	{
+		p = twhash_shm_alloc(&a, 1);
+		assert(p);
+	}
+	assert(twhash_shm_avail(&a) == 0);
+	p = twhash_shm_alloc(&b, 1);
+	assert(p == NULL);
+
+	twhash_shm_close(&b);
+	twhash_shm_close(&a);
+	ret = twhash_shm_unlink(name);
+	assert(ret == 0);
+	ret = twhash_shm_open(&a, name);
+	assert(ret == -1);
+	(void) ret;
+	(void) p;
+}
+
 int
 main(void)
 {
 	// test twlist
 	twlist_test();
+	// test twhash_dyn
+	twhash_dyn_test();
+	// test rcu hlist and reclamation
+	twrcu_test();
+	// test bit locked hashtable
+	twhash_bl_test();
+	// test lock-free mpsc queue
+	twfifo_mpsc_test();
+	// test bounded spsc ring
+	twfifo_spsc_test();
+	// test open addressing hashtable
+	twhash_oa_test();
+	// test byte string hashing
+	twhash_buf_test();
+	// test batched lookups
+	twhash_lookup_batch_test();
+	// test list sort
+	twlist_sort_test();
+	// test skip list
+	twskiplist_test();
+	// test red-black tree
+	twrbtree_test();
+	// test nulls hashtable
+	twhash_nulls_test();
+	// test lru cache
+	twlru_test();
+	// test object pool
+	twpool_test();
+	// test hashtable statistics
+	twhash_stats_test();
+	// test seeded hashing
+	twhash_seeded_test();
+	// test sharded hashtable
+	twhash_sharded_test();
+	// test timer wheel
+	twtimer_test();
+	// test pairing heap
+	twheap_test();
+	// test index linked list
+	twilist_test();
+	// test lock-free llist
+	twllist_test();
+	// test hashtable snapshot
+	twhash_snap_test();
+	// test shared memory hashtable
+	twhash_shm_test();
 
 	return 0;
 }
@@ -0,0 +1,234 @@
+/// @file	twtest_cpp.cpp
+/// @brief	Test suite for the C++ wrappers twlist.hpp and twhash.hpp.
+/// @author	Piotr Gregor piotrek.gregor at gmail.com
+/// @version	0.1.2
+/// @date	16 Oct 2026
+/// @copyright	LGPLv2.1
+
+
+#include "twlist.hpp"		// tw::list
+#include "twhash.hpp"		// tw::hash_table
+
+
+#include <algorithm>		// find_if, count_if, is_sorted
+#include <iterator>		// distance, next
+#include <numeric>		// accumulate
+#include <cstdint>		// fixed width integers
+#include <cassert>		// assertion
+
+
+// our test struct
+struct gucio
+{
+	uint32_t	key;
+	int		val;
+	twlist_head	link;
+	twhlist_node	hlink;
+};
+
+#define TWTEST_CPP_N	100
+
+typedef tw::list<gucio, &gucio::link>			gucio_list;
+typedef tw::hash_table<gucio, &gucio::hlink, 4>		gucio_table;
+
+// the wrappers add nothing to what they wrap
+static_assert(sizeof(gucio_list) == sizeof(twlist_head), "list size");
+static_assert(sizeof(gucio_table) == 16 * sizeof(twhlist_head), "table size");
+static_assert(gucio_table::bits == 4, "bits");
+static_assert(gucio_table::bucket_count == 16, "bucket count");
+
+static void
+twlist_cpp_test(void)
+{
+	gucio		g[TWTEST_CPP_N];
+	gucio_list	l, l2;
+	uint32_t	i;
+	int		sum;
+
+	assert(l.empty() && l.size() == 0 && l.begin() == l.end());
+	for (i = 0; i < TWTEST_CPP_N; i++)
+	{
+		g[i].key = i;
+		g[i].val = (int) i;
+		l.push_back(g[i]);
+	}
+	assert(!l.empty() && !l.is_singular() && l.size() == TWTEST_CPP_N);
+	assert(&l.front() == &g[0] && &l.back() == &g[TWTEST_CPP_N - 1]);
+
+	// range-for and the C macros see the same order
+	i = 0;
+	for (gucio &x : l)
+	{
+		assert(x.key == i);
+		(void) x;
+		i++;
+	}
+	assert(i == TWTEST_CPP_N);
+	gucio *pos;
+	i = 0;
+	twlist_for_each_entry(pos, l.head(), link)
+	{
+		assert(pos->key == i);
+		i++;
+	}
+
+	// reverse iteration
+	i = TWTEST_CPP_N;
+	for (gucio_list::reverse_iterator it = l.rbegin(); it != l.rend(); ++it)
+	{
+		i--;
+		assert(it->key == i);
+	}
+	assert(i == 0);
+
+	// <algorithm> and const iteration
+	const gucio_list &cl = l;
+	assert(std::is_sorted(cl.begin(), cl.end(),
+		[](const gucio &a, const gucio &b) { return a.key < b.key; }));
+	gucio_list::const_iterator ci = std::find_if(cl.cbegin(), cl.cend(),
+				[](const gucio &x) { return x.key == 42; });
+	assert(ci != cl.cend() && &*ci == &g[42]);
+	assert(std::count_if(l.begin(), l.end(),
+			[](const gucio &x) { return x.key % 2; }) == 50);
+	sum = std::accumulate(l.begin(), l.end(), 0,
+			[](int s, const gucio &x) { return s + x.val; });
+	assert(sum == TWTEST_CPP_N * (TWTEST_CPP_N - 1) / 2);
+
+	// erase the even ones while iterating
+	for (gucio_list::iterator it = l.begin(); it != l.end();)
+		it = it->key % 2 ? std::next(it) : l.erase(it);
+	assert(l.size() == TWTEST_CPP_N / 2);
+	for (gucio &x : l)
+	{
+		assert(x.key % 2);
+		(void) x;
+	}
+
+	// insert puts an element before pos
+	gucio_list::iterator it = l.insert(gucio_list::iterator_to(g[3]), g[2]);
+	assert(&*it == &g[2] && &*std::next(it) == &g[3]);
+	assert(&*std::prev(gucio_list::iterator_to(g[2])) == &g[1]);
+
+	// move and remove
+	l.move_front(g[99]);
+	assert(&l.front() == &g[99]);
+	l.move_back(g[99]);
+	assert(&l.back() == &g[99]);
+	gucio_list::remove(g[99]);
+	assert(&l.back() == &g[97] && l.size() == TWTEST_CPP_N / 2);
+
+	// pop
+	l.pop_front();
+	assert(&l.front() == &g[2]);
+	l.pop_back();
+	assert(&l.back() == &g[95]);
+
+	// splice, the other list is left empty
+	l2.push_back(g[0]);
+	l2.push_back(g[4]);
+	l.splice_front(l2);
+	assert(l2.empty() && &l.front() == &g[0]);
+	l2.push_back(g[6]);
+	l.splice_back(l2);
+	assert(l2.empty() && &l.back() == &g[6]);
+	assert(l.size() == TWTEST_CPP_N / 2 + 1);
+
+	l.clear();
+	assert(l.empty() && l.size() == 0);
+	l.push_front(g[1]);
+	assert(l.is_singular());
+	(void) sum;
+	(void) ci;
+	(void) it;
+}
+
+static void
+twhash_cpp_test(void)
+{
+	gucio		g[TWTEST_CPP_N];
+	gucio_table	ht;
+	gucio		*obj;
+	uint32_t	i, k;
+	size_t		n;
+
+	assert(ht.empty() && ht.size() == 0 && ht.begin() == ht.end());
+	for (i = 0; i < TWTEST_CPP_N; i++)
+	{
+		g[i].key = i;
+		g[i].val = (int) i;
+		ht.add(g[i], g[i].key);
+		assert(gucio_table::hashed(g[i]));
+	}
+	assert(!ht.empty() && ht.size() == TWTEST_CPP_N);
+
+	// the wrapper hashes like the C macros
+	for (i = 0; i < TWTEST_CPP_N; i++)
+	{
+		n = 0;
+		twhash_for_each_possible_bits(ht.buckets(), obj, hlink, i,
+						gucio_table::bits)
+			if (obj == &g[i])
+				n++;
+		assert(n == 1);
+		assert(gucio_table::bucket(i) == twhash_min(i, 4));
+	}
+
+	// lookup through the chain range and find
+	for (i = 0; i < TWTEST_CPP_N; i++)
+	{
+		n = 0;
+		for (gucio &x : ht.possible(i))
+		{
+			assert(gucio_table::bucket(x.key) ==
+						gucio_table::bucket(i));
+			if (x.key == i)
+				n++;
+		}
+		assert(n == 1);
+		obj = ht.find(i, [i](const gucio &x) { return x.key == i; });
+		assert(obj == &g[i]);
+	}
+	k = TWTEST_CPP_N;
+	assert(ht.find(k, [k](const gucio &x) { return x.key == k; }) == nullptr);
+
+	// every object is visited once by the table iterator
+	n = 0;
+	for (gucio &x : ht)
+	{
+		x.val = -x.val;
+		n++;
+	}
+	assert(n == TWTEST_CPP_N);
+	for (i = 0; i < TWTEST_CPP_N; i++)
+		assert(g[i].val == -(int) i);
+	const gucio_table &cht = ht;
+	assert(std::count_if(cht.begin(), cht.end(),
+			[](const gucio &x) { return x.key < 10; }) == 10);
+	(void) cht;
+
+	// remove
+	for (i = 0; i < TWTEST_CPP_N; i += 2)
+		gucio_table::remove(g[i]);
+	assert(ht.size() == TWTEST_CPP_N / 2);
+	for (i = 0; i < TWTEST_CPP_N; i++)
+	{
+		obj = ht.find(i, [i](const gucio &x) { return x.key == i; });
+		assert(obj == (i % 2 ? &g[i] : nullptr));
+		assert(gucio_table::hashed(g[i]) == (i % 2 != 0));
+	}
+
+	ht.clear();
+	assert(ht.empty());
+	(void) k;
+}
+
+int
+main(void)
+{
+	// test list wrapper
+	twlist_cpp_test();
+	// test hashtable wrapper
+	twhash_cpp_test();
+
+	return 0;
+}